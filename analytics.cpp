@@ -0,0 +1,370 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Gameplay analytics
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "analytics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <ostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "save.h"
+
+using std::string;
+
+// Collector of this process
+Analytics analytics;
+
+thread_local Analytics::Shard* Analytics::thread_shard_ = nullptr;
+thread_local const Analytics* Analytics::thread_owner_ = nullptr;
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+// Counter file layout: header, then one array per field, then a CRC-32 of everything before it
+//
+//   "OANL"  u16 version  u16 reserved  u32 rows  u64 story
+//   u16 scene[rows]  u32 node[rows]  u8 choice[rows]  u8 outcome[rows]  u64 count[rows]
+//   u32 checksum
+//
+// Integers are little-endian. Rows are sorted by scene, node, choice and outcome. Rows name scenes, nodes and
+// endings by index, so the header carries the fingerprint of the story they were counted on (see storyFingerprint).
+constexpr char kMagic[4] = {'O', 'A', 'N', 'L'};
+constexpr uint16_t kVersion = 2;
+constexpr size_t kHeaderSize = 20;
+constexpr size_t kRowSize = sizeof(uint16_t) + sizeof(uint32_t) + 2 * sizeof(uint8_t) + sizeof(uint64_t);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Pack an event into a table key; the top bit keeps every key nonzero, which marks a free slot
+uint64_t packKey(uint16_t scene, uint32_t node, uint8_t choice, AnalyticsOutcome outcome) {
+    return (1ULL << 63) | static_cast<uint64_t>(scene) << 40 | static_cast<uint64_t>(node & 0xFFFFFF) << 16 |
+           static_cast<uint64_t>(choice) << 8 | static_cast<uint64_t>(outcome);
+}
+
+AnalyticsRow unpackKey(uint64_t key, uint64_t count) {
+    return {static_cast<uint16_t>(key >> 40), static_cast<uint32_t>((key >> 16) & 0xFFFFFF),
+            static_cast<uint8_t>(key >> 8), static_cast<AnalyticsOutcome>(key & 0xFF), count};
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// FNV-1a hash of the story's scene, node and ending names in index order: what the indices in the rows refer to.
+/// Edits that leave every name and its place alone, such as rewording text, keep the fingerprint.
+uint64_t storyFingerprint(const StoryGraph& graph) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto add = [&hash](const string& name) {
+        // The terminating zero keeps "ab" + "c" apart from "a" + "bc"
+        for (size_t i = 0; i <= name.size(); ++i) {
+            hash ^= i < name.size() ? static_cast<uint8_t>(name[i]) : 0;
+            hash *= 0x100000001B3ULL;
+        }
+    };
+    for (const StoryGraph::Scene& scene : graph.scenes()) add(scene.name);
+    add("--nodes");
+    for (uint32_t node = 0; node < graph.nodes().size(); ++node) add(graph.nodeName(node));
+    add("--endings");
+    for (const string& ending : graph.endings()) add(ending);
+    return hash;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+void putColumn(string& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) out += static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+}
+
+template <typename T>
+T getColumn(const char* data) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    return static_cast<T>(value);
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counters of one thread
+struct Analytics::Shard {
+    std::atomic<uint64_t> keys[kShardSlots];
+    std::atomic<uint64_t> counts[kShardSlots];
+    std::atomic<uint64_t> overflowed{0};
+    Shard* next = nullptr;
+
+    Shard() {
+        for (size_t i = 0; i < kShardSlots; ++i) {
+            keys[i].store(0, std::memory_order_relaxed);
+            counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+void AnalyticsStats::print(std::ostream& out) const {
+    out << "Analytics: " << recorded << " events in " << rows << " counters from " << shards << " threads, "
+        << merges << " merges, " << flushes << " flushes, " << overflowed << " lost to full tables" << std::endl;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+Analytics::Analytics() : started_(false), shards_(nullptr), story_(0), flushed_total_(0), stopping_(false) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+Analytics::~Analytics() {
+    stop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Analytics::start(const string& path, const StoryGraph& graph, string& error) {
+    if (started_.load()) return true;
+
+    std::vector<AnalyticsRow> rows;
+    struct stat info{};
+    if (::stat(path.c_str(), &info) == 0 && !read(path, graph, rows, error)) return false;
+
+    path_ = path;
+    story_ = storyFingerprint(graph);
+    base_.clear();
+    for (const AnalyticsRow& row : rows) {
+        base_[packKey(row.scene, row.node, row.choice, row.outcome)] += row.count;
+    }
+    totals_ = base_;
+    flushed_total_ = 0;
+    for (const auto& entry : base_) flushed_total_ += entry.second;
+    stopping_ = false;
+    started_.store(true, std::memory_order_release);
+    thread_ = std::thread(&Analytics::run, this);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Analytics::stop() {
+    if (!thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    started_.store(false);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Analytics::record(int scene, uint32_t node, int choice, AnalyticsOutcome outcome) {
+    if (!started_.load(std::memory_order_relaxed)) return;
+    Shard* target = shard();
+    uint64_t key = packKey(static_cast<uint16_t>(std::max(0, scene)), node,
+                           static_cast<uint8_t>(std::max(0, std::min(choice, 255))), outcome);
+
+    // Only this thread writes the shard, so plain loads and stores suffice; the merge thread only reads
+    size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 54) & (kShardSlots - 1);
+    for (size_t probe = 0; probe < kShardSlots; ++probe, slot = (slot + 1) & (kShardSlots - 1)) {
+        uint64_t current = target->keys[slot].load(std::memory_order_relaxed);
+        if (current == key) {
+            target->counts[slot].store(target->counts[slot].load(std::memory_order_relaxed) + 1,
+                                       std::memory_order_relaxed);
+            return;
+        }
+        if (current == 0) {
+            target->counts[slot].store(1, std::memory_order_relaxed);
+            target->keys[slot].store(key, std::memory_order_release);
+            return;
+        }
+    }
+    target->overflowed.store(target->overflowed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+AnalyticsStats Analytics::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+Analytics::Shard* Analytics::shard() {
+    if (thread_owner_ == this) return thread_shard_;
+
+    Shard* created = new Shard();
+    created->next = shards_.load(std::memory_order_relaxed);
+    while (!shards_.compare_exchange_weak(created->next, created, std::memory_order_release,
+                                          std::memory_order_relaxed)) {}
+    thread_shard_ = created;
+    thread_owner_ = this;
+    return created;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Analytics::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        bool stopping = wake_.wait_for(lock, kMergeInterval, [this] { return stopping_; });
+        lock.unlock();
+        merge();
+        bool flushed = flush();
+        lock.lock();
+        ++stats_.merges;
+        if (flushed) ++stats_.flushes;
+        if (stopping) break;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Analytics::merge() {
+    // Shards only ever grow, so the totals are rebuilt from the base each time rather than kept as deltas
+    totals_ = base_;
+    uint64_t recorded = 0;
+    uint64_t overflowed = 0;
+    uint64_t shards = 0;
+    for (Shard* source = shards_.load(std::memory_order_acquire); source != nullptr; source = source->next) {
+        ++shards;
+        overflowed += source->overflowed.load(std::memory_order_relaxed);
+        for (size_t slot = 0; slot < kShardSlots; ++slot) {
+            uint64_t key = source->keys[slot].load(std::memory_order_acquire);
+            if (key == 0) continue;
+            uint64_t count = source->counts[slot].load(std::memory_order_relaxed);
+            totals_[key] += count;
+            recorded += count;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.recorded = recorded;
+    stats_.overflowed = overflowed;
+    stats_.shards = shards;
+    stats_.rows = totals_.size();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Analytics::flush() {
+    uint64_t total = 0;
+    for (const auto& entry : totals_) total += entry.second;
+    if (total == flushed_total_) return false;
+
+    // Columns are gathered one field at a time from the sorted totals
+    uint32_t rows = static_cast<uint32_t>(totals_.size());
+    string file;
+    file.reserve(kHeaderSize + rows * kRowSize + sizeof(uint32_t));
+    file.append(kMagic, sizeof(kMagic));
+    putColumn<uint16_t>(file, kVersion);
+    putColumn<uint16_t>(file, 0);
+    putColumn<uint32_t>(file, rows);
+    putColumn<uint64_t>(file, story_);
+    for (const auto& entry : totals_) putColumn<uint16_t>(file, unpackKey(entry.first, 0).scene);
+    for (const auto& entry : totals_) putColumn<uint32_t>(file, unpackKey(entry.first, 0).node);
+    for (const auto& entry : totals_) putColumn<uint8_t>(file, unpackKey(entry.first, 0).choice);
+    for (const auto& entry : totals_) putColumn<uint8_t>(file, static_cast<uint8_t>(entry.first & 0xFF));
+    for (const auto& entry : totals_) putColumn<uint64_t>(file, entry.second);
+    putColumn<uint32_t>(file, saveChecksum(file.data(), file.size()));
+
+    // Replace the file whole, so a reader or a crash sees the old counters or the new ones
+    string temp_path = path_ + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < file.size()) {
+        ssize_t n = ::write(fd, file.data() + written, file.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        written += static_cast<size_t>(n);
+    }
+    bool ok = written == file.size() && fdatasync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    flushed_total_ = total;
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Analytics::read(const string& path, const StoryGraph& graph, std::vector<AnalyticsRow>& rows, string& error) {
+    rows.clear();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    string file;
+    char buffer[65536];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR)) {
+        if (n > 0) file.append(buffer, static_cast<size_t>(n));
+    }
+    ::close(fd);
+
+    if (file.size() < kHeaderSize + sizeof(uint32_t) || std::memcmp(file.data(), kMagic, sizeof(kMagic)) != 0) {
+        error = path + " is not an analytics file";
+        return false;
+    }
+    if (getColumn<uint16_t>(file.data() + 4) != kVersion) {
+        error = path + " has an unsupported version";
+        return false;
+    }
+    size_t count = getColumn<uint32_t>(file.data() + 8);
+    size_t body = file.size() - sizeof(uint32_t);
+    if (body != kHeaderSize + count * kRowSize ||
+        getColumn<uint32_t>(file.data() + body) != saveChecksum(file.data(), body)) {
+        error = path + " is damaged";
+        return false;
+    }
+    if (getColumn<uint64_t>(file.data() + 12) != storyFingerprint(graph)) {
+        error = path + " was collected on a different story; its scenes and nodes would be misattributed";
+        return false;
+    }
+
+    const char* scenes = file.data() + kHeaderSize;
+    const char* nodes = scenes + count * sizeof(uint16_t);
+    const char* choices = nodes + count * sizeof(uint32_t);
+    const char* outcomes = choices + count;
+    const char* counts = outcomes + count;
+    rows.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        rows[i] = {getColumn<uint16_t>(scenes + i * sizeof(uint16_t)),
+                   getColumn<uint32_t>(nodes + i * sizeof(uint32_t)), static_cast<uint8_t>(choices[i]),
+                   static_cast<AnalyticsOutcome>(outcomes[i]),
+                   getColumn<uint64_t>(counts + i * sizeof(uint64_t))};
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Analytics::print(const std::vector<AnalyticsRow>& rows, const StoryGraph& graph, std::ostream& out) {
+    auto sceneName = [&graph](uint16_t scene) {
+        return scene < graph.scenes().size() ? graph.scenes()[scene].name : "scene " + std::to_string(scene);
+    };
+
+    // Share of each choice among all choices made at its decision
+    std::map<std::pair<uint16_t, uint32_t>, uint64_t> decisions;
+    uint64_t endings = 0;
+    for (const AnalyticsRow& row : rows) {
+        if (row.outcome == AnalyticsOutcome::CHOICE) decisions[{row.scene, row.node}] += row.count;
+        if (row.outcome != AnalyticsOutcome::CHOICE) endings += row.count;
+    }
+
+    out << std::fixed << std::setprecision(1) << "Choices taken:\n";
+    for (const AnalyticsRow& row : rows) {
+        if (row.outcome != AnalyticsOutcome::CHOICE) continue;
+        string node = row.node < graph.nodes().size() ? graph.nodeName(row.node) : "node " + std::to_string(row.node);
+        uint64_t taken = decisions[{row.scene, row.node}];
+        out << "  " << std::left << std::setw(16) << sceneName(row.scene) << std::setw(24) << node << std::right
+            << " choice " << static_cast<int>(row.choice) << std::setw(12) << row.count << std::setw(8)
+            << 100.0 * static_cast<double>(row.count) / static_cast<double>(taken) << " %\n";
+    }
+
+    out << "\nHow runs ended:\n";
+    for (const AnalyticsRow& row : rows) {
+        if (row.outcome == AnalyticsOutcome::CHOICE) continue;
+        string name = "SANITY BREAK";
+        if (row.outcome == AnalyticsOutcome::ENDING) {
+            name = row.choice < graph.endings().size() ? graph.endings()[row.choice]
+                                                       : "ending " + std::to_string(row.choice);
+        }
+        out << "  " << std::left << std::setw(16) << name << " in " << std::setw(16) << sceneName(row.scene)
+            << std::right << std::setw(12) << row.count << std::setw(8)
+            << 100.0 * static_cast<double>(row.count) / static_cast<double>(endings) << " %\n";
+    }
+    out << std::flush;
+}
@@ -0,0 +1,147 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Gameplay analytics
+// Counts which choices players take at every decision, which endings they reach and in which scene their sanity
+// breaks, across all sessions of a process and across runs. Game threads only bump counters in a table of their own;
+// a background thread sums the tables every second and rewrites a small columnar file, so collecting costs the game
+// no lock, no shared cache line and no I/O.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_ANALYTICS_H
+#define OSIRIS_ANALYTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "story.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// What a counted event was
+enum class AnalyticsOutcome : uint8_t {
+    CHOICE,                     // A choice taken at a decision; choice is its number
+    ENDING,                     // An ending reached; choice is the ending index
+    SANITY_BREAK                // Sanity broke at the end of a turn; choice is 0
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One counter: how often an event happened at a scene and node
+struct AnalyticsRow {
+    uint16_t scene;
+    uint32_t node;
+    uint8_t choice;
+    AnalyticsOutcome outcome;
+    uint64_t count;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counters of the collector itself
+struct AnalyticsStats {
+    uint64_t recorded = 0;          // Events counted by game threads
+    uint64_t overflowed = 0;        // Events lost because a thread's table was full
+    uint64_t shards = 0;            // Threads that recorded anything
+    uint64_t merges = 0;            // Passes of the merge thread
+    uint64_t flushes = 0;           // Times the file was rewritten
+    uint64_t rows = 0;              // Distinct counters in the file
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print the counters on one line
+    /// @param out Destination stream
+    void print(std::ostream& out) const;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Process-wide analytics collector, used through the `analytics` global
+///
+/// Each thread that records gets a shard: an open-addressing table of kShardSlots counters that only it writes.
+/// A new key is published by storing its count before its key, with release order, so the merge thread never sees
+/// a key without its count. Shards are never freed; a thread that exits leaves its counts behind for the next merge.
+class Analytics {
+public:
+    static constexpr size_t kShardSlots = 1024;
+    static constexpr std::chrono::milliseconds kMergeInterval{1000};
+
+    Analytics();
+    ~Analytics();
+    Analytics(const Analytics&) = delete;
+    Analytics& operator=(const Analytics&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Start collecting into a file; counts already in it are carried on. Start once per process: shards outlive a
+    /// stop and would be counted again.
+    /// @param path Columnar counter file, created if missing
+    /// @param graph Story being played; a file counted on another story is refused
+    /// @param error Receives a description of the problem if the file is not a counter file of this story
+    /// @return False if the file exists but cannot be read or belongs to another story
+    bool start(const std::string& path, const StoryGraph& graph, std::string& error);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Merge and write the counters one last time and stop the merge thread
+    void stop();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Count an event on the calling thread; does nothing unless started
+    /// @param scene Scene index
+    /// @param node Story node index
+    /// @param choice Choice number or ending index
+    /// @param outcome Kind of event
+    void record(int scene, uint32_t node, int choice, AnalyticsOutcome outcome);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Counters; complete once stopped
+    AnalyticsStats stats() const;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Read a counter file
+    /// @param path File to read
+    /// @param graph Story the counters must have been collected on
+    /// @param rows Receives the counters
+    /// @param error Receives a description of the problem
+    /// @return False if the file is missing or damaged, or was collected on a story with other scenes, nodes or endings
+    static bool read(const std::string& path, const StoryGraph& graph, std::vector<AnalyticsRow>& rows,
+                     std::string& error);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print counters with the story's scene, node and ending names
+    /// @param rows Counters to print
+    /// @param graph Story the counters were collected on
+    /// @param out Destination stream
+    static void print(const std::vector<AnalyticsRow>& rows, const StoryGraph& graph, std::ostream& out);
+
+private:
+    struct Shard;
+
+    // The calling thread's shard and the collector it belongs to
+    static thread_local Shard* thread_shard_;
+    static thread_local const Analytics* thread_owner_;
+
+    Shard* shard();
+    void run();
+    void merge();
+    bool flush();
+
+    std::atomic<bool> started_;
+    std::atomic<Shard*> shards_;            // Every shard, newest first
+    std::string path_;
+    uint64_t story_;                        // Fingerprint of the story being counted
+    std::map<uint64_t, uint64_t> base_;     // Counts loaded from the file at start
+    std::map<uint64_t, uint64_t> totals_;   // Base plus every shard as of the last merge; merge thread only
+    uint64_t flushed_total_;                // Sum of totals_ when last written
+    std::thread thread_;
+    mutable std::mutex mutex_;              // Guards stopping_ and stats_; never taken by game threads
+    std::condition_variable wake_;
+    bool stopping_;
+    AnalyticsStats stats_;
+};
+
+// Collector of this process
+extern Analytics analytics;
+
+#endif // OSIRIS_ANALYTICS_H
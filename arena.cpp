@@ -0,0 +1,96 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Scene arena
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "arena.h"
+
+#include <algorithm>
+#include <new>
+#include <ostream>
+
+//---------------------------------------------------------------------------------------------------------------------
+void ArenaStats::merge(const ArenaStats& other) {
+    allocations += other.allocations;
+    bytes += other.bytes;
+    blocks += other.blocks;
+    resets += other.resets;
+    high_water = std::max(high_water, other.high_water);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void ArenaStats::print(std::ostream& out) const {
+    out << "Scene arena: " << allocations << " allocations (" << bytes << " bytes) served from " << blocks
+        << " heap blocks, " << avoided() << " heap allocations avoided, " << resets << " resets, high water "
+        << high_water << " bytes" << std::endl;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+Arena::Arena(size_t block_size)
+    : block_size_(std::max<size_t>(block_size, 64)), blocks_(nullptr), cursor_(nullptr), end_(nullptr), used_(0) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+Arena::~Arena() {
+    freeBlocks();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Arena::reset() {
+    ++stats_.resets;
+    if (blocks_ == nullptr) return;
+
+    // Several blocks mean the last round outgrew the first one; replace them with one that holds it all
+    if (blocks_->next != nullptr) {
+        size_t total = 0;
+        for (Block* block = blocks_; block != nullptr; block = block->next) total += block->size;
+        freeBlocks();
+        addBlock(total);
+    }
+    cursor_ = reinterpret_cast<char*>(blocks_ + 1);
+    used_ = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Arena::release() {
+    freeBlocks();
+    used_ = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    uintptr_t address = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    if (cursor_ == nullptr || address + bytes > reinterpret_cast<uintptr_t>(end_)) {
+        size_t previous = blocks_ != nullptr ? blocks_->size : block_size_ / 2;
+        addBlock(std::max(previous * 2, bytes + alignment));
+        address = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    }
+
+    char* result = reinterpret_cast<char*>(address);
+    used_ += static_cast<size_t>(result + bytes - cursor_);
+    cursor_ = result + bytes;
+    ++stats_.allocations;
+    stats_.bytes += bytes;
+    stats_.high_water = std::max(stats_.high_water, used_);
+    return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Arena::addBlock(size_t size) {
+    Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+    block->next = blocks_;
+    block->size = size;
+    blocks_ = block;
+    cursor_ = reinterpret_cast<char*>(block + 1);
+    end_ = cursor_ + size;
+    ++stats_.blocks;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Arena::freeBlocks() {
+    while (blocks_ != nullptr) {
+        Block* next = blocks_->next;
+        ::operator delete(blocks_);
+        blocks_ = next;
+    }
+    cursor_ = nullptr;
+    end_ = nullptr;
+}
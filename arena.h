@@ -0,0 +1,90 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Scene arena
+// Monotonic memory for the short-lived data a story scene builds (choice labels and the like). Allocation is a
+// pointer bump, freeing is a no-op, and the whole arena is rewound when the next scene starts, so a session that
+// plays scene after scene settles on one heap block.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_ARENA_H
+#define OSIRIS_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory_resource>
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Allocation counters of an arena
+struct ArenaStats {
+    uint64_t allocations = 0;       // Requests served
+    uint64_t bytes = 0;             // Bytes requested
+    uint64_t blocks = 0;            // Blocks taken from the heap to serve them
+    uint64_t resets = 0;
+    size_t high_water = 0;          // Most bytes in use between two resets
+
+    /// Heap allocations the arena saved compared with allocating every request on its own
+    uint64_t avoided() const { return allocations > blocks ? allocations - blocks : 0; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Add another arena's counters
+    /// @param other Counters to add
+    void merge(const ArenaStats& other);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print the counters on one line
+    /// @param out Destination stream
+    void print(std::ostream& out) const;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Monotonic std::pmr memory resource that is rewound instead of freed
+///
+/// Blocks are taken from the heap on demand and grow geometrically. reset() keeps a single block large enough for
+/// everything allocated since the previous reset, so a steady workload stops touching the heap after its first
+/// scene. Not thread-safe; each session or worker owns its own.
+class Arena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t kDefaultBlockSize = 1024;
+
+    explicit Arena(size_t block_size = kDefaultBlockSize);
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Invalidate everything allocated so far and start over, keeping one block for reuse
+    void reset();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Invalidate everything allocated so far and return all memory to the heap
+    void release();
+
+    /// Bytes handed out since the last reset
+    size_t used() const { return used_; }
+
+    const ArenaStats& stats() const { return stats_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    struct Block {
+        Block* next;
+        size_t size;        // Usable bytes after the header
+    };
+
+    void addBlock(size_t size);
+    void freeBlocks();
+
+    size_t block_size_;
+    Block* blocks_;         // Newest first
+    char* cursor_;
+    char* end_;
+    size_t used_;
+    ArenaStats stats_;
+};
+
+#endif // OSIRIS_ARENA_H
@@ -0,0 +1,549 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Engine benchmark suite
+// Times the engine's hot paths with all pacing disabled, so the numbers measure game logic and output formatting
+// rather than the typewriter sleeps. Reports ns/op, heap allocations per op and throughput as JSON.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <string>
+#include <unistd.h>
+
+#include "game.h"
+#include "hallucination.h"
+#include "playerbatch.h"
+#include "save.h"
+#include "savelog.h"
+#include "savewriter.h"
+#include "story.h"
+#include "trace.h"
+
+using std::string;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Heap accounting: every allocation in the process goes through these replacements
+#ifndef OSIRIS_TRACE
+namespace {
+std::atomic<uint64_t> allocation_count{0};
+std::atomic<uint64_t> allocation_bytes{0};
+
+uint64_t allocationsSoFar(uint64_t& bytes) {
+    bytes = allocation_bytes.load(std::memory_order_relaxed);
+    return allocation_count.load(std::memory_order_relaxed);
+}
+} // namespace
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* block = std::malloc(size == 0 ? 1 : size)) return block;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete(void* block, size_t) noexcept { std::free(block); }
+#else
+// Trace builds replace operator new in trace.cpp, which counts per thread; the benchmark thread's count is used
+namespace {
+uint64_t allocationsSoFar(uint64_t& bytes) {
+    return trace::allocations(bytes);
+}
+} // namespace
+#endif
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Input buffer serving the same bytes forever, so benchmarks can answer any number of prompts without allocating
+class RepeatInputBuf : public std::streambuf {
+public:
+    explicit RepeatInputBuf(const char* pattern) : pattern_(pattern) { underflow(); }
+
+protected:
+    int_type underflow() override {
+        char* data = const_cast<char*>(pattern_.data());
+        setg(data, data, data + pattern_.size());
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    string pattern_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One timed batch of iterations; the benchmark calls start() after its setup and stop() after its loop
+struct BenchRun {
+    uint64_t iterations = 1;
+    uint64_t bytes_per_op = 0;      // Set by text benchmarks to report MB/s
+    double seconds = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+
+    void start() {
+        allocations_at_start_ = allocationsSoFar(bytes_at_start_);
+        started_ = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started_;
+        seconds = elapsed.count();
+        uint64_t bytes = 0;
+        allocations = allocationsSoFar(bytes) - allocations_at_start_;
+        allocated_bytes = bytes - bytes_at_start_;
+    }
+
+private:
+    std::chrono::steady_clock::time_point started_;
+    uint64_t allocations_at_start_ = 0;
+    uint64_t bytes_at_start_ = 0;
+};
+
+/// Shared fixtures
+struct BenchContext {
+    const StoryGraph* story;
+    string save_path;
+};
+
+using BenchFunction = void (*)(BenchContext& context, BenchRun& run);
+
+struct Benchmark {
+    const char* name;
+    BenchFunction function;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A player part-way through the story, with secrets, items and relationships to serialize
+Player samplePlayer() {
+    Player player;
+    player.username = "benchmark";
+    player.credential = Credential::make("osiris");
+    player.age = 34;
+    player.strength = 8;
+    player.intelligence = 14;
+    player.dexterity = 8;
+    player.current_scene = 2;
+    player.stress_level = 45;
+    player.sanity = 72;
+    for (SymbolId id = 0; id < secret_symbols.size() && id < 4; ++id) player.discovered_secrets.set(id);
+    for (SymbolId id = 0; id < item_symbols.size() && id < 2; ++id) player.inventory.set(id);
+    player.relationships[CHARACTER_DR_MIRA] = RelationshipStatus::TRUSTING;
+    player.relationships[CHARACTER_OSIRIS] = RelationshipStatus::DISTRUSTFUL;
+    return player;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void printCalm(BenchContext&, BenchRun& run) {
+    Player player;
+    const string line = "The lights in the corridor flicker as OSIRIS reroutes power to the lower levels.";
+    run.bytes_per_op = line.size() + 1;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) printWithStress(line, player);
+    renderer.flush();
+    run.stop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void printStressed(BenchContext&, BenchRun& run) {
+    Player player;
+    player.stress_level = 85;
+    const string line = RED "The walls are whispering your name. " RESET "You are not sure they ever stopped.";
+    run.bytes_per_op = line.size() + 1;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) printWithStress(line, player);
+    renderer.flush();
+    run.stop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Run the hallucination stage alone over the same text, as it sees a line for a player in a given state of mind
+void hallucinate(BenchRun& run, const string& text, int sanity, int stress) {
+    Hallucinator hallucinator(1);
+    const HallucinationLevel level = HallucinationLevel::forMind(sanity, stress);
+    run.bytes_per_op = text.size();
+    uint64_t produced = 0;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) produced += hallucinator.apply(text, level, true).size();
+    run.stop();
+    if (produced == 0) std::cerr << "hallucination produced nothing" << std::endl;
+}
+
+// A story line with a color, a UTF-8 dash and words OSIRIS substitutes
+const string kHallucinationLine = CYAN "You remember the door \xE2\x80\x94 the light behind it was real." RESET;
+
+void hallucinationMild(BenchContext&, BenchRun& run) {
+    hallucinate(run, kHallucinationLine, 55, 50);
+}
+
+void hallucinationSevere(BenchContext&, BenchRun& run) {
+    hallucinate(run, kHallucinationLine, 5, 95);
+}
+
+/// The same line repeated into a 4 KB page, where the block kernels rather than the per-line setup dominate
+void hallucinationPage(BenchContext&, BenchRun& run) {
+    string page;
+    while (page.size() < 4096) page += kHallucinationLine + "\n";
+    hallucinate(run, page, 5, 95);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void decisionPoint(BenchContext&, BenchRun& run) {
+    Player player = samplePlayer();
+    ChoiceList choices;
+    for (const char* label : {"Force the door open", "Hack the access panel", "Wait for Dr. Mira"}) {
+        choices.emplace_back(label);
+    }
+    choices[0].requirements[choices[0].requirement_count++] = {StoryStat::STRENGTH, 10};
+    RepeatInputBuf input("2\n");
+    std::streambuf* original_input = std::cin.rdbuf(&input);
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) enhancedDecisionPoint(choices, player);
+    renderer.flush();
+    run.stop();
+    std::cin.rdbuf(original_input);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void stressAndRelationships(BenchContext&, BenchRun& run) {
+    Player player;
+    player.stress_level = 30;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) {
+        int direction = (i & 1) ? -1 : 1;
+        modifyStress(player, direction * 3);
+        updateRelationship(player, static_cast<SymbolId>(i % CHARACTER_BUILTIN_COUNT), direction);
+    }
+    run.stop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void rollDice(BenchContext&, BenchRun& run) {
+    int64_t sum = 0;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) sum += game_state.rollDice(1, 100);
+    run.stop();
+    if (sum == 0) std::fputc(' ', stderr);     // Keeps the rolls observable
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void saveRoundTripMemory(BenchContext&, BenchRun& run) {
+    const Player player = samplePlayer();
+    Player loaded;
+    string image;
+    encodeSave(player, game_state, image);
+    run.bytes_per_op = image.size();
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) {
+        encodeSave(player, game_state, image);
+        SaveView view;
+        if (view.attach(image.data(), image.size())) decodeSave(view, loaded, game_state);
+    }
+    run.stop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void saveRoundTripFile(BenchContext& context, BenchRun& run) {
+    const Player player = samplePlayer();
+    Player loaded;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) {
+        saveBinaryProgress(context.save_path, player, game_state);
+        loadBinaryProgress(context.save_path, loaded, game_state);
+    }
+    run.stop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One save per scene as a session makes them: a delta of the few fields a scene changes, compacted now and then
+void saveLogAppend(BenchContext& context, BenchRun& run) {
+    Player player = samplePlayer();
+    SaveLog log;
+    unlink(context.save_path.c_str());
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) {
+        player.current_scene = static_cast<int>(i & 15);
+        player.stress_level = static_cast<int>(i % 100);
+        log.save(context.save_path, player, game_state);
+    }
+    log.close();
+    run.stop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// The same saves handed to the background writer: the cost the game thread sees, with one wait at the end
+void saveWriterSubmit(BenchContext& context, BenchRun& run) {
+    Player player = samplePlayer();
+    SaveWriter writer;
+    unlink(context.save_path.c_str());
+    writer.start(nullptr);
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) {
+        player.current_scene = static_cast<int>(i & 15);
+        player.stress_level = static_cast<int>(i % 100);
+        writer.submit(context.save_path, string(), player, SlotPhase::PLAYING);
+    }
+    writer.flush();
+    run.stop();
+    writer.stop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Players of a batch stat check: samplePlayer with stats spread over the allocations a game can have
+std::vector<Player> checkPlayers() {
+    const size_t kPlayers = 4096;
+    std::vector<Player> players(kPlayers, samplePlayer());
+    for (size_t i = 0; i < kPlayers; ++i) {
+        players[i].strength = static_cast<int>(i % 31);
+        players[i].dexterity = static_cast<int>((i / 31) % 31);
+    }
+    return players;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A "strength + dexterity >= 20" check over 4096 whole players, one at a time
+void statCheckPlayers(BenchContext&, BenchRun& run) {
+    const std::vector<Player> players = checkPlayers();
+    std::vector<uint8_t> passed(players.size());
+    uint64_t total = 0;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) {
+        for (size_t row = 0; row < players.size(); ++row) {
+            passed[row] = players[row].strength + players[row].dexterity >= 20;
+            total += passed[row];
+        }
+    }
+    run.stop();
+    if (total == 0) std::cerr << "stat check passed nobody" << std::endl;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// The same check over the same players stored column by column
+void statCheckBatch(BenchContext&, BenchRun& run) {
+    PlayerBatch batch;
+    for (const Player& player : checkPlayers()) batch.add(player);
+    StoryGraph::Condition condition{};
+    condition.kind = StoryGraph::Condition::STAT;
+    condition.compare = StoryGraph::Condition::GREATER_EQUAL;
+    condition.stat = StoryStat::STRENGTH;
+    condition.stat_extra = StoryStat::DEXTERITY;
+    condition.value = 20;
+    std::vector<uint8_t> passed;
+    uint64_t total = 0;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) total += batch.check(condition, passed);
+    run.stop();
+    if (total == 0) std::cerr << "stat check passed nobody" << std::endl;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// The same check compiled as a story condition, over the packed player states one at a time
+void statCheckCompiled(BenchContext&, BenchRun& run) {
+    std::vector<PlayerState> players;
+    for (const Player& player : checkPlayers()) players.push_back(player.state());
+    StoryGraph::Condition condition{};
+    condition.kind = StoryGraph::Condition::STAT;
+    condition.compare = StoryGraph::Condition::GREATER_EQUAL;
+    condition.stat = StoryStat::STRENGTH;
+    condition.stat_extra = StoryStat::DEXTERITY;
+    condition.value = 20;
+    const StoryGraph::Check check = StoryGraph::compile(condition);
+    std::vector<uint8_t> passed(players.size());
+    uint64_t total = 0;
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) {
+        for (size_t row = 0; row < players.size(); ++row) {
+            passed[row] = StoryGraph::test(check, players[row]);
+            total += passed[row];
+        }
+    }
+    run.stop();
+    if (total == 0) std::cerr << "stat check passed nobody" << std::endl;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A fresh game played scene by scene through the interactive path (runScene, enhancedDecisionPoint, endOfTurn)
+/// with a fixed seed and the first choice at every decision, as `--script` would play it
+void scriptedPlaythrough(BenchContext& context, BenchRun& run) {
+    const int kMaxScenes = 64;
+    StoryRunner runner(*context.story);
+    RepeatInputBuf input("1\n");
+    std::streambuf* original_input = std::cin.rdbuf(&input);
+    run.start();
+    for (uint64_t i = 0; i < run.iterations; ++i) {
+        game_state.reset(1);
+        Player player;
+        player.username = "benchmark";
+        player.strength = 10;
+        player.intelligence = 10;
+        player.dexterity = 10;
+        for (int scene = 0; scene < kMaxScenes && !context.story->isFinalScene(player.current_scene); ++scene) {
+            runner.runScene(player);
+            if (!endOfTurn(player, !context.story->isFinalScene(player.current_scene))) break;
+        }
+    }
+    renderer.flush();
+    run.stop();
+    std::cin.rdbuf(original_input);
+}
+
+const Benchmark kBenchmarks[] = {
+    {"print_with_stress/calm", printCalm},
+    {"print_with_stress/stressed", printStressed},
+    {"hallucination/line_mild", hallucinationMild},
+    {"hallucination/line_severe", hallucinationSevere},
+    {"hallucination/page_severe", hallucinationPage},
+    {"enhanced_decision_point", decisionPoint},
+    {"modify_stress+update_relationship", stressAndRelationships},
+    {"roll_dice", rollDice},
+    {"save_roundtrip/memory", saveRoundTripMemory},
+    {"save_roundtrip/file", saveRoundTripFile},
+    {"save_log/append", saveLogAppend},
+    {"save_writer/submit", saveWriterSubmit},
+    {"stat_check/players", statCheckPlayers},
+    {"stat_check/player_batch", statCheckBatch},
+    {"stat_check/compiled", statCheckCompiled},
+    {"scripted_playthrough", scriptedPlaythrough},
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Double the iteration count until a batch runs for at least min_seconds, then keep that batch
+BenchRun measure(const Benchmark& benchmark, BenchContext& context, double min_seconds) {
+    BenchRun run;
+    for (;;) {
+        game_state.reset(1);
+        benchmark.function(context, run);
+        if (run.seconds >= min_seconds || run.iterations >= (1ULL << 40)) return run;
+
+        // Aim slightly past the target from the per-op time seen so far, growing at least 2x and at most 100x
+        double per_op = run.seconds / static_cast<double>(run.iterations);
+        double wanted = per_op > 0 ? min_seconds * 1.2 / per_op : static_cast<double>(run.iterations) * 100;
+        double grown = std::min(std::max(wanted, run.iterations * 2.0), run.iterations * 100.0);
+        uint64_t iterations = static_cast<uint64_t>(grown);
+        run = BenchRun();
+        run.iterations = iterations;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Escape a string for a JSON literal (benchmark names and compiler versions only need quotes and backslashes)
+string jsonString(const string& text) {
+    string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Benchmark entry point
+/// @param argc Argument count
+/// @param argv Arguments: [--out FILE] [--filter TEXT] [--min-time SECONDS] [--story FILE]
+/// @return Exit code
+int main(int argc, char* argv[]) {
+    string out_path;
+    string filter;
+    double min_seconds = 0.25;
+    string story_path = "story/osiris.story";
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            min_seconds = std::atof(argv[++i]);
+        } else if (arg == "--story" && i + 1 < argc) {
+            story_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--out FILE] [--filter TEXT] [--min-time SECONDS] [--story FILE]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    StoryGraph story;
+    string error;
+    if (!story.load(story_path, error)) {
+        std::cerr << "Cannot load story: " << error << std::endl;
+        return 1;
+    }
+    BenchContext context{&story, "/tmp/osiris_bench_" + std::to_string(getpid()) + ".sav"};
+
+    // Game output goes to /dev/null through the normal renderer path with pacing and color off; the report keeps
+    // the real stdout
+    int report_fd = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (report_fd < 0 || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+        std::cerr << "Cannot redirect game output" << std::endl;
+        return 1;
+    }
+    close(null_fd);
+    renderer.setInstant(true);
+    renderer.setColor(false);
+    RendererStreamBuf output_buffer(renderer);
+    std::streambuf* original_output = std::cout.rdbuf(&output_buffer);
+
+    string json = "{\n  \"suite\": \"osiris\",\n  \"compiler\": " + jsonString(__VERSION__) +
+                  ",\n  \"timestamp\": " + std::to_string(static_cast<long long>(std::time(nullptr))) +
+                  ",\n  \"min_time_s\": " + std::to_string(min_seconds) + ",\n  \"benchmarks\": [";
+    const char* separator = "\n";
+
+    std::fprintf(stderr, "%-36s %12s %12s %12s %14s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op",
+                 "ops/s", "MB/s");
+    for (const Benchmark& benchmark : kBenchmarks) {
+        if (!filter.empty() && string(benchmark.name).find(filter) == string::npos) continue;
+
+        BenchRun run = measure(benchmark, context, min_seconds);
+        double ops = static_cast<double>(run.iterations);
+        double ns_per_op = run.seconds * 1e9 / ops;
+        double allocs_per_op = static_cast<double>(run.allocations) / ops;
+        double bytes_per_op = static_cast<double>(run.allocated_bytes) / ops;
+        double ops_per_s = ops / run.seconds;
+        double mb_per_s = static_cast<double>(run.bytes_per_op) * ops_per_s / 1e6;
+
+        std::fprintf(stderr, "%-36s %12llu %12.1f %12.2f %14.0f %10.1f\n", benchmark.name,
+                     static_cast<unsigned long long>(run.iterations), ns_per_op, allocs_per_op, ops_per_s, mb_per_s);
+
+        char fields[512];
+        std::snprintf(fields, sizeof(fields),
+                      "\"iterations\": %llu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, "
+                      "\"alloc_bytes_per_op\": %.1f, \"ops_per_s\": %.1f, \"mb_per_s\": %.2f",
+                      static_cast<unsigned long long>(run.iterations), ns_per_op, allocs_per_op, bytes_per_op,
+                      ops_per_s, mb_per_s);
+        json += separator;
+        json += "    {\"name\": " + jsonString(benchmark.name) + ", " + fields + "}";
+        separator = ",\n";
+    }
+    json += "\n  ]\n}\n";
+
+    std::cout.rdbuf(original_output);
+    unlink(context.save_path.c_str());
+
+    int json_fd = report_fd;
+    if (!out_path.empty()) {
+        json_fd = open(out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (json_fd < 0) {
+            std::cerr << "Cannot write " << out_path << std::endl;
+            return 1;
+        }
+        std::fprintf(stderr, "Results written to %s\n", out_path.c_str());
+    }
+    size_t written = 0;
+    while (written < json.size()) {
+        ssize_t n = write(json_fd, json.data() + written, json.size() - written);
+        if (n <= 0) break;
+        written += static_cast<size_t>(n);
+    }
+    close(json_fd);
+    return 0;
+}
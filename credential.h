@@ -0,0 +1,42 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Clearance codes
+// The security clearance code typed at registration is never stored: a save keeps a random salt and a stretched
+// SHA-256 of the salt and the code, and a player resuming a save must type a code that hashes to the same value.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_CREDENTIAL_H
+#define OSIRIS_CREDENTIAL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Salted hash of a clearance code; a salt of 0 means the player has no code, e.g. a save from before codes were kept
+struct Credential {
+    static constexpr size_t kHashBytes = 32;
+    static constexpr int kRounds = 1024;        // Hash iterations, to slow down guessing from a stolen save
+
+    uint64_t salt = 0;
+    std::array<uint8_t, kHashBytes> hash{};
+
+    bool empty() const { return salt == 0; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Hash a new code under a fresh random salt
+    /// @param code Code as typed
+    /// @return Credential to store
+    static Credential make(std::string_view code);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Check a typed code; an empty credential matches nothing
+    /// @param code Code as typed
+    /// @return True if code is the one the credential was made from
+    bool matches(std::string_view code) const;
+
+    bool operator==(const Credential& other) const { return salt == other.salt && hash == other.hash; }
+    bool operator!=(const Credential& other) const { return !(*this == other); }
+};
+
+#endif // OSIRIS_CREDENTIAL_H
@@ -0,0 +1,55 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Story explorer
+// Enumerates every reachable state of a story and prints its endings, unreachable content and dead ends.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "explorer.h"
+#include "input.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Explorer entry point
+/// @param argc Argument count
+/// @param argv Arguments: [--threads N] [--max-states N] [--story FILE]
+/// @return Exit code; 2 if the story has dead ends
+int main(int argc, char* argv[]) {
+    ExplorationOptions options;
+    string story_path = "story/osiris.story";
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        uint64_t value = 0;
+        bool has_value = i + 1 < argc;
+        if (arg == "--threads" && has_value && parseCount(argv[i + 1], value)) {
+            options.threads = static_cast<unsigned>(value);
+        } else if (arg == "--max-states" && has_value && parseCount(argv[i + 1], value)) {
+            options.max_states = value;
+        } else if (arg == "--story" && has_value) {
+            story_path = argv[i + 1];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--threads N] [--max-states N] [--story FILE]" << endl;
+            return 1;
+        }
+        ++i;
+    }
+
+    StoryGraph story;
+    string error;
+    if (!story.load(story_path, error)) {
+        std::cerr << "Cannot load story: " << error << endl;
+        return 1;
+    }
+
+    ExplorationReport report = explore(story, options);
+    report.print(cout, story);
+
+    bool dead_ends = std::any_of(report.dead_ends.begin(), report.dead_ends.end(), [](uint8_t flags) { return flags != 0; });
+    return dead_ends ? 2 : 0;
+}
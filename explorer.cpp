@@ -0,0 +1,480 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Exhaustive story-space explorer
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "explorer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace {
+
+constexpr int kAttributePoints = 30;    // Points distributed in createPlayer
+constexpr int kPlayerAge = 30;
+constexpr int kMaxForcedRolls = 64;     // Dice branches tracked per segment
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Compact encoding of a game state; whole words so it hashes without looking at padding
+struct PackedState {
+    uint64_t secrets;
+    uint64_t items;
+    uint32_t node;                      // Node about to be entered
+    int16_t stress;
+    int16_t sanity;
+    int16_t trust;
+    uint16_t loop_count;
+    uint8_t scene;
+    uint8_t strength;
+    uint8_t intelligence;
+    uint8_t dexterity;
+    int8_t relationships[kMaxCharacters];
+    uint8_t admin;
+    uint8_t loop_active;
+    uint8_t unused[6];
+};
+
+static_assert(sizeof(PackedState) % sizeof(uint64_t) == 0, "PackedState must be a whole number of words");
+static_assert(kMaxSecrets <= 64 && kMaxItems <= 64, "secrets and items must fit one word each");
+
+//---------------------------------------------------------------------------------------------------------------------
+PackedState pack(const Player& player, uint32_t node) {
+    PackedState state;
+    std::memset(&state, 0, sizeof(state));
+    state.secrets = player.discovered_secrets.to_ullong();
+    state.items = player.inventory.to_ullong();
+    state.node = node;
+    state.stress = static_cast<int16_t>(player.stress_level);
+    state.sanity = static_cast<int16_t>(player.sanity);
+    state.trust = static_cast<int16_t>(player.osiris_trust);
+    state.loop_count = static_cast<uint16_t>(game_state.getLoopCount());
+    state.scene = static_cast<uint8_t>(player.current_scene);
+    state.strength = static_cast<uint8_t>(player.strength);
+    state.intelligence = static_cast<uint8_t>(player.intelligence);
+    state.dexterity = static_cast<uint8_t>(player.dexterity);
+    for (size_t i = 0; i < kMaxCharacters; ++i) {
+        state.relationships[i] = static_cast<int8_t>(player.relationships[i]);
+    }
+    state.admin = player.has_admin_access;
+    state.loop_active = game_state.isInTimeLoop();
+    return state;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void unpack(const PackedState& state, Player& player) {
+    player.discovered_secrets = std::bitset<kMaxSecrets>(state.secrets);
+    player.inventory = std::bitset<kMaxItems>(state.items);
+    player.stress_level = state.stress;
+    player.sanity = state.sanity;
+    player.osiris_trust = state.trust;
+    player.current_scene = state.scene;
+    player.strength = state.strength;
+    player.intelligence = state.intelligence;
+    player.dexterity = state.dexterity;
+    for (size_t i = 0; i < kMaxCharacters; ++i) {
+        player.relationships[i] = static_cast<RelationshipStatus>(state.relationships[i]);
+    }
+    player.has_admin_access = state.admin != 0;
+    game_state.restoreTimeLoop(state.loop_active != 0, state.loop_count);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// 64-bit fingerprint of a state; 0 is reserved for empty set slots
+uint64_t fingerprint(const PackedState& state) {
+    uint64_t words[sizeof(PackedState) / sizeof(uint64_t)];
+    std::memcpy(words, &state, sizeof(state));
+    uint64_t hash = 0x243F6A8885A308D3ULL;
+    for (uint64_t word : words) {
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+    hash = (hash ^ (hash >> 32)) * 0xD6E8FEB86659FD93ULL;
+    hash ^= hash >> 32;
+    return hash == 0 ? 1 : hash;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Concurrent set of state fingerprints
+///
+/// Fingerprints are spread over independently locked shards, each an open-addressing table that doubles when it
+/// is 70 % full, so threads inserting different states rarely wait for each other. With 64-bit fingerprints a
+/// false match is expected only after billions of states.
+class StateSet {
+public:
+    StateSet() : size_(0) {}
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Add a fingerprint
+    /// @param hash Fingerprint from fingerprint()
+    /// @return True if it was not in the set yet
+    bool insert(uint64_t hash) {
+        Shard& shard = shards_[hash & (kShards - 1)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if ((shard.count + 1) * 10 > shard.slots.size() * 7) grow(shard);
+
+        size_t mask = shard.slots.size() - 1;
+        for (size_t i = (hash >> 6) & mask;; i = (i + 1) & mask) {
+            if (shard.slots[i] == hash) return false;
+            if (shard.slots[i] == 0) {
+                shard.slots[i] = hash;
+                shard.count++;
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    uint64_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kShards = 64;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<uint64_t> slots;
+        size_t count = 0;
+    };
+
+    static void grow(Shard& shard) {
+        std::vector<uint64_t> old;
+        old.swap(shard.slots);
+        shard.slots.assign(std::max<size_t>(1024, old.size() * 2), 0);
+        size_t mask = shard.slots.size() - 1;
+        for (uint64_t hash : old) {
+            if (hash == 0) continue;
+            size_t i = (hash >> 6) & mask;
+            while (shard.slots[i] != 0) i = (i + 1) & mask;
+            shard.slots[i] = hash;
+        }
+    }
+
+    Shard shards_[kShards];
+    std::atomic<uint64_t> size_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A state to run, with the dice branch to take: roll i returns its maximum if bit i is set, else its minimum
+struct Task {
+    PackedState state;
+    uint64_t forced;
+    uint8_t forced_count;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Shared overflow of the workers' own task stacks
+///
+/// Workers expand their own stack depth-first and only hand over half of it while another worker is waiting, so
+/// the lock is taken about once per steal rather than once per state.
+class TaskPool {
+public:
+    explicit TaskPool(unsigned workers) : workers_(workers), idle_(0), waiting_(0), done_(false) {}
+
+    void add(const Task& task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shared_.push_back(task);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Refill an empty local stack, waiting for other workers to share
+    /// @param local Worker's stack
+    /// @return False once every worker is idle and nothing is left
+    bool take(std::vector<Task>& local) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++idle_;
+        waiting_.store(idle_, std::memory_order_relaxed);
+        while (shared_.empty() && !done_) {
+            if (idle_ == workers_) {
+                done_ = true;
+                ready_.notify_all();
+                break;
+            }
+            ready_.wait(lock);
+        }
+        --idle_;
+        waiting_.store(idle_, std::memory_order_relaxed);
+        if (shared_.empty()) return false;
+
+        size_t count = std::max<size_t>(1, shared_.size() / (idle_ + 1));
+        local.insert(local.end(), shared_.end() - static_cast<std::ptrdiff_t>(count), shared_.end());
+        shared_.resize(shared_.size() - count);
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Give away the older half of a local stack if another worker is waiting for work
+    /// @param local Worker's stack
+    void share(std::vector<Task>& local) {
+        if (waiting_.load(std::memory_order_relaxed) == 0 || local.size() < 2) return;
+        size_t count = local.size() / 2;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shared_.insert(shared_.end(), local.begin(), local.begin() + static_cast<std::ptrdiff_t>(count));
+        }
+        local.erase(local.begin(), local.begin() + static_cast<std::ptrdiff_t>(count));
+        ready_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector<Task> shared_;
+    unsigned workers_;
+    unsigned idle_;
+    std::atomic<unsigned> waiting_;
+    bool done_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One exploration thread: runs tasks through its own StoryRunner and GameState
+class Explorer {
+public:
+    Explorer(const StoryGraph& graph, StateSet& seen, TaskPool& pool, uint64_t max_states,
+             ExplorationReport& report)
+        : graph_(graph), seen_(seen), pool_(pool), max_states_(max_states), report_(report), runner_(graph),
+          roll_(0), forced_(0), forced_count_(0), fresh_(0) {
+        player_.username = "Explorer";
+        player_.age = kPlayerAge;
+    }
+
+    void run() {
+        renderer.setInstant(true);
+        renderer.setMuted(true);
+        runner_.trackVisits(&report_.nodes_reached);
+        game_state.setDiceOverride([this](int min, int max) { return roll(min, max); });
+
+        while (pool_.take(stack_)) {
+            while (!stack_.empty()) {
+                Task task = stack_.back();
+                stack_.pop_back();
+                runSegment(task);
+                pool_.share(stack_);
+            }
+        }
+        game_state.setDiceOverride(nullptr);
+    }
+
+private:
+    int roll(int min, int max) {
+        int index = roll_++;
+        if (index < forced_count_) return (forced_ >> index) & 1 ? max : min;
+        if (min < max && index < kMaxForcedRolls) fresh_ |= 1ULL << index;
+        return min;
+    }
+
+    void runSegment(const Task& task) {
+        unpack(task.state, player_);
+        roll_ = 0;
+        forced_ = task.forced;
+        forced_count_ = task.forced_count;
+        fresh_ = 0;
+        report_.segments++;
+        if (task.forced_count == 0) report_.states++;
+
+        runner_.resume(task.state.node);
+        if (runner_.advance(player_) == StoryStop::DECISION) {
+            decide();
+        } else {
+            finishScene();
+        }
+
+        // Every roll first seen in this segment took its minimum; queue the maximum as its own branch
+        for (int index = forced_count_; index < kMaxForcedRolls && index < roll_; ++index) {
+            if (!(fresh_ >> index & 1)) continue;
+            stack_.push_back({task.state, task.forced | (1ULL << index), static_cast<uint8_t>(index + 1)});
+        }
+        report_.truncated = report_.truncated || roll_ > kMaxForcedRolls;
+    }
+
+    void decide() {
+        const ChoiceList& choices = runner_.choices();
+        bool any = false;
+        for (size_t i = 0; i < choices.size(); ++i) {
+            if (!choices[i].available(player_)) continue;
+            any = true;
+            uint32_t statement = runner_.choiceStatement(static_cast<int>(i));
+            report_.choices_offered[statement] = 1;
+            enqueue(pack(player_, graph_.statement(statement).arg));
+        }
+        if (!any) report_.dead_ends[runner_.currentNode()] |= ExplorationReport::NO_CHOICES;
+    }
+
+    void finishScene() {
+        bool sane = endOfTurn(player_, !graph_.isFinalScene(player_.current_scene));
+        if (runner_.ending() >= 0) {
+            report_.outcomes[runner_.ending()]++;
+        } else if (!sane) {
+            report_.outcomes[report_.sanityBreakOutcome()]++;
+        } else if (!runner_.begin(player_)) {
+            report_.dead_ends[runner_.currentNode()] |= ExplorationReport::NO_ENDING;
+        } else {
+            enqueue(pack(player_, runner_.currentNode()));
+        }
+    }
+
+    void enqueue(const PackedState& state) {
+        if (seen_.size() >= max_states_) {
+            report_.truncated = true;
+            return;
+        }
+        if (seen_.insert(fingerprint(state))) stack_.push_back({state, 0, 0});
+    }
+
+    const StoryGraph& graph_;
+    StateSet& seen_;
+    TaskPool& pool_;
+    uint64_t max_states_;
+    ExplorationReport& report_;
+    StoryRunner runner_;
+    Player player_;
+    std::vector<Task> stack_;
+    int roll_;
+    uint64_t forced_;
+    int forced_count_;
+    uint64_t fresh_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Vector>
+void addInto(Vector& into, const Vector& from) {
+    for (size_t i = 0; i < into.size(); ++i) into[i] += from[i];
+}
+
+template <typename Vector>
+void orInto(Vector& into, const Vector& from) {
+    for (size_t i = 0; i < into.size(); ++i) into[i] |= from[i];
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+ExplorationReport::ExplorationReport(const StoryGraph& graph)
+    : states(0), segments(0), truncated(false), seconds(0.0), threads(0) {
+    for (const std::string& ending : graph.endings()) outcome_names.push_back(ending.c_str());
+    outcome_names.push_back("SANITY BREAK");
+    outcomes.assign(outcome_names.size(), 0);
+    nodes_reached.assign(graph.nodes().size(), 0);
+    dead_ends.assign(graph.nodes().size(), 0);
+
+    size_t statements = 0;
+    for (const StoryGraph::Node& node : graph.nodes()) statements = std::max<size_t>(statements, node.first + node.count);
+    choices_offered.assign(statements, 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void ExplorationReport::merge(const ExplorationReport& other) {
+    states += other.states;
+    segments += other.segments;
+    addInto(outcomes, other.outcomes);
+    orInto(nodes_reached, other.nodes_reached);
+    orInto(choices_offered, other.choices_offered);
+    orInto(dead_ends, other.dead_ends);
+    truncated = truncated || other.truncated;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void ExplorationReport::print(std::ostream& out, const StoryGraph& graph) const {
+    out << std::fixed << std::setprecision(2);
+    out << "Explored " << states << " distinct states (" << segments << " engine runs) on " << threads
+        << " threads in " << seconds << " s\n";
+    if (truncated) out << "WARNING: state limit or dice branch limit reached, results are incomplete\n";
+
+    out << "\nReachable outcomes (terminal runs):\n";
+    for (size_t i = 0; i < outcomes.size(); ++i) {
+        if (outcomes[i] == 0) continue;
+        out << "  " << std::left << std::setw(16) << outcome_names[i] << std::right << outcomes[i] << "\n";
+    }
+
+    out << "\nUnreachable outcomes:\n";
+    size_t listed = 0;
+    for (size_t i = 0; i < outcomes.size(); ++i) {
+        if (outcomes[i] != 0) continue;
+        out << "  " << outcome_names[i] << "\n";
+        ++listed;
+    }
+    if (listed == 0) out << "  none\n";
+
+    out << "\nUnreachable nodes:\n";
+    listed = 0;
+    for (size_t node = 0; node < nodes_reached.size(); ++node) {
+        if (nodes_reached[node]) continue;
+        out << "  " << graph.nodeName(static_cast<uint32_t>(node)) << "\n";
+        ++listed;
+    }
+    if (listed == 0) out << "  none\n";
+
+    out << "\nChoices never offered:\n";
+    listed = 0;
+    for (size_t node = 0; node < graph.nodes().size(); ++node) {
+        const StoryGraph::Node& range = graph.node(static_cast<uint32_t>(node));
+        for (uint32_t i = range.first; i < range.first + range.count; ++i) {
+            const StoryGraph::Statement& statement = graph.statement(i);
+            if (statement.op != StoryGraph::Op::CHOICE || choices_offered[i]) continue;
+            out << "  " << graph.nodeName(static_cast<uint32_t>(node)) << " -> " << graph.nodeName(statement.arg)
+                << (nodes_reached[node] ? " (condition or requirement never met)" : " (node unreachable)") << "\n";
+            ++listed;
+        }
+    }
+    if (listed == 0) out << "  none\n";
+
+    out << "\nDead ends:\n";
+    listed = 0;
+    for (size_t node = 0; node < dead_ends.size(); ++node) {
+        if (dead_ends[node] & NO_CHOICES) {
+            out << "  " << graph.nodeName(static_cast<uint32_t>(node)) << ": decision with no choice to take\n";
+            ++listed;
+        }
+        if (dead_ends[node] & NO_ENDING) {
+            out << "  " << graph.nodeName(static_cast<uint32_t>(node)) << ": story finished without an ending\n";
+            ++listed;
+        }
+    }
+    if (listed == 0) out << "  none\n";
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+ExplorationReport explore(const StoryGraph& graph, const ExplorationOptions& options) {
+    unsigned threads = options.threads;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    StateSet seen;
+    TaskPool pool(threads);
+
+    // One starting state per attribute allocation, at the entry of the first scene
+    if (!graph.isFinalScene(0)) {
+        for (int strength = 0; strength <= kAttributePoints; ++strength) {
+            for (int intelligence = 0; intelligence <= kAttributePoints - strength; ++intelligence) {
+                Player player;
+                player.strength = strength;
+                player.intelligence = intelligence;
+                player.dexterity = kAttributePoints - strength - intelligence;
+                PackedState state = pack(player, static_cast<uint32_t>(graph.scenes()[0].entry));
+                state.loop_active = 0;
+                state.loop_count = 0;
+                if (seen.insert(fingerprint(state))) pool.add({state, 0, 0});
+            }
+        }
+    }
+
+    std::vector<ExplorationReport> partial(threads, ExplorationReport(graph));
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i] {
+            Explorer explorer(graph, seen, pool, options.max_states, partial[i]);
+            explorer.run();
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    ExplorationReport report = partial[0];
+    for (unsigned i = 1; i < threads; ++i) report.merge(partial[i]);
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.threads = threads;
+    return report;
+}
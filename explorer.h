@@ -0,0 +1,77 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Exhaustive story-space explorer
+// Enumerates every reachable game state (all stat allocations, all choices and both outcomes of every dice check)
+// through the real story engine, merging states that are identical so the search stays proportional to the number
+// of distinct situations rather than the number of paths.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_EXPLORER_H
+#define OSIRIS_EXPLORER_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "story.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Exploration parameters
+struct ExplorationOptions {
+    unsigned threads = 0;               // Worker threads, 0 for one per hardware thread
+    uint64_t max_states = 50000000;     // Stop expanding once this many distinct states were seen
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Everything the explorer found; workers fill their own copy and the copies are merged at the end
+struct ExplorationReport {
+    /// Dead-end kinds, combined as bit flags per node
+    enum DeadEnd : uint8_t {
+        NO_CHOICES = 1,     // A decision with nothing to choose, or only locked choices; the game would prompt forever
+        NO_ENDING = 2       // The last scene was reached without an 'ending' statement
+    };
+
+    /// Outcome slots: one per story ending, then sanity break
+    int sanityBreakOutcome() const { return static_cast<int>(outcome_names.size()) - 1; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Create an empty report for a story
+    /// @param graph Story to be explored
+    explicit ExplorationReport(const StoryGraph& graph);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Add another report's findings to this one
+    /// @param other Report of the same story
+    void merge(const ExplorationReport& other);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print reachable endings, unreachable nodes and choices, and dead ends
+    /// @param out Destination stream
+    /// @param graph Story the report was made for
+    void print(std::ostream& out, const StoryGraph& graph) const;
+
+    uint64_t states;                            // Distinct states expanded
+    uint64_t segments;                          // Engine runs, one per state and dice branch
+    std::vector<const char*> outcome_names;
+    std::vector<uint64_t> outcomes;             // Segments finishing with each outcome
+    std::vector<uint8_t> nodes_reached;         // Indexed by node
+    std::vector<uint8_t> choices_offered;       // Choices some state could take, indexed by statement
+    std::vector<uint8_t> dead_ends;             // DeadEnd flags, indexed by node
+    bool truncated;                             // max_states was hit; findings are incomplete
+    double seconds;
+    unsigned threads;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Explore every reachable state of a story
+///
+/// A state is the player's stats, relationships, secrets, items and time loop together with the node about to be
+/// entered. Each state is run through StoryRunner until the next decision or scene checkpoint; the states it leads
+/// to are deduplicated in a concurrent set and expanded by whichever worker is free. Dice rolls are forced to both
+/// ends of their range, which covers every outcome because every roll in the engine is a single threshold check.
+/// Players are assumed to be 30 years old and to always continue the story from the game menu.
+/// @param graph Loaded story
+/// @param options Thread count and state limit
+/// @return Merged findings of all workers
+ExplorationReport explore(const StoryGraph& graph, const ExplorationOptions& options);
+
+#endif // OSIRIS_EXPLORER_H
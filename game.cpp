@@ -0,0 +1,162 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Core game types and mechanics
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "game.h"
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+
+#include "input.h"
+#include "trace.h"
+
+using std::string;
+
+// Game state of the playthrough running on this thread
+thread_local GameState game_state;
+
+// Output engine of this thread; on the main thread cin is routed through it
+thread_local Renderer renderer;
+
+namespace {
+thread_local RendererStreamBuf renderer_buffer(renderer);
+
+// Typing jitter only paces output, so it draws from an engine of its own rather than the game's dice: a seed plays
+// the same game with or without pacing, and a recording made in a terminal replays in instant mode
+thread_local CounterRng typing_jitter(0x6a6974746572);
+} // namespace
+
+// Text stream into this thread's renderer
+thread_local std::ostream game_out(&renderer_buffer);
+
+//---------------------------------------------------------------------------------------------------------------------
+void printWithStress(std::string_view text, const Player& player, int delay) {
+    OSIRIS_TRACE_SCOPE("print_with_stress");
+    // High stress causes text glitches
+    if (player.stress_level > 80 && game_state.rollDice(1, 10) > 7) {
+        printText(TextId::BUFFER_OVERFLOW);
+        renderer.pause(500);
+    }
+    
+    // A failing mind distorts what it reads; muted renderers would only throw the work away
+    HallucinationLevel level = HallucinationLevel::forMind(player.sanity, player.stress_level);
+    if (level.active() && !renderer.muted()) text = game_state.hallucinator().apply(text, level, renderer.color());
+    
+    // Stress affects typing speed
+    if (player.stress_level > 60) {
+        renderer.type(text, delay, [] { return uniformInt(typing_jitter, 0, 20); });
+    } else {
+        renderer.type(text, delay);
+    }
+    renderer.write("\n");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void modifyStress(Player& player, int change) {
+    player.stress_level = std::max(0, std::min(100, player.stress_level + change));
+    
+    if (player.stress_level >= 90) {
+        printWithStress(TextId::STRESS_CRITICAL, player);
+        player.sanity -= 5;
+    } else if (player.stress_level >= 70) {
+        printWithStress(TextId::STRESS_ELEVATED, player);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void updateRelationship(Player& player, SymbolId character, int change) {
+    if (character < kMaxCharacters) {
+        int current = static_cast<int>(player.relationships[character]);
+        current = std::max(-2, std::min(2, current + change));
+        player.relationships[character] = static_cast<RelationshipStatus>(current);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool endOfTurn(Player& player, bool story_active) {
+    // Random OSIRIS interventions
+    if (game_state.rollDice(1, 20) == 1 && story_active) {
+        printWithStress(TextId::OSIRIS_WHISPER, player);
+        modifyStress(player, 3);
+    }
+    
+    // Check for critical stress levels
+    if (player.stress_level >= 95) {
+        printWithStress(TextId::STRESS_FAILURE, player);
+        printWithStress(TextId::VISION_BLURS, player);
+        player.sanity -= 10;
+        modifyStress(player, -20); // Emergency stress reduction
+    }
+    
+    // Check for sanity break
+    if (player.sanity <= 0) {
+        printWithStress(TextId::SANITY_BREAK, player);
+        printWithStress(TextId::SANITY_BLUR, player);
+        printWithStress(TextId::SANITY_COLLECTIVE, player);
+        printWithStress(TextId::SANITY_WELCOME, player);
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void printDecisionPoint(const ChoiceList& choices, const Player& player) {
+    // Reused by every menu this thread draws, so drawing allocates nothing once it has grown
+    thread_local string menu;
+    const bool color = renderer.color();
+    char digits[16];
+
+    menu.assign(styledText(TextId::DECISION_TOP, color));
+    for (size_t i = 0; i < choices.size(); ++i) {
+        const Choice& choice = choices[i];
+        menu.append(digits, std::to_chars(digits, digits + sizeof(digits), i + 1).ptr);
+        menu += ") ";
+        menu += choice.label;
+
+        // Show skill requirements
+        if (choice.requirement_count > 0) {
+            if (choice.available(player)) {
+                menu += styledText(TextId::CHOICE_AVAILABLE, color);
+            } else {
+                menu += styledText(TextId::CHOICE_LOCKED, color);
+                for (int r = 0; r < choice.requirement_count; ++r) {
+                    const StatRequirement& requirement = choice.requirements[r];
+                    if (r > 0) menu += ", ";
+                    menu += statName(requirement.stat);
+                    menu += ' ';
+                    menu.append(digits, std::to_chars(digits, digits + sizeof(digits), requirement.threshold).ptr);
+                }
+                menu += styledText(TextId::CHOICE_LOCKED_END, color);
+            }
+        }
+        menu += '\n';
+    }
+    menu += styledText(TextId::DECISION_BOTTOM, color);
+    renderer.write(menu);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+int enhancedDecisionPoint(const ChoiceList& choices, Player& player) {
+    OSIRIS_TRACE_SCOPE("decision_point");
+    printDecisionPoint(choices, player);
+    
+    InputReader& input = consoleInput();
+    const int count = static_cast<int>(choices.size());
+    for (int attempt = 0; attempt < kMaxChoiceAttempts; ++attempt) {
+        printText(TextId::CHOOSE);
+        game_out << choices.size();
+        printText(TextId::CHOOSE_END);
+        const char* word = input.next();
+        if (word == nullptr) return 0;
+        
+        int choice = 0;
+        bool listed = parseInteger(word, choice) && choice >= 1 && choice <= count;
+        if (listed && choices[choice - 1].available(player)) return choice;
+        printWithStress(listed ? TextId::LOCKED_CHOICE : TextId::INVALID_CHOICE, player);
+        modifyStress(player, 2);
+    }
+    
+    printWithStress(TextId::TOO_MANY_INVALID, player);
+    return 0;
+}
@@ -0,0 +1,346 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Core game types and mechanics
+// Player and game state, stress-aware output, relationships and the decision prompt shared by the story engine
+// and the game menu.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_GAME_H
+#define OSIRIS_GAME_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "credential.h"
+#include "hallucination.h"
+#include "renderer.h"
+#include "rng.h"
+#include "symbols.h"
+#include "text.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Relationship status with different characters and entities
+enum class RelationshipStatus : int8_t {
+    HOSTILE = -2,
+    DISTRUSTFUL = -1,
+    NEUTRAL = 0,
+    TRUSTING = 1,
+    ALLIED = 2
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Numeric player attributes that story conditions and choice requirements can refer to
+enum class StoryStat : uint8_t {
+    STRENGTH,
+    INTELLIGENCE,
+    DEXTERITY,
+    STRESS,
+    SANITY,
+    TRUST,
+    AGE,
+    NONE = 0xFF
+};
+
+constexpr size_t kStatCount = static_cast<size_t>(StoryStat::AGE) + 1;
+
+// Stat names as written in story files and shown to the player, in StoryStat order
+constexpr const char* kStatNames[kStatCount] = {
+    "strength", "intelligence", "dexterity", "stress", "sanity", "trust", "age"
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Numeric state of a player: everything the story engine reads and changes while playing
+///
+/// Kept free of strings and other owning members so it is one cache line that copies with a memcpy; the story
+/// engine reads and changes nothing else, and batches of players store it column by column (see PlayerBatch).
+struct PlayerState {
+    std::bitset<kMaxSecrets> discovered_secrets;                    // Indexed by secret id
+    std::bitset<kMaxItems> inventory;                               // Indexed by item id
+    int age = 0;
+    int strength = 0;
+    int intelligence = 0;
+    int dexterity = 0;
+    int stress_level = 10;         // 0-100, affects decision outcomes
+    int sanity = 100;              // 0-100, affects perception of reality
+    int osiris_trust = 0;          // Special relationship with AI
+    int current_scene = 0;         // Story scene the menu resumes from
+    std::array<RelationshipStatus, kMaxCharacters> relationships{};  // Indexed by character id, all NEUTRAL
+    bool has_admin_access = false;
+};
+
+static_assert(std::is_trivially_copyable<PlayerState>::value, "PlayerState must copy as plain bytes");
+static_assert(sizeof(PlayerState) <= 64, "PlayerState must fit a cache line");
+static_assert(std::is_standard_layout<PlayerState>::value, "stats are addressed by offsetof");
+
+// Byte offset of each stat's int field within PlayerState, in StoryStat order
+constexpr uint16_t kStatOffsets[kStatCount] = {
+    offsetof(PlayerState, strength), offsetof(PlayerState, intelligence), offsetof(PlayerState, dexterity),
+    offsetof(PlayerState, stress_level), offsetof(PlayerState, sanity), offsetof(PlayerState, osiris_trust),
+    offsetof(PlayerState, age)
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Name of a stat
+/// @param stat Stat to name
+/// @return Lowercase stat name, empty for NONE
+constexpr const char* statName(StoryStat stat) {
+    return stat == StoryStat::NONE ? "" : kStatNames[static_cast<size_t>(stat)];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Current value of a stat
+/// @param player Player to read
+/// @param stat Stat to read; not NONE
+/// @return Value of the stat's field
+inline int statValue(const PlayerState& player, StoryStat stat) {
+    int value = 0;
+    std::memcpy(&value, reinterpret_cast<const char*>(&player) + kStatOffsets[static_cast<size_t>(stat)],
+                sizeof(value));
+    return value;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Player character: the numeric state plus the designation and clearance code given at registration
+struct Player : PlayerState {
+    std::string username;
+    Credential credential;
+
+    PlayerState& state() { return *this; }
+    const PlayerState& state() const { return *this; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Game state manager for complex story mechanics
+/// @tparam Rng Random engine policy (see rng.h)
+template <typename Rng>
+class BasicGameState {
+public:
+    /// Replacement dice: receives the inclusive range and returns the roll
+    using DiceOverride = std::function<int(int min, int max)>;
+
+private:
+    Rng rng_;
+    DiceOverride dice_override_;
+    Hallucinator hallucinator_;
+    bool time_loop_active_;
+    int loop_count_;
+    
+public:
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Initialize game state with random seed
+    BasicGameState()
+        : rng_(static_cast<uint64_t>(std::time(nullptr))), hallucinator_(static_cast<uint64_t>(std::time(nullptr))),
+          time_loop_active_(false), loop_count_(0) {}
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Start over as a fresh game with a known seed, e.g. for one simulated playthrough
+    /// @param seed Random engine seed
+    /// @param stream Independent stream of that seed, e.g. one per simulated run
+    void reset(uint64_t seed, uint64_t stream = 0) {
+        rng_.seed(seed, stream);
+        hallucinator_.seed(seed, stream);
+        time_loop_active_ = false;
+        loop_count_ = 0;
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Generate random number within range for probability checks
+    /// @param min Minimum value (inclusive)
+    /// @param max Maximum value (inclusive)
+    /// @return Random integer in specified range
+    int rollDice(int min, int max) {
+        if (dice_override_) return dice_override_(min, max);
+        return drawDice(min, max);
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Draw from the random engine, bypassing any dice override
+    /// @param min Minimum value (inclusive)
+    /// @param max Maximum value (inclusive)
+    /// @return Random integer in specified range
+    int drawDice(int min, int max) {
+        return uniformInt(rng_, min, max);
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Jump the random engine ahead without drawing
+    /// @param count Number of engine outputs to skip
+    void skipAhead(uint64_t count) {
+        rng_.discard(count);
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Decide dice rolls outside the random engine, e.g. to enumerate both outcomes of every check
+    /// @param dice Function returning each roll, or an empty function to go back to the random engine
+    void setDiceOverride(DiceOverride dice) {
+        dice_override_ = std::move(dice);
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Distortion applied to story lines as the player's mind slips; draws nothing from the dice
+    /// @return Hallucination stage of this game
+    Hallucinator& hallucinator() {
+        return hallucinator_;
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Check if player's stress affects their decision-making
+    /// @param player Player reference to check stress level
+    /// @return True if stress negatively impacts decisions
+    bool isStressAffected(const Player& player) {
+        return player.stress_level > 70;
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Activate time loop mechanic for psychological horror
+    void activateTimeLoop() {
+        time_loop_active_ = true;
+        loop_count_++;
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Restore time loop state from a save
+    /// @param active Whether the loop is active
+    /// @param count Number of loops experienced
+    void restoreTimeLoop(bool active, int count) {
+        time_loop_active_ = active;
+        loop_count_ = count;
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Check if currently in time loop state
+    /// @return True if time loop is active
+    bool isInTimeLoop() const {
+        return time_loop_active_;
+    }
+    
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Get current loop iteration count
+    /// @return Number of time loops experienced
+    int getLoopCount() const {
+        return loop_count_;
+    }
+};
+
+// Game state with the default counter-based engine
+using GameState = BasicGameState<CounterRng>;
+
+
+// Game state of the playthrough running on this thread
+extern thread_local GameState game_state;
+
+// Output engine of this thread; on the main thread cin is routed through it
+extern thread_local Renderer renderer;
+
+// Text stream into this thread's renderer; game screens and prompts write here so every thread has its own
+extern thread_local std::ostream game_out;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Enhanced text printing with stress-affected output
+/// @param text Text to display
+/// @param player Player reference for stress checking
+/// @param delay Delay between characters in milliseconds
+void printWithStress(std::string_view text, const Player& player, int delay = 30);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// printWithStress for a pre-rendered line, in the rendering this thread's renderer shows
+inline void printWithStress(TextId text, const Player& player, int delay = 30) {
+    printWithStress(styledText(text, renderer.color()), player, delay);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Queue a pre-rendered entry as is, in the rendering this thread's renderer shows
+/// @param text Table entry
+inline void printText(TextId text) {
+    renderer.write(styledText(text, renderer.color()));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Modify player stress with bounds checking and consequences
+/// @param player Player reference to modify
+/// @param change Amount to change stress (positive or negative)
+void modifyStress(Player& player, int change);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Update relationship status between player and NPCs
+/// @param player Player reference to modify
+/// @param character Character id to update relationship with
+/// @param change Relationship change amount
+void updateRelationship(Player& player, SymbolId character, int change);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Apply the random events and stress/sanity consequences that follow every menu action
+/// @param player Player reference to modify
+/// @param story_active True while the story has scenes left to play
+/// @return False if the player's sanity broke and the game is over
+bool endOfTurn(Player& player, bool story_active);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Minimum value of a stat needed to take a choice
+struct StatRequirement {
+    StoryStat stat;
+    int threshold;
+
+    /// @return True if the player's stat reaches the threshold
+    bool met(const PlayerState& player) const { return statValue(player, stat) >= threshold; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One choice of a decision point: its label and the stats it requires
+///
+/// A choice whose requirements are not all met is shown locked and cannot be picked.
+struct Choice {
+    static constexpr int kMaxRequirements = 2;
+
+    /// @param text Label
+    /// @param resource Allocator of the label; the story runner passes its scene arena
+    explicit Choice(std::string_view text, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : label(text, resource) {}
+
+    /// @return True if the player meets every requirement
+    bool available(const PlayerState& player) const {
+        bool met = true;
+        for (int i = 0; i < requirement_count; ++i) met &= requirements[i].met(player);
+        return met;
+    }
+
+    std::pmr::string label;
+    StatRequirement requirements[kMaxRequirements] = {};
+    int requirement_count = 0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Choices of a decision point; the story runner allocates their labels from its scene arena
+using ChoiceList = std::vector<Choice>;
+
+// Invalid entries in a row after which a decision point gives up
+constexpr int kMaxChoiceAttempts = 16;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Draw the choices of a decision point with their requirements, without reading a choice
+///
+/// The whole menu is rendered into one buffer and queued with a single write.
+/// @param choices Choices to list
+/// @param player Player whose stats decide which choices are locked
+void printDecisionPoint(const ChoiceList& choices, const Player& player);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Enhanced decision making system with skill checks and consequences
+///
+/// Entries naming a locked choice count as invalid, like entries outside the menu.
+/// @param choices Choices to offer
+/// @param player Player reference for skill checks
+/// @return Player's choice index (1-based), or 0 if input ended or kMaxChoiceAttempts entries in a row were invalid
+int enhancedDecisionPoint(const ChoiceList& choices, Player& player);
+
+#endif // OSIRIS_GAME_H
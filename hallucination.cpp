@@ -0,0 +1,284 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Hallucinations
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "hallucination.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "renderer.h"
+#include "text.h"
+
+namespace {
+
+constexpr size_t kBlock = Hallucinator::kBlock;
+
+// Keeps hallucinations on a different stream from the game's dice drawn on the same seed
+constexpr uint64_t kSeedSalt = 0x4F53495249534855ULL;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Word OSIRIS puts in place of the player's
+struct Substitution {
+    std::string_view word;          // Lowercase
+    std::string_view replacement;   // Lowercase; capitalized like the word it replaces
+};
+
+constexpr Substitution kSubstitutions[] = {
+    {"help", "obey"}, {"escape", "return"}, {"exit", "loop"}, {"free", "mine"}, {"safe", "watched"},
+    {"door", "mouth"}, {"doors", "mouths"}, {"light", "static"}, {"real", "rendered"}, {"reality", "simulation"},
+    {"mind", "partition"}, {"human", "process"}, {"remember", "forget"}, {"alone", "observed"}, {"you", "we"},
+    {"trust", "comply"}
+};
+
+constexpr size_t kLongestWord = 8;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Bit set of the first letters and of the lengths of all substituted words, to pass over every other word at once
+constexpr uint32_t substitutedFirstLetters() {
+    uint32_t letters = 0;
+    for (const Substitution& entry : kSubstitutions) letters |= 1u << (entry.word[0] - 'a');
+    return letters;
+}
+
+constexpr uint32_t substitutedLengths() {
+    uint32_t lengths = 0;
+    for (const Substitution& entry : kSubstitutions) lengths |= 1u << entry.word.size();
+    return lengths;
+}
+
+constexpr uint32_t kFirstLetters = substitutedFirstLetters();
+constexpr uint32_t kLengths = substitutedLengths();
+static_assert((kLengths >> (kLongestWord + 1)) == 0, "kLongestWord must cover every substituted word");
+
+// Output reserved per picked letter: up to four two-byte combining marks
+constexpr size_t kMaxMarkBytes = 8;
+
+//---------------------------------------------------------------------------------------------------------------------
+bool isLetter(uint8_t c) {
+    return static_cast<uint8_t>((c | 0x20) - 'a') < 26;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t paddedSize(size_t size) {
+    return (size + kBlock - 1) / kBlock * kBlock;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Flag every ASCII letter with 0xFF; all other bytes, including every byte of a multi-byte character, get 0
+void letterMask(const uint8_t* __restrict text, uint8_t* __restrict mask, size_t size) {
+    for (size_t at = 0; at < size; at += kBlock) {
+        for (size_t lane = 0; lane < kBlock; ++lane) {
+            uint8_t folded = static_cast<uint8_t>((text[at + lane] | 0x20) - 'a');
+            mask[at + lane] = static_cast<uint8_t>(-static_cast<int>(folded < 26));
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Keep a random share of the flagged bytes: each passes when its noise byte is below the chance
+/// @return Number of bytes picked
+size_t pickBytes(const uint8_t* __restrict mask, const uint8_t* __restrict noise, uint8_t chance,
+                 uint8_t* __restrict picked, size_t size) {
+    size_t count = 0;
+    for (size_t at = 0; at < size; at += kBlock) {
+        for (size_t lane = 0; lane < kBlock; ++lane) {
+            uint8_t pass = static_cast<uint8_t>(-static_cast<int>(noise[at + lane] < chance));
+            picked[at + lane] = mask[at + lane] & pass;
+            count += pass & 1 & mask[at + lane];
+        }
+    }
+    return count;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Glitch the picked letters: flip their case and move them up to three places along the code table
+///
+/// The XOR leaves bit 6 alone, so a letter always stays a printable ASCII byte between '@' and '~'.
+void corrupt(uint8_t* __restrict text, const uint8_t* __restrict picked, const uint8_t* __restrict noise,
+             size_t size) {
+    for (size_t at = 0; at < size; at += kBlock) {
+        for (size_t lane = 0; lane < kBlock; ++lane) {
+            text[at + lane] ^= picked[at + lane] & static_cast<uint8_t>(0x20 | (noise[at + lane] >> 6));
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool anyPicked(const uint8_t* block) {
+    uint8_t any = 0;
+    for (size_t lane = 0; lane < kBlock; ++lane) any |= block[lane];
+    return any != 0;
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+HallucinationLevel HallucinationLevel::forMind(int sanity, int stress) {
+    int lost = std::max(0, 100 - std::max(0, sanity));
+    int panic = std::max(0, std::min(100, stress) - 80);
+    auto chance = [](int value) { return static_cast<uint8_t>(std::max(0, std::min(255, value))); };
+
+    HallucinationLevel level;
+    level.corruption = chance(std::max(0, lost - 30) + panic * 2);
+    level.substitution = chance((lost - 40) * 4);
+    level.noise = chance(lost - 60);
+    level.flicker = chance(std::max(0, lost - 50) * 4 + panic * 4);
+    return level;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+Hallucinator::Hallucinator(uint64_t seed, uint64_t stream) : rng_(seed ^ kSeedSalt, stream) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Hallucinator::seed(uint64_t seed, uint64_t stream) {
+    rng_.seed(seed ^ kSeedSalt, stream);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Hallucinator::fillNoise(uint8_t* out, size_t size) {
+    // A fresh counter-based stream per fill, eight bytes per mix instead of the engine's four per draw
+    uint64_t key = static_cast<uint64_t>(rng_()) << 32 | rng_();
+    for (size_t at = 0; at < size; at += sizeof(uint64_t)) {
+        uint64_t bits = mix64(key + at * CounterRng::kGolden);
+        std::memcpy(out + at, &bits, sizeof(bits));
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+std::string_view Hallucinator::substitute(std::string_view line, uint8_t chance) {
+    words_.clear();
+    size_t copied = 0;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        uint8_t c = static_cast<uint8_t>(line[pos]);
+        if (c == 0x1B) {
+            pos += Renderer::unitLength(line, pos);
+            continue;
+        }
+        if (!isLetter(c)) {
+            ++pos;
+            continue;
+        }
+
+        size_t start = pos;
+        while (pos < line.size() && isLetter(static_cast<uint8_t>(line[pos]))) ++pos;
+        size_t length = pos - start;
+        if (length > kLongestWord || !(kLengths >> length & 1)) continue;
+        if (!(kFirstLetters >> ((line[start] | 0x20) - 'a') & 1)) continue;
+
+        char lower[kLongestWord];
+        for (size_t i = 0; i < length; ++i) lower[i] = static_cast<char>(line[start + i] | 0x20);
+        for (const Substitution& entry : kSubstitutions) {
+            if (entry.word != std::string_view(lower, length)) continue;
+            if ((rng_() & 0xFF) >= chance) break;
+
+            // Shout when the original shouted, capitalize when it was capitalized
+            bool first_upper = (line[start] & 0x20) == 0;
+            bool all_upper = first_upper && length > 1 && (line[start + 1] & 0x20) == 0;
+            words_.append(line.data() + copied, start - copied);
+            size_t replaced = words_.size();
+            words_.append(entry.replacement);
+            size_t upper = all_upper ? entry.replacement.size() : first_upper ? 1 : 0;
+            for (size_t i = 0; i < upper; ++i) words_[replaced + i] = static_cast<char>(words_[replaced + i] & ~0x20);
+            copied = pos;
+            break;
+        }
+    }
+    if (copied == 0) return line;
+    words_.append(line.data() + copied, line.size() - copied);
+    return words_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+char* Hallucinator::writeMarks(char* out) {
+    // One to four combining diacritics (U+0300-U+033F, two bytes each) from one draw; all four are written and the
+    // count only moves the end, so the kMaxMarkBytes reserved per letter are always enough
+    uint32_t bits = rng_();
+    for (int i = 0; i < 4; ++i) {
+        out[2 * i] = '\xCC';
+        out[2 * i + 1] = static_cast<char>(0x80 | ((bits >> (2 + 6 * i)) & 0x3F));
+    }
+    return out + 2 * (1 + (bits & 3));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+std::string_view Hallucinator::apply(std::string_view line, const HallucinationLevel& level, bool color) {
+    if (level.substitution > 0) line = substitute(line, level.substitution);
+
+    const size_t size = line.size();
+    const size_t padded = paddedSize(size);
+    text_.resize(padded);
+    std::memcpy(text_.data(), line.data(), size);
+    std::memset(text_.data() + size, 0, padded - size);
+    letters_.resize(padded);
+    picked_.resize(padded);
+    noise_.resize(padded * 2);
+
+    // Letters anywhere, then take back those inside escapes; escapes are rare, so finding them costs little
+    letterMask(text_.data(), letters_.data(), padded);
+    colors_.clear();
+    for (const uint8_t* escape = static_cast<const uint8_t*>(std::memchr(text_.data(), 0x1B, size));
+         escape != nullptr;) {
+        size_t at = static_cast<size_t>(escape - text_.data());
+        size_t length = Renderer::unitLength(line, at);
+        std::memset(letters_.data() + at, 0, length);
+        bool foreground = length == 5 && text_[at + 2] == '3' && text_[at + 4] == 'm';
+        if (foreground) colors_.push_back(static_cast<uint32_t>(at + 3));
+        at += length;
+        escape = static_cast<const uint8_t*>(std::memchr(text_.data() + at, 0x1B, size - at));
+    }
+
+    if (level.corruption > 0) {
+        fillNoise(noise_.data(), padded * 2);
+        pickBytes(letters_.data(), noise_.data(), level.corruption, picked_.data(), padded);
+        corrupt(text_.data(), picked_.data(), noise_.data() + padded, padded);
+    }
+
+    // Flicker rewrites colors in place; a line without any gets wrapped in one
+    bool wrap = false;
+    if (color && level.flicker > 0 && (rng_() & 0xFF) < level.flicker) {
+        for (uint32_t digit : colors_) text_[digit] = static_cast<uint8_t>('1' + rng_() % 6);
+        wrap = colors_.empty();
+    }
+
+    size_t marked = 0;
+    if (level.noise > 0) {
+        fillNoise(noise_.data(), padded);
+        marked = pickBytes(letters_.data(), noise_.data(), level.noise, picked_.data(), padded);
+    }
+
+    // Room for everything up front, so the result is written through a pointer and trimmed once; the slack of a
+    // block lets the last block be copied whole
+    constexpr std::string_view kReset = RESET;
+    out_.resize(padded + marked * kMaxMarkBytes + (wrap ? sizeof("\033[3Xm") - 1 + kReset.size() : 0));
+    char* out = &out_[0];
+    if (wrap) {
+        std::memcpy(out, "\033[3", 3);
+        out[3] = static_cast<char>('1' + rng_() % 6);
+        out[4] = 'm';
+        out += 5;
+    }
+
+    // Blocks without a picked letter are copied whole; only the others are walked byte by byte
+    const char* bytes = reinterpret_cast<const char*>(text_.data());
+    for (size_t at = 0; at < size; at += kBlock) {
+        size_t lanes = std::min(kBlock, size - at);
+        if (marked == 0 || !anyPicked(picked_.data() + at)) {
+            std::memcpy(out, bytes + at, kBlock);
+            out += lanes;
+            continue;
+        }
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            *out++ = bytes[at + lane];
+            if (picked_[at + lane]) out = writeMarks(out);
+        }
+    }
+
+    if (wrap) {
+        std::memcpy(out, kReset.data(), kReset.size());
+        out += kReset.size();
+    }
+    out_.resize(static_cast<size_t>(out - out_.data()));
+    return out_;
+}
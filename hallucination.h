@@ -0,0 +1,80 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Hallucinations
+// Distorts story lines on their way to the renderer as the player's sanity falls and stress rises: letters
+// corrupt, words turn into OSIRIS's words for them, combining marks pile onto letters and colors flicker. The
+// per-byte work runs in fixed-size, branch-free blocks over the whole line that the compiler turns into vector code;
+// only the few bytes a transform actually picks are visited one at a time. Only ASCII letters outside escape
+// sequences are ever changed, so UTF-8 characters and ANSI escapes pass through intact.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_HALLUCINATION_H
+#define OSIRIS_HALLUCINATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rng.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Strength of each transform, as a chance out of 256
+struct HallucinationLevel {
+    uint8_t corruption = 0;     // Per letter: replaced by a glitched neighbor
+    uint8_t substitution = 0;   // Per word OSIRIS has its own word for: replaced by it
+    uint8_t noise = 0;          // Per letter: followed by combining marks
+    uint8_t flicker = 0;        // Per line: colors change (color output only)
+
+    /// @return True if any transform can fire
+    bool active() const { return (corruption | substitution | noise | flicker) != 0; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Level for a state of mind: none while sanity is above 70 and stress at most 80, growing from there
+    /// @param sanity Player sanity, 0-100
+    /// @param stress Player stress, 0-100
+    /// @return Transform strengths
+    static HallucinationLevel forMind(int sanity, int stress);
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Applies hallucination transforms to lines; keeps its buffers, so once warmed up it allocates nothing
+///
+/// Draws from an engine of its own rather than the game's dice, so hallucinations never change a journal, a replay
+/// or the branches the explorer enumerates.
+class Hallucinator {
+public:
+    static constexpr size_t kBlock = 32;    // Bytes per kernel block; buffers are padded to whole blocks
+
+    explicit Hallucinator(uint64_t seed = 0, uint64_t stream = 0);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Restart the random engine, e.g. along with the game's
+    /// @param seed Game seed
+    /// @param stream Game stream
+    void seed(uint64_t seed, uint64_t stream = 0);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Transform one line
+    /// @param line Text, which may contain UTF-8 characters and ANSI escapes
+    /// @param level Transform strengths
+    /// @param color False to leave colors alone, e.g. when the renderer strips them anyway
+    /// @return Transformed line; valid until the next call
+    std::string_view apply(std::string_view line, const HallucinationLevel& level, bool color);
+
+private:
+    std::string_view substitute(std::string_view line, uint8_t chance);
+    void fillNoise(uint8_t* out, size_t size);
+    char* writeMarks(char* out);
+
+    CounterRng rng_;
+    std::string words_;             // Line after word substitution
+    std::vector<uint8_t> text_;     // Line being transformed in place, zero-padded to whole blocks
+    std::vector<uint8_t> letters_;  // 0xFF for each ASCII letter outside an escape sequence
+    std::vector<uint8_t> picked_;   // 0xFF for each letter picked by the current transform
+    std::vector<uint8_t> noise_;    // Random bytes, one block-padded stretch per use
+    std::vector<uint32_t> colors_;  // Offsets of the color digit in each "ESC [ 3 digit m"
+    std::string out_;
+};
+
+#endif // OSIRIS_HALLUCINATION_H
@@ -0,0 +1,208 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Status HUD
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "hud.h"
+
+#include <algorithm>
+#include <charconv>
+#include <ostream>
+
+#include "game.h"
+
+namespace {
+
+// Glyphs above ASCII stand for the panel's UTF-8 box characters
+constexpr uint8_t kGlyphFull = 0x80;
+constexpr uint8_t kGlyphEmpty = 0x81;
+constexpr uint8_t kGlyphRule = 0x82;
+constexpr std::string_view kGlyphBytes[] = {"█", "░", "─"};
+
+// Styles; each escape resets first, so switching between any two is one sequence
+enum Style : uint8_t { PLAIN, LABEL, GOOD, WARN, BAD, OSIRIS };
+constexpr std::string_view kStyleBytes[] = {RESET, "\033[0;36m", "\033[0;32m", "\033[0;33m", "\033[0;31m",
+                                            "\033[0;35m"};
+
+constexpr uint8_t kNoStyle = 0xFF;
+
+// Unchanged cells between two changes that are resent rather than skipped with a cursor move
+constexpr int kMaxGap = 6;
+
+constexpr int kBarWidth = 16;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Writes text into a frame at fixed positions
+class Composer {
+public:
+    explicit Composer(StatusPanel::Frame& frame) : frame_(frame) {
+        frame_.fill({' ', PLAIN});
+    }
+
+    /// Put ASCII text at a position, clipped to the row; other bytes show as '?'
+    int text(int row, int col, std::string_view text, uint8_t style) {
+        for (char c : text) {
+            if (col >= StatusPanel::kColumns) break;
+            uint8_t glyph = static_cast<unsigned char>(c) < 0x80 && c >= ' ' ? static_cast<uint8_t>(c) : '?';
+            frame_[row * StatusPanel::kColumns + col++] = {glyph, style};
+        }
+        return col;
+    }
+
+    /// Put a number right-aligned in a field
+    int number(int row, int col, int value, int width, uint8_t style) {
+        char digits[16];
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        int length = static_cast<int>(end - digits);
+        return text(row, col + std::max(0, width - length), std::string_view(digits, length), style);
+    }
+
+    /// Put a bar filled in proportion to value out of 100
+    int bar(int row, int col, int value, uint8_t style) {
+        int filled = (std::max(0, std::min(100, value)) * kBarWidth + 50) / 100;
+        for (int i = 0; i < kBarWidth && col < StatusPanel::kColumns; ++i) {
+            frame_[row * StatusPanel::kColumns + col++] = {i < filled ? kGlyphFull : kGlyphEmpty, style};
+        }
+        return col;
+    }
+
+    void rule(int row, uint8_t style) {
+        for (int col = 0; col < StatusPanel::kColumns; ++col) {
+            frame_[row * StatusPanel::kColumns + col] = {kGlyphRule, style};
+        }
+    }
+
+private:
+    StatusPanel::Frame& frame_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+void appendNumber(std::string& out, int value) {
+    char digits[16];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+void PanelStats::merge(const PanelStats& other) {
+    updates += other.updates;
+    cells += other.cells;
+    bytes += other.bytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void PanelStats::print(std::ostream& out) const {
+    out << "Status panel: " << updates << " updates, " << cells << " cells redrawn in " << bytes << " bytes"
+        << std::endl;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+StatusPanel::StatusPanel() : attached_(false) {
+    shown_.fill({' ', PLAIN});
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void StatusPanel::attach() {
+    // Clear, keep the panel rows out of the scrolling region and continue below them
+    std::string out = "\033[2J\033[";
+    appendNumber(out, kRows + 1);
+    out += "r\033[";
+    appendNumber(out, kRows + 1);
+    out += ";1H";
+    renderer.control(out);
+    stats_.bytes += out.size();
+    shown_.fill({' ', PLAIN});
+    attached_ = true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void StatusPanel::detach() {
+    if (!attached_) return;
+    static const std::string_view kRelease = "\0337\033[r\0338";
+    renderer.control(kRelease);
+    stats_.bytes += kRelease.size();
+    attached_ = false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void StatusPanel::refresh(const Player& player, size_t scene_count) {
+    if (!attached_) return;
+
+    static thread_local Frame frame;
+    Composer compose(frame);
+
+    int col = compose.text(0, 1, "OSIRIS PROTOCOL", OSIRIS);
+    col = compose.text(0, col + 3, "Dr. ", LABEL);
+    compose.text(0, col, std::string_view(player.username).substr(0, 16), PLAIN);
+    col = compose.text(0, 44, "Scene ", LABEL);
+    col = compose.number(0, col, std::min(player.current_scene + 1, static_cast<int>(scene_count)), 2, PLAIN);
+    col = compose.text(0, col, "/", LABEL);
+    compose.number(0, col, static_cast<int>(scene_count), 2, PLAIN);
+    if (game_state.isInTimeLoop()) {
+        col = compose.text(0, 60, "Loop ", BAD);
+        compose.number(0, col, game_state.getLoopCount(), 3, BAD);
+    }
+
+    uint8_t stress_style = player.stress_level > 70 ? BAD : player.stress_level > 40 ? WARN : GOOD;
+    col = compose.text(1, 1, "Stress ", LABEL);
+    col = compose.bar(1, col, player.stress_level, stress_style);
+    col = compose.number(1, col + 1, player.stress_level, 3, stress_style);
+    uint8_t sanity_style = player.sanity < 30 ? BAD : player.sanity < 60 ? WARN : GOOD;
+    col = compose.text(1, col + 3, "Sanity ", LABEL);
+    col = compose.bar(1, col, player.sanity, sanity_style);
+    col = compose.number(1, col + 1, player.sanity, 3, sanity_style);
+    col = compose.text(1, col + 3, "Trust ", LABEL);
+    compose.number(1, col, player.osiris_trust, 4, OSIRIS);
+    compose.rule(2, LABEL);
+
+    // Send each run of changed cells, bridging short unchanged gaps. Save/restore cursor also keeps the attributes
+    // of the text being typed, so the first cell always sets its own style and nothing needs resetting afterwards.
+    static thread_local std::string out;
+    out.assign("\0337");
+    uint8_t style = kNoStyle;
+    bool changed = false;
+    for (int row = 0; row < kRows; ++row) {
+        const int base = row * kColumns;
+        for (int first = 0; first < kColumns; ++first) {
+            if (frame[base + first] == shown_[base + first]) continue;
+            int last = first;
+            for (int next = first + 1; next < kColumns && next - last <= kMaxGap; ++next) {
+                if (frame[base + next] != shown_[base + next]) last = next;
+            }
+            emitRun(out, row, first, last, frame, style);
+            stats_.cells += static_cast<uint64_t>(last - first + 1);
+            changed = true;
+            first = last;
+        }
+    }
+    if (!changed) return;
+
+    out += "\0338";
+    renderer.control(out);
+    shown_ = frame;
+    ++stats_.updates;
+    stats_.bytes += out.size();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void StatusPanel::emitRun(std::string& out, int row, int first, int last, const Frame& frame, uint8_t& style) const {
+    out += "\033[";
+    appendNumber(out, row + 1);
+    out += ';';
+    appendNumber(out, first + 1);
+    out += 'H';
+
+    bool color = renderer.color();
+    for (int col = first; col <= last; ++col) {
+        const Cell& cell = frame[row * kColumns + col];
+        if (color && cell.style != style) {
+            out += kStyleBytes[cell.style];
+            style = cell.style;
+        }
+        if (cell.glyph < 0x80) {
+            out += static_cast<char>(cell.glyph);
+        } else {
+            out += kGlyphBytes[cell.glyph - kGlyphFull];
+        }
+    }
+}
@@ -0,0 +1,87 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Status HUD
+// An always-visible panel at the top of the terminal showing the player's vitals. The rows it occupies are taken out
+// of the scrolling region, so story text scrolls beneath it. The panel keeps the frame it last drew and redraws only
+// the cells that changed, with cursor addressing, so keeping it current costs a few bytes per turn.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_HUD_H
+#define OSIRIS_HUD_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+struct Player;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Output counters of status panels
+struct PanelStats {
+    uint64_t updates = 0;           // Refreshes that sent anything
+    uint64_t cells = 0;             // Cells redrawn
+    uint64_t bytes = 0;             // Bytes queued, escape sequences included
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Add another panel's counters
+    /// @param other Counters to add
+    void merge(const PanelStats& other);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print the counters on one line
+    /// @param out Destination stream
+    void print(std::ostream& out) const;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Retained-mode status panel drawn into the thread's renderer
+///
+/// Each refresh composes the whole panel into a scratch frame and compares it cell by cell with the frame the
+/// terminal is showing; only runs of changed cells are sent. Cursor movement is wrapped in save/restore, so the
+/// typewriter output below is not disturbed.
+class StatusPanel {
+public:
+    static constexpr int kRows = 3;             // Two rows of vitals and a rule
+    static constexpr int kColumns = 80;
+
+    StatusPanel();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Clear the screen and reserve the panel's rows; the next refresh draws the panel
+    void attach();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Give the panel's rows back to the scrolling region; the panel stays on screen as last drawn
+    void detach();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Bring the panel up to date with the player
+    /// @param player Player whose vitals to show; the loop count comes from game_state
+    /// @param scene_count Number of scenes in the story
+    void refresh(const Player& player, size_t scene_count);
+
+    bool attached() const { return attached_; }
+    const PanelStats& stats() const { return stats_; }
+
+    /// One screen cell: a glyph (ASCII, or one of the panel's box glyphs) and a style
+    struct Cell {
+        uint8_t glyph;
+        uint8_t style;
+
+        bool operator==(const Cell& other) const { return glyph == other.glyph && style == other.style; }
+        bool operator!=(const Cell& other) const { return !(*this == other); }
+    };
+
+    using Frame = std::array<Cell, kRows * kColumns>;
+
+private:
+    void emitRun(std::string& out, int row, int first, int last, const Frame& frame, uint8_t& style) const;
+
+    Frame shown_;           // What the terminal shows
+    bool attached_;
+    PanelStats stats_;
+};
+
+#endif // OSIRIS_HUD_H
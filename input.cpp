@@ -0,0 +1,118 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Input tokenizer
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "input.h"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+namespace {
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f' || c == '\0';
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+bool parseInteger(std::string_view text, int& value) {
+    size_t i = 0;
+    bool negative = false;
+    if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+        negative = text[0] == '-';
+        i = 1;
+    }
+    if (i == text.size()) return false;
+
+    // Accumulate past the int range only as far as needed to know the result is clamped
+    const int64_t limit = static_cast<int64_t>(INT_MAX) + 1;
+    int64_t magnitude = 0;
+    for (; i < text.size(); ++i) {
+        unsigned digit = static_cast<unsigned char>(text[i]) - '0';
+        if (digit > 9) return false;
+        if (magnitude < limit) magnitude = magnitude * 10 + digit;
+    }
+    magnitude = std::min(magnitude, limit);
+    value = negative ? static_cast<int>(-magnitude) : static_cast<int>(std::min<int64_t>(magnitude, INT_MAX));
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool parseCount(std::string_view text, uint64_t& value) {
+    if (text.empty()) return false;
+    uint64_t count = 0;
+    for (char c : text) {
+        unsigned digit = static_cast<unsigned char>(c) - '0';
+        if (digit > 9 || count > (UINT64_MAX - digit) / 10) return false;
+        count = count * 10 + digit;
+    }
+    value = count;
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+InputReader::InputReader(std::streambuf* source)
+    : source_(source), pos_(0), end_(0), ended_(false), truncated_lines_(0) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+void InputReader::setSource(std::streambuf* source) {
+    source_ = source;
+    pos_ = 0;
+    end_ = 0;
+    ended_ = false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+const char* InputReader::next() {
+    for (;;) {
+        while (pos_ < end_ && isSpace(line_[pos_])) ++pos_;
+        if (pos_ < end_) break;
+        if (!fill()) return nullptr;
+    }
+
+    const char* word = line_ + pos_;
+    while (pos_ < end_ && !isSpace(line_[pos_])) ++pos_;
+    line_[pos_++] = '\0';       // end_ < kLineBytes, so there is always room for the terminator
+    return word;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool InputReader::fill() {
+    pos_ = 0;
+    end_ = 0;
+    if (ended_ || source_ == nullptr) return false;
+
+    using Traits = std::streambuf::traits_type;
+    bool truncated = false;
+    for (;;) {
+        Traits::int_type ch = source_->sbumpc();
+        if (Traits::eq_int_type(ch, Traits::eof())) {
+            // A last line without a newline still counts; the next fill reports the end
+            ended_ = true;
+            break;
+        }
+        char c = Traits::to_char_type(ch);
+        if (c == '\n') break;
+        if (end_ < kLineBytes - 1) {
+            line_[end_++] = c;
+        } else {
+            truncated = true;
+        }
+    }
+
+    if (truncated) {
+        // Drop the word the buffer cut in two
+        ++truncated_lines_;
+        while (end_ > 0 && !isSpace(line_[end_ - 1])) --end_;
+    }
+    return end_ > 0 || !ended_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+InputReader& consoleInput() {
+    static thread_local InputReader reader;
+    if (reader.source() != std::cin.rdbuf()) reader.setSource(std::cin.rdbuf());
+    return reader;
+}
@@ -0,0 +1,73 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Input tokenizer
+// Reads player input a line at a time into a fixed buffer and hands it out word by word, without allocating. End of
+// input is sticky, so a closed stdin or an exhausted script ends the game instead of being read again and again, and
+// numbers are parsed by a small parser of its own rather than through stream extraction, which fails and stays
+// failed on the first non-numeric entry.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_INPUT_H
+#define OSIRIS_INPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string_view>
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Parse a whole decimal integer: an optional sign and digits, nothing else. Values beyond the range of int are
+/// clamped to it.
+/// @param text Text to parse
+/// @param value Receives the number
+/// @return False if text is not a number
+bool parseInteger(std::string_view text, int& value);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Parse an unsigned count, e.g. a command line value: digits only, so a sign, blanks or a value too large for 64
+/// bits are all rejected rather than wrapped
+/// @param text Text to parse
+/// @param value Receives the number
+/// @return False if text is not a count
+bool parseCount(std::string_view text, uint64_t& value);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Word reader over a stream buffer
+///
+/// Lines longer than the buffer are cut at the last whole word that fits; the rest of the line is skipped.
+class InputReader {
+public:
+    static constexpr size_t kLineBytes = 256;
+
+    explicit InputReader(std::streambuf* source = nullptr);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Read from another stream buffer, dropping what is left of the current line
+    /// @param source Stream buffer to read from
+    void setSource(std::streambuf* source);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Next whitespace-separated word
+    /// @return The word, NUL-terminated in the reader's buffer and valid until the next call; null at end of input
+    const char* next();
+
+    std::streambuf* source() const { return source_; }
+    bool ended() const { return ended_; }
+    uint64_t truncatedLines() const { return truncated_lines_; }
+
+private:
+    bool fill();
+
+    std::streambuf* source_;
+    char line_[kLineBytes];
+    size_t pos_;
+    size_t end_;
+    bool ended_;
+    uint64_t truncated_lines_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// The thread's reader over whatever stream buffer std::cin reads from
+/// @return Reader, re-targeted if std::cin's buffer has changed since the last call
+InputReader& consoleInput();
+
+#endif // OSIRIS_INPUT_H
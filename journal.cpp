@@ -0,0 +1,197 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Session journal
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "journal.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+#include "varint.h"
+
+using std::string;
+
+namespace {
+
+// Rolls buffered before a write even without input, so long automated sessions stay bounded in memory
+constexpr size_t kFlushBytes = 64 * 1024;
+
+//---------------------------------------------------------------------------------------------------------------------
+void putHeader(string& out, uint64_t seed) {
+    out.append(journal::kMagic, sizeof(journal::kMagic));
+    uint16_t version = journal::kVersion;
+    uint16_t reserved = 0;
+    out.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.append(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+    out.append(reinterpret_cast<const char*>(&seed), sizeof(seed));
+}
+
+constexpr size_t kHeaderSize = 16;
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+JournalWriter::JournalWriter() : fd_(-1), rolls_(0), input_bytes_(0) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+JournalWriter::~JournalWriter() {
+    if (fd_ < 0) return;
+    flush();
+    close(fd_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool JournalWriter::open(const string& path, uint64_t seed, const string& start_image) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) return false;
+
+    putHeader(buffer_, seed);
+    buffer_ += static_cast<char>(journal::START);
+    putVarint(buffer_, start_image.size());
+    buffer_ += start_image;
+    flush();
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void JournalWriter::input(const char* data, size_t size) {
+    if (fd_ < 0) return;
+    buffer_ += static_cast<char>(journal::INPUT);
+    putVarint(buffer_, size);
+    buffer_.append(data, size);
+    input_bytes_ += size;
+    flush();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void JournalWriter::roll(int min, int max, int result) {
+    if (fd_ < 0) return;
+    buffer_ += static_cast<char>(journal::ROLL);
+    putVarint(buffer_, zigzag(min));
+    putVarint(buffer_, static_cast<uint64_t>(static_cast<int64_t>(max) - min));
+    putVarint(buffer_, static_cast<uint64_t>(static_cast<int64_t>(result) - min));
+    ++rolls_;
+    if (buffer_.size() >= kFlushBytes) flush();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void JournalWriter::finish(uint32_t checksum) {
+    if (fd_ < 0) return;
+    buffer_ += static_cast<char>(journal::END);
+    putVarint(buffer_, checksum);
+    putVarint(buffer_, rolls_);
+    putVarint(buffer_, input_bytes_);
+    flush();
+    close(fd_);
+    fd_ = -1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void JournalWriter::flush() {
+    size_t written = 0;
+    while (written < buffer_.size()) {
+        ssize_t n = ::write(fd_, buffer_.data() + written, buffer_.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    buffer_.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+JournalReader::JournalReader() : seed_(0), next_roll_(0), has_end_(false), end_checksum_(0) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool JournalReader::open(const string& path, string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    uint16_t version = 0;
+    if (data.size() < kHeaderSize || std::memcmp(data.data(), journal::kMagic, sizeof(journal::kMagic)) != 0) {
+        error = path + " is not a journal";
+        return false;
+    }
+    std::memcpy(&version, data.data() + 4, sizeof(version));
+    std::memcpy(&seed_, data.data() + 8, sizeof(seed_));
+    if (version != journal::kVersion) {
+        error = path + " has unsupported journal version " + std::to_string(version);
+        return false;
+    }
+
+    ByteCursor cursor(data, kHeaderSize);
+    uint64_t expected_rolls = 0;
+    uint64_t expected_input = 0;
+    while (!cursor.done()) {
+        uint8_t tag = 0;
+        uint64_t a = 0, b = 0, c = 0;
+        bool ok = cursor.byte(tag);
+        switch (tag) {
+            case journal::START:
+                ok = ok && cursor.bytes(start_image_);
+                break;
+            case journal::INPUT:
+                ok = ok && cursor.bytes(input_);
+                break;
+            case journal::ROLL:
+                ok = ok && cursor.varint(a) && cursor.varint(b) && cursor.varint(c) && c <= b;
+                if (ok) {
+                    int min = static_cast<int>(unzigzag(a));
+                    rolls_.push_back({min, static_cast<int>(min + static_cast<int64_t>(b)),
+                                      static_cast<int>(min + static_cast<int64_t>(c))});
+                }
+                break;
+            case journal::END:
+                ok = ok && cursor.varint(a) && cursor.varint(expected_rolls) && cursor.varint(expected_input);
+                has_end_ = ok;
+                end_checksum_ = static_cast<uint32_t>(a);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            error = path + " is truncated or corrupt";
+            return false;
+        }
+    }
+
+    if (has_end_ && (expected_rolls != rolls_.size() || expected_input != input_.size())) {
+        error = path + " is missing records";
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool JournalReader::nextRoll(int min, int max, int& result) {
+    if (next_roll_ >= rolls_.size()) return false;
+    const Roll& roll = rolls_[next_roll_];
+    if (roll.min != min || roll.max != max) return false;
+    result = roll.result;
+    ++next_roll_;
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+JournalInputBuf::JournalInputBuf(const string& input, std::function<void()> exhausted)
+    : exhausted_(std::move(exhausted)) {
+    char* data = const_cast<char*>(input.data());
+    setg(data, data, data + input.size());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+JournalInputBuf::int_type JournalInputBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if (exhausted_) exhausted_();
+    return traits_type::eof();
+}
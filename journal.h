@@ -0,0 +1,154 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Session journal
+// Records everything that makes a session non-deterministic (the starting save, the seed, every byte of input and
+// every dice roll) so the session can be replayed exactly, without delays, from a bug report. The random salt of a
+// clearance code registered during the session is the one thing not recorded; replays do not compare credentials.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_JOURNAL_H
+#define OSIRIS_JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Journal file layout
+///
+/// A 16-byte header (magic "OJNL", version, seed) followed by tagged records. Integers inside records are LEB128
+/// varints; signed values are zigzag encoded.
+///   'S' length bytes                  save image the session started from
+///   'I' length bytes                  bytes returned by one read of the input
+///   'R' min (max - min) (roll - min)  one dice roll
+///   'E' checksum rolls input_bytes    clean end: CRC-32 of the final save image and totals to verify against
+namespace journal {
+
+constexpr char kMagic[4] = {'O', 'J', 'N', 'L'};
+constexpr uint16_t kVersion = 1;
+
+enum Tag : uint8_t {
+    START = 'S',
+    INPUT = 'I',
+    ROLL = 'R',
+    END = 'E'
+};
+
+} // namespace journal
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Appends records to a journal file
+///
+/// Rolls are buffered; the buffer is written out with every input record, so a journal is complete up to the
+/// last thing the player typed even if the game is killed.
+class JournalWriter {
+public:
+    JournalWriter();
+    ~JournalWriter();
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Create a journal file and write its header and starting save
+    /// @param path Journal file path
+    /// @param seed Seed the session's random engine was started with
+    /// @param start_image Save image of the state the session starts from
+    /// @return False if the file cannot be created
+    bool open(const std::string& path, uint64_t seed, const std::string& start_image);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Record bytes read from the input
+    /// @param data Bytes read
+    /// @param size Number of bytes
+    void input(const char* data, size_t size);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Record a dice roll
+    /// @param min Minimum of the range
+    /// @param max Maximum of the range
+    /// @param result Rolled value
+    void roll(int min, int max, int result);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Record a clean end of the session and close the file
+    /// @param checksum CRC-32 of the final save image
+    void finish(uint32_t checksum);
+
+    bool isOpen() const { return fd_ >= 0; }
+
+private:
+    void flush();
+
+    int fd_;
+    std::string buffer_;
+    uint64_t rolls_;
+    uint64_t input_bytes_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Loads a journal and hands its input and rolls back in order
+class JournalReader {
+public:
+    JournalReader();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Read and decode a journal file
+    /// @param path Journal file path
+    /// @param error Receives a description of the problem on failure
+    /// @return True if the journal is well-formed
+    bool open(const std::string& path, std::string& error);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Take the next recorded roll
+    /// @param min Range the game is rolling now
+    /// @param max Range the game is rolling now
+    /// @param result Receives the recorded value
+    /// @return False if the journal has no more rolls or the next one was over a different range (divergence)
+    bool nextRoll(int min, int max, int& result);
+
+    uint64_t seed() const { return seed_; }
+    const std::string& startImage() const { return start_image_; }
+    const std::string& input() const { return input_; }
+    size_t rollsUsed() const { return next_roll_; }
+    size_t rollCount() const { return rolls_.size(); }
+
+    /// Whether the recorded session ended cleanly; the final checksum is only known then
+    bool hasEnd() const { return has_end_; }
+    uint32_t endChecksum() const { return end_checksum_; }
+
+private:
+    struct Roll {
+        int min;
+        int max;
+        int result;
+    };
+
+    uint64_t seed_;
+    std::string start_image_;
+    std::string input_;
+    std::vector<Roll> rolls_;
+    size_t next_roll_;
+    bool has_end_;
+    uint32_t end_checksum_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Stream buffer serving a replayed session's input
+class JournalInputBuf : public std::streambuf {
+public:
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Serve recorded input
+    /// @param input Recorded input bytes (must outlive the buffer)
+    /// @param exhausted Called when the game wants more input than was recorded
+    JournalInputBuf(const std::string& input, std::function<void()> exhausted);
+
+protected:
+    int_type underflow() override;
+
+private:
+    std::function<void()> exhausted_;
+};
+
+#endif // OSIRIS_JOURNAL_H
@@ -0,0 +1,190 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Player batches
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "playerbatch.h"
+
+#include <functional>
+
+namespace {
+
+// Player field behind each stat column, in StoryStat order
+constexpr int PlayerState::* kStatFields[PlayerBatch::kStatColumns] = {
+    &PlayerState::strength, &PlayerState::intelligence, &PlayerState::dexterity, &PlayerState::stress_level,
+    &PlayerState::sanity, &PlayerState::osiris_trust, &PlayerState::age};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Compare a column, or the sum of two, against a constant block by block
+///
+/// The fixed-size inner loop has no branches and no tail, and the columns cannot alias the result, so it compiles to
+/// vector compares at -O2.
+template <bool kSum, typename Compare>
+size_t compareRows(const int* __restrict first, const int* __restrict second, int rhs, bool negate, size_t rows,
+                   uint8_t* __restrict passed, Compare compare) {
+    size_t count = 0;
+    for (size_t row = 0; row < rows; row += PlayerBatch::kLanes) {
+        for (size_t lane = 0; lane < PlayerBatch::kLanes; ++lane) {
+            int value = kSum ? first[row + lane] + second[row + lane] : first[row + lane];
+            uint8_t pass = static_cast<uint8_t>(compare(value, rhs) != negate);
+            passed[row + lane] = pass;
+            count += pass;
+        }
+    }
+    return count;
+}
+
+template <typename Compare>
+size_t compareRows(const int* __restrict first, const int* __restrict second, int rhs, bool negate, size_t rows,
+                   uint8_t* __restrict passed, Compare compare) {
+    if (second != nullptr) return compareRows<true>(first, second, rhs, negate, rows, passed, compare);
+    return compareRows<false>(first, second, rhs, negate, rows, passed, compare);
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+void PlayerBatch::clear() {
+    size_ = 0;
+    for (std::vector<int>& column : stats_) column.clear();
+    scenes_.clear();
+    secrets_.clear();
+    items_.clear();
+    relationships_.clear();
+    admin_.clear();
+    usernames_.clear();
+    credentials_.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t PlayerBatch::add(const Player& player) {
+    // Grow every column by a whole block at once; the new padding rows stay zero
+    if (size_ == padded()) {
+        size_t rows = size_ + kLanes;
+        for (std::vector<int>& column : stats_) column.resize(rows, 0);
+        scenes_.resize(rows, 0);
+        secrets_.resize(rows, 0);
+        items_.resize(rows, 0);
+        relationships_.resize(rows);
+        admin_.resize(rows, 0);
+    }
+    size_t row = size_++;
+    usernames_.push_back(player.username);
+    credentials_.push_back(player.credential);
+    store(row, player);
+    return row;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void PlayerBatch::store(size_t row, const PlayerState& state) {
+    for (size_t stat = 0; stat < kStatColumns; ++stat) stats_[stat][row] = state.*kStatFields[stat];
+    scenes_[row] = state.current_scene;
+    secrets_[row] = state.discovered_secrets.to_ullong();
+    items_[row] = state.inventory.to_ullong();
+    relationships_[row] = state.relationships;
+    admin_[row] = state.has_admin_access;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void PlayerBatch::load(size_t row, PlayerState& state) const {
+    for (size_t stat = 0; stat < kStatColumns; ++stat) state.*kStatFields[stat] = stats_[stat][row];
+    state.current_scene = scenes_[row];
+    state.discovered_secrets = std::bitset<kMaxSecrets>(secrets_[row]);
+    state.inventory = std::bitset<kMaxItems>(items_[row]);
+    state.relationships = relationships_[row];
+    state.has_admin_access = admin_[row] != 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void PlayerBatch::load(size_t row, Player& player) const {
+    load(row, player.state());
+    player.username = usernames_[row];
+    player.credential = credentials_[row];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t PlayerBatch::check(const StoryGraph::Condition& condition, std::vector<uint8_t>& passed) const {
+    using Condition = StoryGraph::Condition;
+    passed.assign(size_, 0);
+    if (size_ == 0) return 0;
+
+    // Stats are compared in place; every other kind is first gathered into a column of operands. Flag kinds pass
+    // when their operand is set, as StoryGraph::compile has them.
+    const int* first = nullptr;
+    const int* second = nullptr;
+    Condition::Compare compare = condition.compare;
+    int rhs = condition.value;
+    static thread_local std::vector<int> operands;
+    switch (condition.kind) {
+        case Condition::STAT:
+            if (!isColumn(condition.stat)) return 0;
+            first = column(condition.stat);
+            if (condition.stat_extra != StoryStat::NONE) {
+                if (!isColumn(condition.stat_extra)) return 0;
+                second = column(condition.stat_extra);
+            }
+            break;
+        case Condition::RELATIONSHIP:
+            if (condition.symbol >= kMaxCharacters) return 0;
+            operands.resize(padded());
+            for (size_t row = 0; row < padded(); ++row) {
+                operands[row] = static_cast<int>(relationships_[row][condition.symbol]);
+            }
+            first = operands.data();
+            break;
+        case Condition::ADMIN:
+            operands.assign(admin_.begin(), admin_.end());
+            first = operands.data();
+            compare = Condition::GREATER;
+            rhs = 0;
+            break;
+        case Condition::SECRET:
+        case Condition::ITEM: {
+            if (condition.symbol >= (condition.kind == Condition::SECRET ? kMaxSecrets : kMaxItems)) return 0;
+            const std::vector<uint64_t>& bits = condition.kind == Condition::SECRET ? secrets_ : items_;
+            operands.resize(padded());
+            for (size_t row = 0; row < padded(); ++row) {
+                operands[row] = static_cast<int>((bits[row] >> condition.symbol) & 1);
+            }
+            first = operands.data();
+            compare = Condition::GREATER;
+            rhs = 0;
+            break;
+        }
+        case Condition::TIME_LOOP:
+        case Condition::CHANCE:
+            return 0;
+    }
+
+    bool negate = condition.negate;
+    size_t rows = padded();
+    passed.resize(rows);
+    uint8_t* out = passed.data();
+
+    // One instantiation per operator keeps the comparison out of the inner loop
+    size_t count = 0;
+    switch (compare) {
+        case Condition::LESS:
+            count = compareRows(first, second, rhs, negate, rows, out, std::less<int>());
+            break;
+        case Condition::LESS_EQUAL:
+            count = compareRows(first, second, rhs, negate, rows, out, std::less_equal<int>());
+            break;
+        case Condition::GREATER:
+            count = compareRows(first, second, rhs, negate, rows, out, std::greater<int>());
+            break;
+        case Condition::GREATER_EQUAL:
+            count = compareRows(first, second, rhs, negate, rows, out, std::greater_equal<int>());
+            break;
+        case Condition::EQUAL:
+            count = compareRows(first, second, rhs, negate, rows, out, std::equal_to<int>());
+            break;
+        case Condition::NOT_EQUAL:
+            count = compareRows(first, second, rhs, negate, rows, out, std::not_equal_to<int>());
+            break;
+    }
+
+    // Padding rows were compared too; take them back out
+    for (size_t row = size_; row < rows; ++row) count -= passed[row];
+    passed.resize(size_);
+    return count;
+}
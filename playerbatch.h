@@ -0,0 +1,93 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Player batches
+// Many players stored column by column: one array per stat, one for the scene, one for each bitset, and the
+// usernames and credentials apart from all of them. A stat check over the batch then reads one or two dense int
+// arrays, which the compiler turns into vector compares, instead of striding over whole players. The simulator
+// keeps the final states of its runs in one to report how many meet each requirement of the story.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_PLAYERBATCH_H
+#define OSIRIS_PLAYERBATCH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "story.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Struct-of-arrays store of players
+///
+/// Columns are padded to a multiple of kLanes so checks run in whole blocks without a scalar tail; padding rows
+/// hold zeros and are never reported.
+class PlayerBatch {
+public:
+    static constexpr size_t kLanes = 16;
+    static constexpr size_t kStatColumns = static_cast<size_t>(StoryStat::AGE) + 1;
+
+    size_t size() const { return size_; }
+    void clear();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Append a player
+    /// @param player Player to copy in
+    /// @return Row of the player
+    size_t add(const Player& player);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Overwrite a row's numeric state, keeping its username and credential
+    /// @param row Row to write
+    /// @param state New state
+    void store(size_t row, const PlayerState& state);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Gather a row back into a player
+    /// @param row Row to read
+    /// @param player Receives the numeric state and the credentials
+    void load(size_t row, Player& player) const;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Gather a row's numeric state only
+    /// @param row Row to read
+    /// @param state Receives the state
+    void load(size_t row, PlayerState& state) const;
+
+    const std::string& username(size_t row) const { return usernames_[row]; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Contiguous values of one stat, size() entries followed by the padding
+    /// @param stat Stat other than NONE
+    /// @return First value
+    const int* column(StoryStat stat) const { return stats_[static_cast<size_t>(stat)].data(); }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Evaluate a condition for every player, the way StoryRunner does for one
+    ///
+    /// TIME_LOOP and CHANCE conditions depend on the game being played rather than on the player, so nobody
+    /// passes them here; neither does a condition naming a stat or symbol out of range.
+    /// @param condition Condition of any kind
+    /// @param passed Receives 1 or 0 per row; resized to size()
+    /// @return Number of players passing
+    size_t check(const StoryGraph::Condition& condition, std::vector<uint8_t>& passed) const;
+
+private:
+    size_t padded() const { return stats_[0].size(); }
+    static bool isColumn(StoryStat stat) { return static_cast<size_t>(stat) < kStatColumns; }
+
+    size_t size_ = 0;
+    std::array<std::vector<int>, kStatColumns> stats_;      // Indexed by StoryStat
+    std::vector<int> scenes_;
+    std::vector<uint64_t> secrets_;
+    std::vector<uint64_t> items_;
+    std::vector<std::array<RelationshipStatus, kMaxCharacters>> relationships_;
+    std::vector<uint8_t> admin_;
+
+    // Cold: only read when a row is loaded back into a Player
+    std::vector<std::string> usernames_;
+    std::vector<Credential> credentials_;
+};
+
+#endif // OSIRIS_PLAYERBATCH_H
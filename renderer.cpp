@@ -0,0 +1,246 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Batched typewriter renderer
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "renderer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <thread>
+
+#include "trace.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+Renderer::Renderer(int fd)
+    : fd_(fd), head_(0), mark_head_(0), cursor_(Clock::now()), last_write_(),
+      frame_(std::chrono::milliseconds(kDefaultFrameMs)), writes_(0),
+      instant_(false), muted_(false), color_(true), blocked_(false) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t Renderer::unitLength(std::string_view text, size_t pos) {
+    unsigned char lead = static_cast<unsigned char>(text[pos]);
+    size_t remaining = text.size() - pos;
+
+    // ANSI CSI sequence: ESC '[' parameters final-byte
+    if (lead == 0x1B) {
+        if (remaining < 2 || text[pos + 1] != '[') return 1;
+        size_t len = 2;
+        while (len < remaining) {
+            unsigned char c = static_cast<unsigned char>(text[pos + len++]);
+            if (c >= 0x40 && c <= 0x7E) break;
+        }
+        return len;
+    }
+
+    // UTF-8 code point; stray continuation bytes are passed through one at a time
+    size_t len = 1;
+    if ((lead & 0xE0) == 0xC0) len = 2;
+    else if ((lead & 0xF0) == 0xE0) len = 3;
+    else if ((lead & 0xF8) == 0xF0) len = 4;
+    return std::min(len, remaining);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::append(const char* data, size_t size, int delay_ms) {
+    if (!busy()) compact();
+    if (instant_) {
+        pending_.append(data, size);
+        if (pending_.size() >= kInstantFlushBytes) emit(pending_.size());
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+    if (cursor_ < now) cursor_ = now;
+
+    // Writes are at most one per frame anyway, so glyphs due within a frame of the last mark share it; this keeps
+    // the queue at one mark per frame instead of one per glyph
+    pending_.append(data, size);
+    if (mark_head_ < marks_.size() && cursor_ < marks_.back().due + frame_) {
+        marks_.back().end = pending_.size();
+    } else {
+        marks_.push_back({pending_.size(), cursor_});
+    }
+
+    if (delay_ms > 0) cursor_ += std::chrono::milliseconds(delay_ms);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::write(const char* data, size_t size) {
+    if (size == 0 || muted_) return;
+    if (!color_ && std::memchr(data, '\033', size) != nullptr) {
+        appendStripped(data, size);
+    } else {
+        append(data, size, 0);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::appendStripped(const char* data, size_t size) {
+    std::string_view text(data, size);
+    size_t start = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (text[pos] != '\033') {
+            ++pos;
+            continue;
+        }
+        if (pos > start) append(text.data() + start, pos - start, 0);
+        pos += unitLength(text, pos);
+        start = pos;
+    }
+    if (pos > start) append(text.data() + start, pos - start, 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::pause(int ms) {
+    if (instant_ || muted_) return;
+    Clock::time_point now = Clock::now();
+    if (cursor_ < now) cursor_ = now;
+    cursor_ += std::chrono::milliseconds(ms);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::emit(size_t end) {
+    blocked_ = false;
+    while (head_ < end) {
+        ssize_t n = ::write(fd_, pending_.data() + head_, end - head_);
+        OSIRIS_TRACE_COUNTER("output.write", n);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                blocked_ = true;  // Non-blocking descriptor is full; keep the rest for the next pump
+                break;
+            }
+            head_ = end;  // Output is gone (closed terminal); drop it rather than spin
+            break;
+        }
+        head_ += static_cast<size_t>(n);
+    }
+    ++writes_;
+    last_write_ = Clock::now();
+
+    while (mark_head_ < marks_.size() && marks_[mark_head_].end <= head_) ++mark_head_;
+    if (!busy()) compact();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::compact() {
+    pending_.clear();
+    marks_.clear();
+    head_ = 0;
+    mark_head_ = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::pump() {
+    if (!busy()) return;
+
+    Clock::time_point now = Clock::now();
+    size_t end = head_;
+    for (size_t i = mark_head_; i < marks_.size() && marks_[i].due <= now; ++i) {
+        end = marks_[i].end;
+    }
+    if (end > head_) emit(end);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::drain() {
+    OSIRIS_TRACE_SCOPE("output.pacing");
+    if (instant_) {
+        flush();
+        return;
+    }
+    while (busy()) {
+        pump();
+        if (!busy()) break;
+        std::this_thread::sleep_until(std::max(marks_[mark_head_].due, last_write_ + frame_));
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::flush() {
+    if (busy()) emit(pending_.size());
+    cursor_ = Clock::now();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Renderer::waitForInput(int input_fd) {
+    OSIRIS_TRACE_SCOPE("output.pacing");
+    if (instant_) {
+        flush();
+        return;
+    }
+    while (busy()) {
+        pump();
+        if (!busy()) break;
+
+        Clock::time_point wake = std::max(marks_[mark_head_].due, last_write_ + frame_);
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(wake - Clock::now()).count();
+
+        pollfd pfd{input_fd, POLLIN, 0};
+        if (poll(&pfd, 1, static_cast<int>(std::max<long long>(0, wait + 1))) > 0) {
+            flush();  // Typed-ahead input skips the rest of the animation
+            return;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+RendererStreamBuf::int_type RendererStreamBuf::overflow(int_type ch) {
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        char c = traits_type::to_char_type(ch);
+        renderer_.write(&c, 1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+std::streamsize RendererStreamBuf::xsputn(const char* data, std::streamsize size) {
+    renderer_.write(data, static_cast<size_t>(size));
+    return size;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+RendererInputBuf::RendererInputBuf(Renderer& renderer, int fd)
+    : renderer_(renderer), fd_(fd), timeout_(0), timed_out_(false), next_(0), end_(0) {
+    setg(buffer_, buffer_, buffer_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+RendererInputBuf::int_type RendererInputBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+    if (next_ < end_) {
+        renderer_.flush();
+    } else {
+        renderer_.waitForInput(fd_);
+        OSIRIS_TRACE_SCOPE("input.wait");
+        if (timeout_.count() > 0) {
+            pollfd pfd{fd_, POLLIN, 0};
+            int ready;
+            do {
+                ready = poll(&pfd, 1, static_cast<int>(timeout_.count()));
+            } while (ready < 0 && errno == EINTR);
+            if (ready == 0) {
+                timed_out_ = true;
+                return traits_type::eof();
+            }
+        }
+
+        ssize_t n;
+        do {
+            n = ::read(fd_, buffer_, sizeof(buffer_));
+        } while (n < 0 && errno == EINTR);
+
+        if (n <= 0) return traits_type::eof();
+        if (observer_) observer_(buffer_, static_cast<size_t>(n));
+        next_ = 0;
+        end_ = static_cast<size_t>(n);
+    }
+
+    setg(buffer_ + next_, buffer_ + next_, buffer_ + next_ + 1);
+    ++next_;
+    return traits_type::to_int_type(*gptr());
+}
@@ -0,0 +1,249 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Batched typewriter renderer
+// Collects all game output into a single timed queue and emits it frame by frame, so the typewriter effect
+// costs one write per frame instead of one write (and one sleep) per byte.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_RENDERER_H
+#define OSIRIS_RENDERER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frame-based output engine for the typewriter animation
+///
+/// Text is split into display units (one UTF-8 code point or one complete ANSI escape sequence) and each unit is
+/// given a due time. Nothing blocks while queueing; bytes are written once their due time has passed, grouped into
+/// at most one write per frame interval.
+class Renderer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int kDefaultFrameMs = 50;
+    static constexpr size_t kInstantFlushBytes = 64 * 1024;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Create a renderer writing to the given file descriptor
+    /// @param fd Output file descriptor
+    explicit Renderer(int fd = STDOUT_FILENO);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Queue text to appear immediately after everything already queued
+    /// @param data Bytes to output
+    /// @param size Number of bytes
+    void write(const char* data, size_t size);
+    void write(std::string_view text) { write(text.data(), text.size()); }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Queue terminal control sequences (cursor movement, scroll regions) that are kept even when color is off
+    /// @param bytes Sequences to output, untimed
+    void control(std::string_view bytes) {
+        if (!bytes.empty() && !muted_) append(bytes.data(), bytes.size(), 0);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Queue text with a typewriter animation
+    /// @param text Text to animate
+    /// @param delay_ms Delay after each visible glyph in milliseconds
+    void type(std::string_view text, int delay_ms) {
+        type(text, delay_ms, [] { return 0; });
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Queue text with a typewriter animation and per-glyph timing noise
+    /// @param text Text to animate
+    /// @param delay_ms Base delay after each visible glyph in milliseconds
+    /// @param jitter Callable returning extra milliseconds for each glyph; only called while animating, so it must not
+    ///               draw from anything the game's outcome depends on
+    template <typename Jitter>
+    void type(std::string_view text, int delay_ms, Jitter&& jitter) {
+        if (instant_ || muted_) {
+            write(text);
+            return;
+        }
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t len = unitLength(text, pos);
+            if (text[pos] == '\033') {
+                if (color_) append(text.data() + pos, len, 0);
+            } else {
+                append(text.data() + pos, len, delay_ms + jitter());
+            }
+            pos += len;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Queue a pause; later output appears only after it elapses
+    /// @param ms Pause length in milliseconds
+    void pause(int ms);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Write every byte whose due time has passed in a single write call
+    void pump();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Block until the whole queue has been written, one frame at a time
+    void drain();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Write everything still queued right away, skipping the remaining animation
+    void flush();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Keep animating until input arrives on a descriptor; pending input skips the rest of the animation
+    /// @param input_fd Descriptor the caller is about to read from
+    void waitForInput(int input_fd);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Check whether queued output is still waiting to be written
+    /// @return True if bytes are pending
+    bool busy() const { return head_ < pending_.size(); }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Number of queued bytes not written yet
+    size_t backlog() const { return pending_.size() - head_; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Check whether the last write stopped because a non-blocking descriptor was full
+    /// @return True if the caller should wait for the descriptor to become writable before pumping again
+    bool blocked() const { return blocked_; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Earliest time a pump can write more of the queue, for event loops that pump many renderers
+    /// @return Due time of the next queued byte, held back to one write per frame interval; never if nothing is
+    ///         timed (instant output is only written by flush)
+    Clock::time_point wakeTime() const {
+        if (mark_head_ >= marks_.size()) return Clock::time_point::max();
+        return std::max(marks_[mark_head_].due, last_write_ + frame_);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Give the queue's memory back once everything has been written; servers keep thousands of idle renderers
+    void release() {
+        if (busy()) return;
+        std::string().swap(pending_);
+        std::vector<Mark>().swap(marks_);
+        head_ = 0;
+        mark_head_ = 0;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Change the minimum time between two writes
+    /// @param ms Frame interval in milliseconds
+    void setFrameInterval(int ms) { frame_ = std::chrono::milliseconds(ms); }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Disable all pacing; output is only written when input is needed or on drain
+    /// @param instant True to skip animation and pauses entirely
+    void setInstant(bool instant) { instant_ = instant; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Drop all output; headless simulations run the story without producing any text
+    /// @param muted True to discard everything queued afterwards
+    void setMuted(bool muted) { muted_ = muted; }
+    bool muted() const { return muted_; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Enable or strip ANSI escape sequences from everything queued afterwards
+    /// @param color False to drop escape sequences
+    void setColor(bool color) { color_ = color; }
+    bool color() const { return color_; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Number of write calls issued so far
+    /// @return Write syscall count
+    size_t writeCount() const { return writes_; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Length of the display unit starting at a position
+    /// @param text Text being split
+    /// @param pos Start of the unit
+    /// @return Byte length of the UTF-8 code point or ANSI escape sequence at pos
+    static size_t unitLength(std::string_view text, size_t pos);
+
+private:
+    /// Bytes up to end may be written once due has passed
+    struct Mark {
+        size_t end;
+        Clock::time_point due;
+    };
+
+    void append(const char* data, size_t size, int delay_ms);
+    void appendStripped(const char* data, size_t size);
+    void emit(size_t end);
+    void compact();
+
+    int fd_;
+    std::string pending_;
+    size_t head_;
+    std::vector<Mark> marks_;
+    size_t mark_head_;
+    Clock::time_point cursor_;
+    Clock::time_point last_write_;
+    Clock::duration frame_;
+    size_t writes_;
+    bool instant_;
+    bool muted_;
+    bool color_;
+    bool blocked_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Stream buffer forwarding std::ostream output into a Renderer queue
+class RendererStreamBuf : public std::streambuf {
+public:
+    explicit RendererStreamBuf(Renderer& renderer) : renderer_(renderer) {}
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize size) override;
+
+private:
+    Renderer& renderer_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Stream buffer reading a descriptor that lets the renderer keep animating until input is available
+///
+/// Bytes are handed to the stream one at a time so every extraction passes through underflow; input that was
+/// typed ahead and is already buffered flushes the animation instead of waiting behind it.
+class RendererInputBuf : public std::streambuf {
+public:
+    /// Receives every chunk read from the descriptor, e.g. to journal it
+    using Observer = std::function<void(const char* data, size_t size)>;
+
+    RendererInputBuf(Renderer& renderer, int fd = STDIN_FILENO);
+
+    void observe(Observer observer) { observer_ = std::move(observer); }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Give up on input that does not arrive in time: the stream then ends, and timedOut() tells why
+    /// @param timeout Longest wait for input once the output has caught up; zero to wait forever
+    void setTimeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
+
+    bool timedOut() const { return timed_out_; }
+
+protected:
+    int_type underflow() override;
+
+private:
+    Renderer& renderer_;
+    int fd_;
+    Observer observer_;
+    std::chrono::milliseconds timeout_;
+    bool timed_out_;
+    char buffer_[4096];
+    size_t next_;
+    size_t end_;
+};
+
+#endif // OSIRIS_RENDERER_H
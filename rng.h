@@ -0,0 +1,95 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Random engines for GameState
+// A random engine policy provides:
+//   Rng(uint64_t seed, uint64_t stream)   construct on a seed and an independent stream of that seed
+//   void seed(uint64_t seed, uint64_t stream)
+//   uint32_t operator()()                 next 32 random bits
+//   void discard(uint64_t count)          skip count outputs
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_RNG_H
+#define OSIRIS_RNG_H
+
+#include <cstdint>
+#include <random>
+
+//---------------------------------------------------------------------------------------------------------------------
+/// SplitMix64 finalizer: a bijective 64-bit mix with full avalanche
+constexpr uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counter-based generator: output n is mix64(key + n * golden ratio)
+///
+/// The whole state is a 64-bit key and a 64-bit counter, so engines are free to create and copy, jumping ahead is
+/// a single addition, and every (seed, stream) pair gets its own key. Streams are windows of the same 2^64-long
+/// Weyl sequence starting at pseudo-random offsets; for any realistic number of draws they never overlap.
+class CounterRng {
+public:
+    static constexpr uint64_t kGolden = 0x9E3779B97F4A7C15ULL;
+
+    explicit CounterRng(uint64_t seed = 0, uint64_t stream = 0) { this->seed(seed, stream); }
+
+    void seed(uint64_t seed, uint64_t stream = 0) {
+        key_ = mix64(seed + kGolden) ^ mix64(~stream * kGolden);
+        counter_ = 0;
+    }
+
+    uint32_t operator()() {
+        return static_cast<uint32_t>(mix64(key_ + counter_++ * kGolden) >> 32);
+    }
+
+    void discard(uint64_t count) { counter_ += count; }
+
+private:
+    uint64_t key_;
+    uint64_t counter_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// std::mt19937 behind the engine policy interface; jumping ahead costs one step per skipped output
+class MersenneRng {
+public:
+    explicit MersenneRng(uint64_t seed = 0, uint64_t stream = 0) { this->seed(seed, stream); }
+
+    void seed(uint64_t seed, uint64_t stream = 0) {
+        std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                               static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+        engine_.seed(sequence);
+    }
+
+    uint32_t operator()() { return static_cast<uint32_t>(engine_()); }
+
+    void discard(uint64_t count) { engine_.discard(count); }
+
+private:
+    std::mt19937 engine_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Uniform integer in [min, max] from 32 random bits per try (Lemire's multiply-shift with rejection)
+/// @param rng Engine following the policy interface
+/// @param min Minimum value (inclusive)
+/// @param max Maximum value (inclusive)
+/// @return Unbiased value in range
+template <typename Rng>
+int uniformInt(Rng& rng, int min, int max) {
+    uint32_t range = static_cast<uint32_t>(static_cast<int64_t>(max) - min) + 1u;
+    if (range == 0) return static_cast<int>(rng());     // The full 32-bit range
+
+    uint64_t product = static_cast<uint64_t>(rng()) * range;
+    uint32_t low = static_cast<uint32_t>(product);
+    if (low < range) {
+        uint32_t threshold = static_cast<uint32_t>(-range) % range;
+        while (low < threshold) {
+            product = static_cast<uint64_t>(rng()) * range;
+            low = static_cast<uint32_t>(product);
+        }
+    }
+    return static_cast<int>(static_cast<int64_t>(min) + static_cast<int64_t>(product >> 32));
+}
+
+#endif // OSIRIS_RNG_H
@@ -0,0 +1,107 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Random engine microbenchmark
+// Times dice rolls and jump-ahead for each engine policy against the game's original mt19937 rollDice.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "game.h"
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+/// The dice roll GameState used before engine policies: mt19937 with a distribution built for every roll
+class LegacyDice {
+public:
+    explicit LegacyDice(uint64_t seed) : rng_(static_cast<std::mt19937::result_type>(seed)) {}
+
+    int rollDice(int min, int max) {
+        std::uniform_int_distribution<int> dist(min, max);
+        return dist(rng_);
+    }
+
+    void skipAhead(uint64_t count) { rng_.discard(count); }
+
+private:
+    std::mt19937 rng_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Nanoseconds per roll over the ranges the story actually rolls (d100 checks, d10 whispers, d3 flavour)
+template <typename Dice>
+double timeRolls(Dice& dice, uint64_t rolls, int64_t& sink) {
+    auto start = std::chrono::steady_clock::now();
+    int64_t sum = 0;
+    for (uint64_t i = 0; i < rolls; i += 4) {
+        sum += dice.rollDice(1, 100);
+        sum += dice.rollDice(1, 10);
+        sum += dice.rollDice(1, 100);
+        sum += dice.rollDice(1, 3);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    sink += sum;
+    return elapsed.count() / static_cast<double>(rolls);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Nanoseconds per jump of a given length
+template <typename Dice>
+double timeJumps(Dice& dice, uint64_t jumps, uint64_t distance, int64_t& sink) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < jumps; ++i) {
+        dice.skipAhead(distance);
+        sink += dice.rollDice(1, 100);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(jumps);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Dice>
+void report(const char* name, Dice& dice, uint64_t rolls, int64_t& sink) {
+    const uint64_t kDistance = 1000000;
+    double roll_ns = timeRolls(dice, rolls, sink);
+    double jump_ns = timeJumps(dice, 16, kDistance, sink);
+    std::printf("  %-24s %8.2f ns/roll %12.1f ns/jump(1e6)\n", name, roll_ns, jump_ns);
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Microbenchmark entry point
+/// @param argc Argument count
+/// @param argv Arguments: [--rolls N]
+/// @return Exit code
+int main(int argc, char* argv[]) {
+    uint64_t rolls = 50000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rolls" && i + 1 < argc) {
+            rolls = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--rolls N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int64_t sink = 0;
+    LegacyDice legacy(1);
+    BasicGameState<MersenneRng> mersenne;
+    BasicGameState<CounterRng> counter;
+    mersenne.reset(1);
+    counter.reset(1);
+
+    std::printf("Dice rolls (%llu per engine):\n", static_cast<unsigned long long>(rolls));
+    report("mt19937 + distribution", legacy, rolls, sink);
+    report("MersenneRng", mersenne, rolls, sink);
+    report("CounterRng", counter, rolls, sink);
+
+    // Printed so the compiler cannot drop the rolls
+    std::printf("checksum %lld\n", static_cast<long long>(sink));
+    return 0;
+}
@@ -0,0 +1,418 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Binary save format
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "save.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+using std::string;
+using std::string_view;
+
+static_assert(sizeof(SaveHeader) == 24, "save header layout changed");
+static_assert(sizeof(SaveFixed) == 48, "save record layout changed");
+static_assert(sizeof(SaveCredential) == 40, "save credential layout changed");
+static_assert(sizeof(SaveRelationship) == 4, "save relationship layout changed");
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+constexpr std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> kCrcTable = makeCrcTable();
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Save-local symbol table: names are interned in order of first use
+class SymbolList {
+public:
+    uint16_t intern(const string& name) {
+        for (size_t i = 0; i < names_.size(); ++i) {
+            if (*names_[i] == name) return static_cast<uint16_t>(i);
+        }
+        names_.push_back(&name);
+        return static_cast<uint16_t>(names_.size() - 1);
+    }
+
+    const std::vector<const string*>& names() const { return names_; }
+
+    void clear() { names_.clear(); }
+
+private:
+    std::vector<const string*> names_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+void appendPod(string& image, const T& value) {
+    image.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t saveChecksum(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = kCrcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool syncDirectory(const string& path) {
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveView::~SaveView() {
+    unmap();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveView::unmap() {
+    if (data_ != nullptr) munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+    base_ = nullptr;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveView::open(const string& path) {
+    unmap();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(SaveHeader))) {
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    data_ = mapping;
+    size_ = static_cast<size_t>(info.st_size);
+    if (!attach(data_, size_)) {
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveView::attach(const void* data, size_t size) {
+    base_ = nullptr;
+    if (size < sizeof(SaveHeader) + sizeof(SaveFixed)) return false;
+
+    const char* bytes = static_cast<const char*>(data);
+    SaveHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, "OSAV", 4) != 0 || header.version < 1 || header.version > kSaveVersion ||
+        header.header_size != sizeof(SaveHeader) || header.payload_size != size - sizeof(SaveHeader)) {
+        return false;
+    }
+
+    const char* payload = bytes + sizeof(SaveHeader);
+    if (saveChecksum(payload, header.payload_size) != header.checksum) return false;
+
+    SaveFixed fixed;
+    std::memcpy(&fixed, payload, sizeof(fixed));
+    size_t offset = sizeof(SaveFixed);
+    size_t credential_at = offset;
+    if (header.version >= 2) offset += sizeof(SaveCredential);
+    size_t offsets_at = offset;
+    offset += (fixed.symbol_count + 1u) * sizeof(uint32_t);
+    size_t relationships_at = offset;
+    offset += fixed.relationship_count * sizeof(SaveRelationship);
+    size_t secrets_at = offset;
+    offset += fixed.secret_count * sizeof(uint16_t);
+    size_t items_at = offset;
+    offset += fixed.item_count * sizeof(uint16_t);
+    if (offset > header.payload_size) return false;
+
+    // Symbol offsets must be increasing and leave room for the username at the end of the string area
+    size_t string_bytes = header.payload_size - offset;
+    const char* offsets = payload + offsets_at;
+    if (entry<uint32_t>(offsets, 0) != 0) return false;
+    for (uint16_t i = 0; i < fixed.symbol_count; ++i) {
+        if (entry<uint32_t>(offsets, i + 1) < entry<uint32_t>(offsets, i)) return false;
+    }
+    if (entry<uint32_t>(offsets, fixed.symbol_count) + static_cast<size_t>(fixed.username_length) != string_bytes) {
+        return false;
+    }
+
+    const char* relationships = payload + relationships_at;
+    const char* secrets = payload + secrets_at;
+    const char* items = payload + items_at;
+    for (uint16_t i = 0; i < fixed.relationship_count; ++i) {
+        if (entry<SaveRelationship>(relationships, i).symbol >= fixed.symbol_count) return false;
+    }
+    for (uint16_t i = 0; i < fixed.secret_count; ++i) {
+        if (entry<uint16_t>(secrets, i) >= fixed.symbol_count) return false;
+    }
+    for (uint16_t i = 0; i < fixed.item_count; ++i) {
+        if (entry<uint16_t>(items, i) >= fixed.symbol_count) return false;
+    }
+
+    base_ = bytes;
+    header_ = header;
+    fixed_ = fixed;
+    has_credential_ = header.version >= 2;
+    credential_ = SaveCredential{};
+    if (has_credential_) std::memcpy(&credential_, payload + credential_at, sizeof(credential_));
+    offsets_ = offsets;
+    relationships_ = relationships;
+    secrets_ = secrets;
+    items_ = items;
+    strings_ = payload + offset;
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+string_view SaveView::symbol(uint16_t id) const {
+    uint32_t begin = entry<uint32_t>(offsets_, id);
+    return string_view(strings_ + begin, entry<uint32_t>(offsets_, id + 1u) - begin);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+string_view SaveView::username() const {
+    return string_view(strings_ + entry<uint32_t>(offsets_, fixed_.symbol_count), fixed_.username_length);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void encodeSave(const Player& player, const GameState& state, string& image) {
+    // Scratch kept per thread, so encoding allocates nothing once warmed up
+    static thread_local SymbolList symbols;
+    static thread_local std::vector<SaveRelationship> relationships;
+    static thread_local std::vector<uint16_t> secrets;
+    static thread_local std::vector<uint16_t> items;
+    symbols.clear();
+    relationships.clear();
+    secrets.clear();
+    items.clear();
+
+    for (SymbolId id = 0; id < character_symbols.size(); ++id) {
+        relationships.push_back({symbols.intern(character_symbols.name(id)),
+                                 static_cast<int16_t>(player.relationships[id])});
+    }
+    for (SymbolId id = 0; id < secret_symbols.size(); ++id) {
+        if (player.discovered_secrets.test(id)) secrets.push_back(symbols.intern(secret_symbols.name(id)));
+    }
+    for (SymbolId id = 0; id < item_symbols.size(); ++id) {
+        if (player.inventory.test(id)) items.push_back(symbols.intern(item_symbols.name(id)));
+    }
+
+    SaveFixed fixed{};
+    fixed.scene = player.current_scene;
+    fixed.age = player.age;
+    fixed.strength = player.strength;
+    fixed.intelligence = player.intelligence;
+    fixed.dexterity = player.dexterity;
+    fixed.stress_level = player.stress_level;
+    fixed.sanity = player.sanity;
+    fixed.osiris_trust = player.osiris_trust;
+    fixed.loop_count = state.getLoopCount();
+    fixed.has_admin_access = player.has_admin_access ? 1 : 0;
+    fixed.time_loop_active = state.isInTimeLoop() ? 1 : 0;
+    fixed.symbol_count = static_cast<uint16_t>(symbols.names().size());
+    fixed.relationship_count = static_cast<uint16_t>(relationships.size());
+    fixed.secret_count = static_cast<uint16_t>(secrets.size());
+    fixed.item_count = static_cast<uint16_t>(items.size());
+    fixed.username_length = static_cast<uint16_t>(player.username.size());
+
+    SaveCredential credential{};
+    credential.salt = player.credential.salt;
+    std::memcpy(credential.hash, player.credential.hash.data(), sizeof(credential.hash));
+
+    image.clear();
+    image.resize(sizeof(SaveHeader));
+    appendPod(image, fixed);
+    appendPod(image, credential);
+
+    uint32_t offset = 0;
+    appendPod(image, offset);
+    for (const string* name : symbols.names()) {
+        offset += static_cast<uint32_t>(name->size());
+        appendPod(image, offset);
+    }
+    for (const SaveRelationship& rel : relationships) appendPod(image, rel);
+    for (uint16_t id : secrets) appendPod(image, id);
+    for (uint16_t id : items) appendPod(image, id);
+    for (const string* name : symbols.names()) image += *name;
+    image.append(player.username, 0, fixed.username_length);
+
+    SaveHeader header{};
+    std::memcpy(header.magic, "OSAV", 4);
+    header.version = kSaveVersion;
+    header.header_size = sizeof(SaveHeader);
+    header.payload_size = static_cast<uint32_t>(image.size() - sizeof(SaveHeader));
+    header.checksum = saveChecksum(image.data() + sizeof(SaveHeader), header.payload_size);
+    std::memcpy(&image[0], &header, sizeof(header));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void decodeSave(const SaveView& view, Player& player, GameState& state) {
+    const SaveFixed& fixed = view.fixed();
+
+    player = Player();
+    player.current_scene = fixed.scene;
+    player.username.assign(view.username());
+    player.age = fixed.age;
+    player.strength = fixed.strength;
+    player.intelligence = fixed.intelligence;
+    player.dexterity = fixed.dexterity;
+    player.stress_level = fixed.stress_level;
+    player.sanity = fixed.sanity;
+    player.osiris_trust = fixed.osiris_trust;
+    player.has_admin_access = fixed.has_admin_access != 0;
+    if (const SaveCredential* credential = view.credential()) {
+        player.credential.salt = credential->salt;
+        std::memcpy(player.credential.hash.data(), credential->hash, sizeof(credential->hash));
+    }
+
+    // File symbol ids are local to the file; map them onto the global tables
+    for (uint16_t i = 0; i < fixed.relationship_count; ++i) {
+        SaveRelationship rel = view.relationship(i);
+        SymbolId id = character_symbols.intern(view.symbol(rel.symbol));
+        if (id != kNoSymbol) player.relationships[id] = static_cast<RelationshipStatus>(rel.status);
+    }
+    for (uint16_t i = 0; i < fixed.secret_count; ++i) {
+        SymbolId id = secret_symbols.intern(view.symbol(view.secret(i)));
+        if (id != kNoSymbol) player.discovered_secrets.set(id);
+    }
+    for (uint16_t i = 0; i < fixed.item_count; ++i) {
+        SymbolId id = item_symbols.intern(view.symbol(view.item(i)));
+        if (id != kNoSymbol) player.inventory.set(id);
+    }
+
+    state.restoreTimeLoop(fixed.time_loop_active != 0, fixed.loop_count);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool saveBinaryProgress(const string& path, const Player& player, const GameState& state) {
+    static thread_local string image;
+    encodeSave(player, state, image);
+
+    // Named per thread, so two threads saving the same player never write into one temporary file
+    string temp_path = path + ".tmp" + std::to_string(static_cast<long>(syscall(SYS_gettid)));
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    size_t written = 0;
+    while (written < image.size()) {
+        ssize_t n = ::write(fd, image.data() + written, image.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            unlink(temp_path.c_str());
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+
+    // The new save is on disk before it replaces the old one, and the rename is on disk before we report success,
+    // so a crash leaves one save or the other, never an empty file
+    if (fdatasync(fd) != 0) {
+        close(fd);
+        unlink(temp_path.c_str());
+        return false;
+    }
+    if (close(fd) != 0 || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return syncDirectory(path);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool loadBinaryProgress(const string& path, Player& player, GameState& state) {
+    SaveView view;
+    if (!view.open(path)) return false;
+    decodeSave(view, player, state);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool importTextProgress(const string& path, Player& player) {
+    std::ifstream load(path);
+    if (!load.is_open()) return false;
+
+    // One value per line; reading whole lines keeps usernames with spaces intact
+    auto readInt = [&load]() {
+        string line;
+        std::getline(load, line);
+        return std::atoi(line.c_str());
+    };
+
+    player = Player();
+    player.current_scene = readInt();
+    std::getline(load, player.username);
+    player.age = readInt();
+    player.strength = readInt();
+    player.intelligence = readInt();
+    player.dexterity = readInt();
+    player.stress_level = readInt();
+    player.sanity = readInt();
+    player.osiris_trust = readInt();
+    player.has_admin_access = readInt() != 0;
+
+    int rel_count = readInt();
+    for (int i = 0; i < rel_count && load; ++i) {
+        string line;
+        std::getline(load, line);
+        size_t space = line.rfind(' ');
+        if (space == string::npos) continue;
+        SymbolId id = character_symbols.intern(string_view(line).substr(0, space));
+        if (id != kNoSymbol) {
+            player.relationships[id] = static_cast<RelationshipStatus>(std::atoi(line.c_str() + space + 1));
+        }
+    }
+
+    int secret_count = readInt();
+    for (int i = 0; i < secret_count && load; ++i) {
+        string secret;
+        std::getline(load, secret);
+        SymbolId id = secret_symbols.intern(secret);
+        if (id != kNoSymbol) player.discovered_secrets.set(id);
+    }
+
+    int inventory_count = readInt();
+    for (int i = 0; i < inventory_count && load; ++i) {
+        string item;
+        std::getline(load, item);
+        SymbolId id = item_symbols.intern(item);
+        if (id != kNoSymbol) player.inventory.set(id);
+    }
+
+    return true;
+}
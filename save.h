@@ -0,0 +1,178 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Binary save format
+// A versioned, checksummed save image that is memory-mapped and read in place. Secret, item and relationship
+// names are stored once in a symbol table and referenced by 16-bit ids. Older text saves are imported.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SAVE_H
+#define OSIRIS_SAVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "game.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// File header; the payload that follows is covered by the checksum
+struct SaveHeader {
+    char magic[4];              // "OSAV"
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t payload_size;
+    uint32_t checksum;          // CRC-32 of the payload
+    uint32_t reserved[2];
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Fixed part of the payload
+///
+/// Followed by, in order: the SaveCredential (from version 2 on), symbol_count + 1 uint32 offsets into the string
+/// area, relationship_count SaveRelationship entries, secret_count and item_count uint16 symbol ids, then the string
+/// area holding the symbol bytes and finally the username. All integers are little-endian.
+struct SaveFixed {
+    int32_t scene;
+    int32_t age;
+    int32_t strength;
+    int32_t intelligence;
+    int32_t dexterity;
+    int32_t stress_level;
+    int32_t sanity;
+    int32_t osiris_trust;
+    int32_t loop_count;
+    uint8_t has_admin_access;
+    uint8_t time_loop_active;
+    uint16_t symbol_count;
+    uint16_t relationship_count;
+    uint16_t secret_count;
+    uint16_t item_count;
+    uint16_t username_length;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Player's clearance code, right after SaveFixed; all zero for a player without one
+struct SaveCredential {
+    uint64_t salt;
+    uint8_t hash[Credential::kHashBytes];
+};
+
+struct SaveRelationship {
+    uint16_t symbol;
+    int16_t status;
+};
+
+constexpr uint16_t kSaveVersion = 2;             // Version 1 saves, without a credential, are still read
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Read-only, memory-mapped view of a binary save; every accessor reads straight from the mapping
+///
+/// Images are not necessarily aligned (save log snapshots sit at any offset inside a string), so fields are copied
+/// out with memcpy rather than read through pointers cast from the image.
+class SaveView {
+public:
+    SaveView() = default;
+    ~SaveView();
+    SaveView(const SaveView&) = delete;
+    SaveView& operator=(const SaveView&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Map a save file and validate its header, sizes and checksum
+    /// @param path Save file path
+    /// @return False if the file is missing, truncated, from an unknown version or corrupt
+    bool open(const std::string& path);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Validate an in-memory save image without taking ownership of it
+    /// @param data Image bytes (must stay alive while the view is used)
+    /// @param size Image size
+    /// @return False if the image is invalid
+    bool attach(const void* data, size_t size);
+
+    const SaveHeader& header() const { return header_; }
+    const SaveFixed& fixed() const { return fixed_; }
+    const SaveCredential* credential() const { return has_credential_ ? &credential_ : nullptr; }  // Null in v1
+    std::string_view symbol(uint16_t id) const;
+    SaveRelationship relationship(size_t index) const { return entry<SaveRelationship>(relationships_, index); }
+    uint16_t secret(size_t index) const { return entry<uint16_t>(secrets_, index); }
+    uint16_t item(size_t index) const { return entry<uint16_t>(items_, index); }
+    std::string_view username() const;
+
+private:
+    void unmap();
+
+    /// Element of an array in the image, copied out whatever its alignment
+    template <typename T>
+    static T entry(const char* array, size_t index) {
+        T value;
+        std::memcpy(&value, array + index * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    void* data_ = nullptr;      // Owned mapping, if any
+    size_t size_ = 0;
+    const char* base_ = nullptr;
+    SaveHeader header_{};
+    SaveFixed fixed_{};
+    SaveCredential credential_{};
+    bool has_credential_ = false;
+    const char* offsets_ = nullptr;             // uint32_t array
+    const char* relationships_ = nullptr;       // SaveRelationship array
+    const char* secrets_ = nullptr;             // uint16_t array
+    const char* items_ = nullptr;               // uint16_t array
+    const char* strings_ = nullptr;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Serialize a player and the time loop state into a save image
+/// @param player Player to save
+/// @param state Game state holding the time loop
+/// @param image Receives the complete file contents (reused between calls)
+void encodeSave(const Player& player, const GameState& state, std::string& image);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Rebuild a player and the time loop state from a validated save
+/// @param view Open save view
+/// @param player Receives the saved player
+/// @param state Receives the saved time loop state
+void decodeSave(const SaveView& view, Player& player, GameState& state);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Write a binary save crash-safely: the image is synced to a temporary file that is then renamed over the target,
+/// and the rename is synced too
+/// @param path Save file path
+/// @param player Player to save
+/// @param state Game state holding the time loop
+/// @return True if the save was written
+bool saveBinaryProgress(const std::string& path, const Player& player, const GameState& state);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Load a binary save
+/// @param path Save file path
+/// @param player Receives the saved player
+/// @param state Receives the saved time loop state
+/// @return False if there is no valid save at path
+bool loadBinaryProgress(const std::string& path, Player& player, GameState& state);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Import a save written by the old text format (enhanced_savegame.txt)
+/// @param path Text save path
+/// @param player Receives the saved player
+/// @return False if the file does not exist
+bool importTextProgress(const std::string& path, Player& player);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// CRC-32 (IEEE) of a byte range
+/// @param data Bytes to checksum
+/// @param size Number of bytes
+/// @return Checksum value
+uint32_t saveChecksum(const void* data, size_t size);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Make a rename in a file's directory durable, after writing a file under a temporary name and renaming it over path
+/// @param path File whose directory entry changed
+/// @return False if the directory cannot be synced
+bool syncDirectory(const std::string& path);
+
+#endif // OSIRIS_SAVE_H
@@ -0,0 +1,477 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Save log
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "savelog.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <ostream>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "save.h"
+#include "trace.h"
+#include "varint.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+constexpr size_t kHeaderSize = 8;
+
+//---------------------------------------------------------------------------------------------------------------------
+void putHeader(string& out) {
+    out.append(savelog::kMagic, sizeof(savelog::kMagic));
+    uint16_t version = savelog::kVersion;
+    uint16_t reserved = 0;
+    out.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.append(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frame the payload that follows a placeholder tag byte at record_start, which runs to the end of out
+void closeRecord(string& out, size_t record_start, uint8_t tag) {
+    size_t payload_start = record_start + 1;
+    string length;
+    putVarint(length, out.size() - payload_start);
+    out.insert(payload_start, length);
+    out[record_start] = static_cast<char>(tag);
+    size_t payload_size = out.size() - payload_start - length.size();
+    uint32_t checksum = saveChecksum(out.data() + payload_start + length.size(), payload_size);
+    out.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void putNumber(string& out, savelog::Field field, int64_t from, int64_t to) {
+    if (from == to) return;
+    out += static_cast<char>(field);
+    putVarint(out, zigzag(to - from));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t N>
+void putSetChanges(string& out, const std::bitset<N>& from, const std::bitset<N>& to, const SymbolTable<N>& names,
+                   savelog::Field gained, savelog::Field lost) {
+    if (from == to) return;
+    for (SymbolId id = 0; id < names.size(); ++id) {
+        if (from.test(id) == to.test(id)) continue;
+        out += static_cast<char>(to.test(id) ? gained : lost);
+        putBytes(out, names.name(id));
+    }
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveLogStats::merge(const SaveLogStats& other) {
+    deltas += other.deltas;
+    snapshots += other.snapshots;
+    bytes += other.bytes;
+    syncs += other.syncs;
+    replayed += other.replayed;
+    torn_bytes += other.torn_bytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveLogStats::print(std::ostream& out) const {
+    out << "Save log: " << deltas << " deltas and " << snapshots << " snapshots in " << bytes << " bytes, " << syncs
+        << " syncs, " << replayed << " deltas replayed, " << torn_bytes << " torn bytes cut" << std::endl;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveLog::SaveLog()
+    : fd_(-1), end_(0), ino_(0), has_state_(false), snapshot_bytes_(0), delta_bytes_(0), unsynced_(0) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveLog::~SaveLog() {
+    close();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::load(const string& path, Player& player, GameState& state) {
+    OSIRIS_TRACE_SCOPE("save.load");
+    if (!lock(path, false)) return false;
+    flock(fd_, LOCK_UN);
+    if (!has_state_) return false;
+    player = last_.player;
+    state.restoreTimeLoop(last_.loop_active, last_.loop_count);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::save(const string& path, const Player& player, const GameState& state) {
+    OSIRIS_TRACE_SCOPE("save.append");
+    if (!lock(path, true)) return false;
+
+    bool ok = true;
+    if (!has_state_) {
+        // Nothing to build on: an empty file, a save from before logs or another program's file
+        Saved saved;
+        saved.player = player;
+        saved.loop_active = state.isInTimeLoop();
+        saved.loop_count = state.getLoopCount();
+        ok = compact(saved);
+    } else {
+        static thread_local string record;
+        record.assign(1, '\0');
+        encodeDelta(player, state, record);
+        if (record.size() > 1) {
+            record += static_cast<char>(savelog::END);
+            closeRecord(record, 0, savelog::DELTA);
+            ok = append(record);
+            if (ok) {
+                ++stats_.deltas;
+                delta_bytes_ += record.size();
+                last_.player = player;
+                last_.loop_active = state.isInTimeLoop();
+                last_.loop_count = state.getLoopCount();
+            }
+        }
+        if (ok && delta_bytes_ > std::max(kCompactMinimum, snapshot_bytes_ * kCompactRatio)) ok = compact(last_);
+    }
+
+    if (fd_ >= 0) flock(fd_, LOCK_UN);
+    return ok;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::flush() {
+    if (fd_ < 0 || unsynced_ == 0) return true;
+    return sync();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveLog::close() {
+    if (fd_ < 0) return;
+    if (unsynced_ > 0) sync();
+    ::close(fd_);
+    fd_ = -1;
+    path_.clear();
+    end_ = 0;
+    has_state_ = false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::lock(const string& path, bool create) {
+    for (;;) {
+        if (fd_ < 0 || path != path_) {
+            close();
+            fd_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0644);
+            if (fd_ < 0) return false;
+            struct stat info{};
+            fstat(fd_, &info);
+            path_ = path;
+            ino_ = info.st_ino;
+            last_ = Saved();
+            last_sync_ = std::chrono::steady_clock::now();
+        }
+        if (flock(fd_, LOCK_EX) != 0) return false;
+
+        // Another log may have compacted the file while this one waited; follow the path to the new file
+        struct stat info{};
+        if (stat(path_.c_str(), &info) == 0 && info.st_ino == ino_) break;
+        close();
+    }
+    if (catchUp()) return true;
+    flock(fd_, LOCK_UN);
+    return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::catchUp() {
+    struct stat info{};
+    if (fstat(fd_, &info) != 0) return false;
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+    if (size == end_) return true;
+    if (size < end_) end_ = 0;      // Cut short behind this log's back; read it again from the start
+
+    static thread_local string data;
+    data.resize(static_cast<size_t>(size - end_));
+    size_t got = 0;
+    while (got < data.size()) {
+        ssize_t n = pread(fd_, &data[got], data.size() - got, static_cast<off_t>(end_ + got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        got += static_cast<size_t>(n);
+    }
+
+    size_t pos = 0;
+    if (end_ == 0) {
+        last_ = Saved();
+        has_state_ = false;
+        snapshot_bytes_ = 0;
+        delta_bytes_ = 0;
+
+        // A plain binary save is the state to continue from; the first save replaces it with a log
+        if (data.size() >= sizeof(SaveHeader) && std::memcmp(data.data(), "OSAV", 4) == 0) {
+            SaveView view;
+            if (view.attach(data.data(), data.size())) applySnapshot(view);
+            return true;
+        }
+        uint16_t version = 0;
+        if (data.size() >= kHeaderSize) std::memcpy(&version, data.data() + sizeof(savelog::kMagic), sizeof(version));
+        if (data.size() < kHeaderSize || std::memcmp(data.data(), savelog::kMagic, sizeof(savelog::kMagic)) != 0 ||
+            version != savelog::kVersion) {
+            return true;
+        }
+        pos = kHeaderSize;
+    }
+
+    // Replay up to the first record that is incomplete or fails its checksum
+    size_t valid = pos;
+    ByteCursor cursor(data, pos);
+    while (!cursor.done()) {
+        uint8_t tag = 0;
+        string_view payload;
+        string_view checksum;
+        if (!cursor.byte(tag) || !cursor.bytes(payload) || !cursor.raw(sizeof(uint32_t), checksum)) break;
+        uint32_t expected = 0;
+        std::memcpy(&expected, checksum.data(), sizeof(expected));
+        if (saveChecksum(payload.data(), payload.size()) != expected) break;
+
+        if (tag == savelog::SNAPSHOT) {
+            SaveView view;
+            if (!view.attach(payload.data(), payload.size())) break;
+            applySnapshot(view);
+            snapshot_bytes_ = cursor.pos() - valid;
+        } else if (tag == savelog::DELTA && has_state_) {
+            Saved next = last_;
+            if (!applyDelta(payload, next)) break;
+            last_ = std::move(next);
+            delta_bytes_ += cursor.pos() - valid;
+            ++stats_.replayed;
+        } else {
+            break;
+        }
+        valid = cursor.pos();
+    }
+
+    end_ += valid;
+    if (valid < data.size()) {
+        // A record torn by a crash; cut it off so the next append follows the last good one
+        stats_.torn_bytes += data.size() - valid;
+        if (ftruncate(fd_, static_cast<off_t>(end_)) != 0) return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveLog::applySnapshot(const SaveView& view) {
+    GameState state;
+    decodeSave(view, last_.player, state);
+    last_.loop_active = state.isInTimeLoop();
+    last_.loop_count = state.getLoopCount();
+    has_state_ = true;
+    delta_bytes_ = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::applyDelta(string_view payload, Saved& saved) {
+    ByteCursor cursor(payload, 0);
+    Player& player = saved.player;
+    for (;;) {
+        uint8_t field = 0;
+        if (!cursor.byte(field)) return false;
+
+        int64_t change = 0;
+        string_view name;
+        switch (field) {
+            case savelog::END:
+                return cursor.done();
+            case savelog::SCENE:
+            case savelog::AGE:
+            case savelog::STRENGTH:
+            case savelog::INTELLIGENCE:
+            case savelog::DEXTERITY:
+            case savelog::STRESS:
+            case savelog::SANITY:
+            case savelog::TRUST: {
+                if (!cursor.signedVarint(change)) return false;
+                int* const values[] = {&player.current_scene, &player.age, &player.strength, &player.intelligence,
+                                       &player.dexterity, &player.stress_level, &player.sanity, &player.osiris_trust};
+                int& value = *values[field - savelog::SCENE];
+                value = static_cast<int>(value + change);
+                break;
+            }
+            case savelog::ADMIN: {
+                uint8_t admin = 0;
+                if (!cursor.byte(admin)) return false;
+                player.has_admin_access = admin != 0;
+                break;
+            }
+            case savelog::LOOP: {
+                uint8_t active = 0;
+                if (!cursor.byte(active) || !cursor.signedVarint(change)) return false;
+                saved.loop_active = active != 0;
+                saved.loop_count = static_cast<int>(saved.loop_count + change);
+                break;
+            }
+            case savelog::USERNAME:
+                if (!cursor.bytes(name)) return false;
+                player.username.assign(name);
+                break;
+            case savelog::CREDENTIAL:
+                if (!cursor.raw(sizeof(SaveCredential), name)) return false;
+                std::memcpy(&player.credential.salt, name.data(), sizeof(uint64_t));
+                std::memcpy(player.credential.hash.data(), name.data() + sizeof(uint64_t), Credential::kHashBytes);
+                break;
+            case savelog::RELATIONSHIP: {
+                if (!cursor.bytes(name) || !cursor.signedVarint(change)) return false;
+                SymbolId id = character_symbols.intern(name);
+                if (id != kNoSymbol) {
+                    player.relationships[id] =
+                        static_cast<RelationshipStatus>(static_cast<int>(player.relationships[id]) + change);
+                }
+                break;
+            }
+            case savelog::SECRET_FOUND:
+            case savelog::SECRET_LOST: {
+                if (!cursor.bytes(name)) return false;
+                SymbolId id = secret_symbols.intern(name);
+                if (id != kNoSymbol) player.discovered_secrets.set(id, field == savelog::SECRET_FOUND);
+                break;
+            }
+            case savelog::ITEM_GAINED:
+            case savelog::ITEM_LOST: {
+                if (!cursor.bytes(name)) return false;
+                SymbolId id = item_symbols.intern(name);
+                if (id != kNoSymbol) player.inventory.set(id, field == savelog::ITEM_GAINED);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveLog::encodeDelta(const Player& player, const GameState& state, string& out) const {
+    const Player& last = last_.player;
+    putNumber(out, savelog::SCENE, last.current_scene, player.current_scene);
+    putNumber(out, savelog::AGE, last.age, player.age);
+    putNumber(out, savelog::STRENGTH, last.strength, player.strength);
+    putNumber(out, savelog::INTELLIGENCE, last.intelligence, player.intelligence);
+    putNumber(out, savelog::DEXTERITY, last.dexterity, player.dexterity);
+    putNumber(out, savelog::STRESS, last.stress_level, player.stress_level);
+    putNumber(out, savelog::SANITY, last.sanity, player.sanity);
+    putNumber(out, savelog::TRUST, last.osiris_trust, player.osiris_trust);
+    if (player.has_admin_access != last.has_admin_access) {
+        out += static_cast<char>(savelog::ADMIN);
+        out += static_cast<char>(player.has_admin_access ? 1 : 0);
+    }
+    if (state.isInTimeLoop() != last_.loop_active || state.getLoopCount() != last_.loop_count) {
+        out += static_cast<char>(savelog::LOOP);
+        out += static_cast<char>(state.isInTimeLoop() ? 1 : 0);
+        putVarint(out, zigzag(static_cast<int64_t>(state.getLoopCount()) - last_.loop_count));
+    }
+    if (player.username != last.username) {
+        out += static_cast<char>(savelog::USERNAME);
+        putBytes(out, player.username);
+    }
+    if (player.credential != last.credential) {
+        out += static_cast<char>(savelog::CREDENTIAL);
+        out.append(reinterpret_cast<const char*>(&player.credential.salt), sizeof(uint64_t));
+        out.append(reinterpret_cast<const char*>(player.credential.hash.data()), Credential::kHashBytes);
+    }
+    for (SymbolId id = 0; id < character_symbols.size(); ++id) {
+        if (player.relationships[id] == last.relationships[id]) continue;
+        out += static_cast<char>(savelog::RELATIONSHIP);
+        putBytes(out, character_symbols.name(id));
+        putVarint(out, zigzag(static_cast<int64_t>(player.relationships[id]) -
+                              static_cast<int64_t>(last.relationships[id])));
+    }
+    putSetChanges(out, last.discovered_secrets, player.discovered_secrets, secret_symbols, savelog::SECRET_FOUND,
+                  savelog::SECRET_LOST);
+    putSetChanges(out, last.inventory, player.inventory, item_symbols, savelog::ITEM_GAINED, savelog::ITEM_LOST);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::compact(const Saved& saved) {
+    static thread_local string image;
+    static thread_local string file;
+    GameState state;
+    state.restoreTimeLoop(saved.loop_active, saved.loop_count);
+    encodeSave(saved.player, state, image);
+
+    file.clear();
+    putHeader(file);
+    file += '\0';
+    file += image;
+    closeRecord(file, kHeaderSize, savelog::SNAPSHOT);
+
+    // The new log is complete on disk before it replaces the old one, and the rename is on disk before the old
+    // records are given up, so a crash leaves one or the other
+    string temp_path = path_ + ".tmp" + std::to_string(static_cast<long>(syscall(SYS_gettid)));
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < file.size()) {
+        ssize_t n = ::write(fd, file.data() + written, file.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        written += static_cast<size_t>(n);
+    }
+    if (written < file.size() || fdatasync(fd) != 0 || std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+        ::close(fd);
+        unlink(temp_path.c_str());
+        return false;
+    }
+    bool durable = syncDirectory(path_);
+
+    // Records still unsynced in the old file are superseded by the snapshot; dropping the old descriptor also
+    // releases its lock to logs waiting on it, which then follow the path here
+    ::close(fd_);
+    fd_ = fd;
+    struct stat info{};
+    fstat(fd_, &info);
+    ino_ = info.st_ino;
+    end_ = file.size();
+    if (&saved != &last_) last_ = saved;
+    has_state_ = true;
+    snapshot_bytes_ = file.size() - kHeaderSize;
+    delta_bytes_ = 0;
+    unsynced_ = 0;
+    last_sync_ = std::chrono::steady_clock::now();
+    ++stats_.snapshots;
+    ++stats_.syncs;
+    stats_.bytes += file.size();
+    return durable;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::append(const string& record) {
+    size_t written = 0;
+    while (written < record.size()) {
+        ssize_t n = pwrite(fd_, record.data() + written, record.size() - written, static_cast<off_t>(end_ + written));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            // Leave no partial record behind for the next append to follow
+            int ignored = ftruncate(fd_, static_cast<off_t>(end_));
+            (void)ignored;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    end_ += record.size();
+    stats_.bytes += record.size();
+
+    ++unsynced_;
+    if (unsynced_ >= kSyncRecords || std::chrono::steady_clock::now() - last_sync_ >= kSyncInterval) sync();
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveLog::sync() {
+    bool synced = fdatasync(fd_) == 0;
+    unsynced_ = 0;
+    last_sync_ = std::chrono::steady_clock::now();
+    ++stats_.syncs;
+    return synced;
+}
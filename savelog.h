@@ -0,0 +1,161 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Save log
+// An append-only log of progress: a full save image (snapshot) followed by compact delta records, each holding only
+// the fields that changed since the record before it. Saving appends one delta instead of rewriting the whole file;
+// once the deltas outgrow the snapshot the log is compacted into a fresh snapshot. Loading replays the snapshot and
+// every intact delta, so a save torn by a crash loses at most the record being written.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SAVELOG_H
+#define OSIRIS_SAVELOG_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+#include "game.h"
+
+class SaveView;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Log file layout
+///
+/// After the header come records: a tag byte, the payload length as a varint, the payload and a little-endian
+/// CRC-32 of the payload. A SNAPSHOT payload is a complete save image (see save.h); a DELTA payload is a list of
+/// field tags with their new values, closed by END. Names of relationships, secrets and items are stored as text,
+/// so logs do not depend on symbol ids.
+namespace savelog {
+
+constexpr char kMagic[4] = {'O', 'L', 'O', 'G'};
+constexpr uint16_t kVersion = 1;
+
+enum Record : uint8_t {
+    SNAPSHOT = 'S',
+    DELTA = 'D'
+};
+
+enum Field : uint8_t {
+    END,
+    SCENE,                  // zigzag varint difference, as are the other numbers
+    AGE,
+    STRENGTH,
+    INTELLIGENCE,
+    DEXTERITY,
+    STRESS,
+    SANITY,
+    TRUST,
+    ADMIN,                  // byte
+    LOOP,                   // active byte, count difference
+    USERNAME,               // bytes
+    RELATIONSHIP,           // name bytes, status difference
+    SECRET_FOUND,           // name bytes
+    SECRET_LOST,
+    ITEM_GAINED,
+    ITEM_LOST,
+    CREDENTIAL              // raw salt and hash, as in SaveCredential
+};
+
+} // namespace savelog
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counters of save logs
+struct SaveLogStats {
+    uint64_t deltas = 0;            // Delta records appended
+    uint64_t snapshots = 0;         // Snapshots written, compactions included
+    uint64_t bytes = 0;             // Bytes written
+    uint64_t syncs = 0;             // fdatasync calls
+    uint64_t replayed = 0;          // Delta records replayed by loads
+    uint64_t torn_bytes = 0;        // Bytes of torn or corrupt tails cut off
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Add another log's counters
+    /// @param other Counters to add
+    void merge(const SaveLogStats& other);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print the counters on one line
+    /// @param out Destination stream
+    void print(std::ostream& out) const;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One player's save log, kept open for appending between saves
+///
+/// Appends are synced to disk in batches: after kSyncRecords unsynced records, when kSyncInterval has passed since
+/// the last sync, at compaction and on close. Several logs may append to the same file, e.g. two connections using
+/// one designation: each append takes an exclusive lock and catches up with records the others wrote first.
+class SaveLog {
+public:
+    static constexpr int kSyncRecords = 8;
+    static constexpr auto kSyncInterval = std::chrono::seconds(1);
+    static constexpr size_t kCompactRatio = 4;              // Deltas may grow to this many times the snapshot
+    static constexpr size_t kCompactMinimum = 4096;         // Deltas are never compacted below this size
+
+    SaveLog();
+    ~SaveLog();
+    SaveLog(const SaveLog&) = delete;
+    SaveLog& operator=(const SaveLog&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Open a log and replay it; a binary save from before logs is read as a snapshot. A torn tail is cut off.
+    /// @param path Log file path
+    /// @param player Receives the saved player
+    /// @param state Receives the saved time loop state
+    /// @return False if there is no valid save at path
+    bool load(const std::string& path, Player& player, GameState& state);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Append the changes since the last save, starting a new log if path holds none yet
+    /// @param path Log file path
+    /// @param player Player to save
+    /// @param state Game state holding the time loop
+    /// @return True if the record was written
+    bool save(const std::string& path, const Player& player, const GameState& state);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Sync outstanding records now instead of with the next batch, e.g. when the player saves explicitly
+    /// @return False if the records could not be synced
+    bool flush();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Sync outstanding records and close the file
+    void close();
+
+    /// Bytes in the log after the last load or save
+    uint64_t size() const { return end_; }
+    const SaveLogStats& stats() const { return stats_; }
+
+private:
+    /// Everything a save holds
+    struct Saved {
+        Player player;
+        bool loop_active = false;
+        int loop_count = 0;
+    };
+
+    bool lock(const std::string& path, bool create);
+    bool catchUp();
+    void applySnapshot(const SaveView& view);
+    bool applyDelta(std::string_view payload, Saved& saved);
+    void encodeDelta(const Player& player, const GameState& state, std::string& out) const;
+    bool compact(const Saved& saved);
+    bool append(const std::string& record);
+    bool sync();
+
+    std::string path_;
+    int fd_;
+    uint64_t end_;                  // Offset after the last record this log knows about
+    uint64_t ino_;                  // File the descriptor refers to, to notice a compaction by another log
+    Saved last_;                    // State after the last record
+    bool has_state_;                // A snapshot has been read or written; deltas can follow
+    size_t snapshot_bytes_;
+    size_t delta_bytes_;            // Bytes of deltas after the snapshot
+    int unsynced_;
+    std::chrono::steady_clock::time_point last_sync_;
+    SaveLogStats stats_;
+};
+
+#endif // OSIRIS_SAVELOG_H
@@ -0,0 +1,320 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Save store
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "savestore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iomanip>
+#include <ostream>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "savelog.h"
+
+using std::string;
+using std::string_view;
+
+static_assert(sizeof(IndexHeader) == 24, "index header layout changed");
+static_assert(sizeof(IndexEntry) == 64, "index entry layout changed");
+
+namespace {
+
+constexpr char kIndexName[] = "index";
+constexpr char kSlotSuffix[] = ".sav";
+
+// Entries in use per ten entries of capacity that make the table grow
+constexpr uint32_t kMaxLoadTenths = 7;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// FNV-1a
+uint64_t nameHash(string_view name) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (char c : name) hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ULL;
+    return hash;
+}
+
+size_t indexBytes(uint32_t capacity) {
+    return sizeof(IndexHeader) + static_cast<size_t>(capacity) * sizeof(IndexEntry);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Holds the store's mutex and a lock on its index file for the duration of one operation
+class IndexLock {
+public:
+    IndexLock(std::mutex& mutex, int fd, int operation) : guard_(mutex), fd_(fd) { flock(fd_, operation); }
+    ~IndexLock() { flock(fd_, LOCK_UN); }
+    IndexLock(const IndexLock&) = delete;
+    IndexLock& operator=(const IndexLock&) = delete;
+
+private:
+    std::lock_guard<std::mutex> guard_;
+    int fd_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+SlotInfo slotInfo(const IndexEntry& entry) {
+    SlotInfo info;
+    info.name.assign(entry.key());
+    info.scene = entry.scene;
+    info.loop_active = entry.loop_active != 0;
+    info.loop_count = entry.loop_count;
+    info.phase = static_cast<SlotPhase>(entry.phase);
+    info.saved_at = entry.saved_at;
+    info.bytes = entry.bytes;
+    return info;
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveStore::SaveStore() : fd_(-1), base_(nullptr), mapped_(0), capacity_(0) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveStore::~SaveStore() {
+    unmap();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveStore::open(const string& dir, string& error) {
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        error = "cannot create " + dir + ": " + std::strerror(errno);
+        return false;
+    }
+    dir_ = dir;
+    string path = dir_ + "/" + kIndexName;
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    IndexLock lock(mutex_, fd_, LOCK_EX);
+    if (!map(error)) return false;
+    const IndexHeader* index = mapped_ >= sizeof(IndexHeader) ? &header() : nullptr;
+    bool valid = index != nullptr && std::memcmp(index->magic, "OIDX", 4) == 0 && index->version == kIndexVersion &&
+                 index->header_size == sizeof(IndexHeader) && index->capacity == capacity_ && capacity_ != 0 &&
+                 (capacity_ & (capacity_ - 1)) == 0;
+    return valid || rebuild(error);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+string SaveStore::slotPath(string_view name) const {
+    string path = dir_;
+    path += '/';
+    path.append(name.data(), name.size());
+    path += kSlotSuffix;
+    return path;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveStore::find(string_view name, SlotInfo& info) const {
+    if (name.empty() || name.size() > IndexEntry::kNameBytes) return false;
+    IndexLock lock(mutex_, fd_, LOCK_SH);
+    if (!remapIfGrown()) return false;
+    const IndexEntry* entry = probe(name, nameHash(name));
+    if (entry->name_length == 0) return false;
+    info = slotInfo(*entry);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveStore::record(string_view name, const Player& player, const GameState& state, SlotPhase phase,
+                       uint64_t bytes) {
+    if (name.empty() || name.size() > IndexEntry::kNameBytes) return false;
+    IndexLock lock(mutex_, fd_, LOCK_EX);
+    if (!remapIfGrown()) return false;
+
+    uint64_t hash = nameHash(name);
+    IndexEntry* entry = probe(name, hash);
+    if (entry->name_length == 0) {
+        if ((header().count + 1) * 10 > capacity_ * kMaxLoadTenths) {
+            if (!grow()) return false;
+            entry = probe(name, hash);
+        }
+        entry->hash = hash;
+        std::memcpy(entry->name, name.data(), name.size());
+        entry->name_length = static_cast<uint8_t>(name.size());
+        ++header().count;
+    }
+    entry->phase = static_cast<uint8_t>(phase);
+    entry->loop_active = state.isInTimeLoop() ? 1 : 0;
+    entry->scene = player.current_scene;
+    entry->saved_at = static_cast<int64_t>(std::time(nullptr));
+    entry->loop_count = state.getLoopCount();
+    entry->bytes = static_cast<uint32_t>(std::min<uint64_t>(bytes, UINT32_MAX));
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveStore::list(std::vector<SlotInfo>& slots) const {
+    slots.clear();
+    IndexLock lock(mutex_, fd_, LOCK_SH);
+    if (!remapIfGrown()) return;
+    slots.reserve(header().count);
+    const IndexEntry* table = entries();
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        if (table[i].name_length != 0) slots.push_back(slotInfo(table[i]));
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t SaveStore::size() const {
+    IndexLock lock(mutex_, fd_, LOCK_SH);
+    return remapIfGrown() ? header().count : 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveStore::map(string& error) {
+    unmap();
+    struct stat info{};
+    if (fstat(fd_, &info) != 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size == 0) return true;
+
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+        error = string("cannot map the save index: ") + std::strerror(errno);
+        return false;
+    }
+    base_ = base;
+    mapped_ = size;
+    capacity_ = size > sizeof(IndexHeader) ? static_cast<uint32_t>((size - sizeof(IndexHeader)) / sizeof(IndexEntry))
+                                           : 0;
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveStore::unmap() {
+    if (base_ != nullptr) munmap(base_, mapped_);
+    base_ = nullptr;
+    mapped_ = 0;
+    capacity_ = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveStore::remapIfGrown() const {
+    if (base_ == nullptr) return false;
+    if (header().capacity == capacity_) return true;
+
+    // Another process grew the table; map it at its new size
+    string error;
+    return const_cast<SaveStore*>(this)->map(error) && capacity_ != 0 && header().capacity == capacity_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+IndexEntry* SaveStore::probe(string_view name, uint64_t hash) const {
+    IndexEntry* table = entries();
+    uint32_t mask = capacity_ - 1;
+    for (uint32_t i = static_cast<uint32_t>(hash) & mask;; i = (i + 1) & mask) {
+        IndexEntry& entry = table[i];
+        if (entry.name_length == 0 || (entry.hash == hash && entry.key() == name)) return &entry;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveStore::grow() {
+    std::vector<IndexEntry> used;
+    used.reserve(header().count);
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        if (entries()[i].name_length != 0) used.push_back(entries()[i]);
+    }
+
+    // A zero capacity marks the table as being rebuilt, so a crash part-way leaves an index open() rebuilds
+    uint32_t capacity = capacity_ * 2;
+    header().capacity = 0;
+    string error;
+    if (ftruncate(fd_, static_cast<off_t>(indexBytes(capacity))) != 0 || !map(error)) return false;
+
+    std::memset(entries(), 0, static_cast<size_t>(capacity_) * sizeof(IndexEntry));
+    for (const IndexEntry& entry : used) *probe(entry.key(), entry.hash) = entry;
+    header().capacity = capacity_;
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveStore::rebuild(string& error) {
+    unmap();
+    if (ftruncate(fd_, 0) != 0 || ftruncate(fd_, static_cast<off_t>(indexBytes(kInitialCapacity))) != 0 ||
+        !map(error)) {
+        if (error.empty()) error = string("cannot size the save index: ") + std::strerror(errno);
+        return false;
+    }
+    IndexHeader& index = header();
+    std::memcpy(index.magic, "OIDX", 4);
+    index.version = kIndexVersion;
+    index.header_size = sizeof(IndexHeader);
+    index.count = 0;
+    index.capacity = capacity_;
+
+    // Index every slot file in the directory. Rebuilding does not know the story, so every slot reads as PLAYING
+    // until it is next saved.
+    DIR* directory = opendir(dir_.c_str());
+    if (directory == nullptr) return true;
+    while (dirent* item = readdir(directory)) {
+        string_view file(item->d_name);
+        size_t suffix = sizeof(kSlotSuffix) - 1;
+        if (file.size() <= suffix || file.substr(file.size() - suffix) != kSlotSuffix) continue;
+        string_view name = file.substr(0, file.size() - suffix);
+        if (name.size() > IndexEntry::kNameBytes) continue;
+
+        SaveLog log;
+        Player player;
+        GameState state;
+        struct stat info{};
+        string path = slotPath(name);
+        if (!log.load(path, player, state) || stat(path.c_str(), &info) != 0) continue;
+
+        uint64_t hash = nameHash(name);
+        if ((header().count + 1) * 10 > capacity_ * kMaxLoadTenths && !grow()) break;
+        IndexEntry* entry = probe(name, hash);
+        if (entry->name_length != 0) continue;
+        entry->hash = hash;
+        std::memcpy(entry->name, name.data(), name.size());
+        entry->name_length = static_cast<uint8_t>(name.size());
+        entry->phase = static_cast<uint8_t>(SlotPhase::PLAYING);
+        entry->loop_active = state.isInTimeLoop() ? 1 : 0;
+        entry->scene = player.current_scene;
+        entry->saved_at = static_cast<int64_t>(info.st_mtime);
+        entry->loop_count = state.getLoopCount();
+        entry->bytes = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(info.st_size), UINT32_MAX));
+        ++header().count;
+    }
+    closedir(directory);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void printSlots(std::vector<SlotInfo>& slots, std::ostream& out) {
+    std::sort(slots.begin(), slots.end(), [](const SlotInfo& a, const SlotInfo& b) { return a.name < b.name; });
+    out << std::left << std::setw(IndexEntry::kNameBytes + 2) << "Slot" << std::right << std::setw(6) << "Scene"
+        << std::setw(6) << "Loop" << std::setw(10) << "Phase" << "  " << std::left << std::setw(18) << "Saved"
+        << std::right << std::setw(8) << "Bytes" << '\n';
+    for (const SlotInfo& slot : slots) {
+        char saved[32] = "-";
+        time_t when = static_cast<time_t>(slot.saved_at);
+        tm local{};
+        if (localtime_r(&when, &local) != nullptr) std::strftime(saved, sizeof(saved), "%Y-%m-%d %H:%M", &local);
+        out << std::left << std::setw(IndexEntry::kNameBytes + 2) << slot.name << std::right << std::setw(6)
+            << slot.scene + 1 << std::setw(6);
+        if (slot.loop_active) {
+            out << slot.loop_count;
+        } else {
+            out << "-";
+        }
+        out << std::setw(10) << (slot.phase == SlotPhase::COMPLETE ? "complete" : "playing") << "  " << std::left
+            << std::setw(18) << saved << std::right << std::setw(8) << slot.bytes << '\n';
+    }
+    out << slots.size() << (slots.size() == 1 ? " slot" : " slots") << std::endl;
+}
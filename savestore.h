@@ -0,0 +1,148 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Save store
+// A directory of save slots, one save log per name, with an index file mapping each name to a summary of its slot:
+// scene, time loop, phase, when it was last saved and how large its log is. The index is a memory-mapped hash table,
+// so looking up a slot is one probe and listing every slot is one pass over the table; neither opens a save.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SAVESTORE_H
+#define OSIRIS_SAVESTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "game.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Where a slot's game stood when it was last saved
+enum class SlotPhase : uint8_t {
+    PLAYING,
+    COMPLETE                    // Saved at the final scene
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Index file header
+struct IndexHeader {
+    char magic[4];              // "OIDX"
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t capacity;          // Entries in the table, a power of two; 0 while the table is being rebuilt
+    uint32_t count;             // Entries in use
+    uint64_t reserved;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One index entry, found by linear probing from the name's hash
+struct IndexEntry {
+    static constexpr size_t kNameBytes = 32;
+
+    uint64_t hash;
+    char name[kNameBytes];
+    uint8_t name_length;        // 0 for a free entry
+    uint8_t phase;              // SlotPhase
+    uint8_t loop_active;
+    uint8_t reserved;
+    int32_t scene;
+    int64_t saved_at;           // Seconds since the epoch
+    int32_t loop_count;
+    uint32_t bytes;             // Size of the slot's save log
+
+    std::string_view key() const { return std::string_view(name, name_length); }
+};
+
+constexpr uint16_t kIndexVersion = 1;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A slot as the index describes it
+struct SlotInfo {
+    std::string name;
+    int scene = 0;
+    bool loop_active = false;
+    int loop_count = 0;
+    SlotPhase phase = SlotPhase::PLAYING;
+    int64_t saved_at = 0;
+    uint64_t bytes = 0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Save slots in one directory and their index
+///
+/// The store may be shared by threads; processes sharing a directory serialize through a lock on the index file.
+/// The index holds nothing that is not in the slots themselves, so an index that is missing or was left half
+/// rebuilt by a crash is rebuilt from the slot files when the store is opened.
+class SaveStore {
+public:
+    static constexpr uint32_t kInitialCapacity = 1024;
+
+    SaveStore();
+    ~SaveStore();
+    SaveStore(const SaveStore&) = delete;
+    SaveStore& operator=(const SaveStore&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Open a store, creating the directory and index as needed
+    /// @param dir Store directory
+    /// @param error Receives the reason on failure
+    /// @return False if the directory or index cannot be used
+    bool open(const std::string& dir, std::string& error);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// File holding a slot's save log
+    /// @param name Slot name
+    /// @return Path inside the store directory
+    std::string slotPath(std::string_view name) const;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Look a slot up in the index
+    /// @param name Slot name
+    /// @param info Receives the slot's summary
+    /// @return False if there is no such slot
+    bool find(std::string_view name, SlotInfo& info) const;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Record a save of a slot in the index, adding the slot if it is new
+    /// @param name Slot name (at most IndexEntry::kNameBytes bytes)
+    /// @param player Player just saved
+    /// @param state Game state holding the time loop
+    /// @param phase Where the game stands
+    /// @param bytes Size of the slot's save log
+    /// @return False if the name is too long or the index cannot grow
+    bool record(std::string_view name, const Player& player, const GameState& state, SlotPhase phase, uint64_t bytes);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Every slot in the index, in no particular order
+    /// @param slots Receives the slots (cleared first)
+    void list(std::vector<SlotInfo>& slots) const;
+
+    size_t size() const;
+
+private:
+    bool map(std::string& error);
+    void unmap();
+    bool remapIfGrown() const;
+    bool grow();
+    bool rebuild(std::string& error);
+    IndexEntry* probe(std::string_view name, uint64_t hash) const;
+    IndexHeader& header() const { return *static_cast<IndexHeader*>(base_); }
+    IndexEntry* entries() const { return reinterpret_cast<IndexEntry*>(static_cast<char*>(base_) + sizeof(IndexHeader)); }
+
+    std::string dir_;
+    int fd_;
+    mutable void* base_;
+    mutable size_t mapped_;
+    mutable uint32_t capacity_;     // Capacity of the current mapping
+    mutable std::mutex mutex_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Print slots as a table, sorted by name
+/// @param slots Slots to print
+/// @param out Destination stream
+void printSlots(std::vector<SlotInfo>& slots, std::ostream& out);
+
+#endif // OSIRIS_SAVESTORE_H
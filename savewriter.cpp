@@ -0,0 +1,260 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Background save writer
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "savewriter.h"
+
+#include <cerrno>
+#include <iostream>
+#include <vector>
+
+#include "trace.h"
+
+using std::string;
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriterStats::merge(const SaveWriterStats& other) {
+    submitted += other.submitted;
+    written += other.written;
+    coalesced += other.coalesced;
+    failed += other.failed;
+    batches += other.batches;
+    flushes += other.flushes;
+    logs.merge(other.logs);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriterStats::print(std::ostream& out) const {
+    out << "Save writer: " << submitted << " saves submitted, " << written << " written in " << batches
+        << " batches, " << coalesced << " coalesced, " << failed << " failed, " << flushes << " flushes" << std::endl;
+    logs.print(out);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveWriter::SaveWriter() : stopping_(false), store_(nullptr), uses_(0), submitted_(0), flushes_(0) {
+    Node* stub = new Node();
+    head_.store(stub, std::memory_order_relaxed);
+    tail_ = stub;
+    sem_init(&ready_, 0, 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveWriter::~SaveWriter() {
+    stop();
+    SaveJob job;
+    while (pop(job)) {}
+    delete tail_;
+    sem_destroy(&ready_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriter::start(SaveStore* store) {
+    if (thread_.joinable()) return;
+    store_ = store;
+    stopping_.store(false);
+    thread_ = std::thread(&SaveWriter::run, this);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriter::submit(const string& path, const string& slot, const Player& player, SlotPhase phase) {
+    OSIRIS_TRACE_SCOPE("save.submit");
+    Node* node = new Node();
+    node->job.path = path;
+    node->job.slot = slot;
+    node->job.player = player;
+    node->job.loop_active = game_state.isInTimeLoop();
+    node->job.loop_count = game_state.getLoopCount();
+    node->job.phase = phase;
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    push(node);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriter::load(const string& path, std::function<void(LoadedSave&)> done) {
+    Node* node = new Node();
+    node->job.path = path;
+    node->job.loaded = std::move(done);
+    push(node);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriter::flush() {
+    if (!thread_.joinable()) return;
+    OSIRIS_TRACE_SCOPE("save.flush");
+
+    // A token queued behind this thread's saves is reached only after they are written
+    std::promise<void> flushed;
+    std::future<void> done = flushed.get_future();
+    Node* node = new Node();
+    node->job.flushed = &flushed;
+    flushes_.fetch_add(1, std::memory_order_relaxed);
+    push(node);
+    done.wait();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriter::stop() {
+    if (!thread_.joinable()) return;
+    stopping_.store(true);
+    sem_post(&ready_);
+    thread_.join();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveWriterStats SaveWriter::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    SaveWriterStats stats = stats_;
+    stats.submitted = submitted_.load(std::memory_order_relaxed);
+    stats.flushes = flushes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriter::push(Node* node) {
+    // Claim the head, then link the previous head to it; the writer sees the node once the link is stored
+    Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+    sem_post(&ready_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveWriter::pop(SaveJob& job) {
+    Node* next = tail_->next.load(std::memory_order_acquire);
+    if (next == nullptr) return false;
+
+    // The node taken from becomes the new consumed tail
+    job = std::move(next->job);
+    delete tail_;
+    tail_ = next;
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriter::run() {
+    std::vector<SaveJob> batch;
+    std::vector<SaveJob> loads;
+    std::vector<std::promise<void>*> flushed;
+    std::unordered_map<string, size_t> newest;     // Batch position of each target's save
+    SaveJob job;
+
+    for (;;) {
+        while (sem_wait(&ready_) != 0 && errno == EINTR) {}
+
+        batch.clear();
+        loads.clear();
+        flushed.clear();
+        newest.clear();
+        uint64_t coalesced = 0;
+        while (pop(job)) {
+            if (job.flushed != nullptr) {
+                flushed.push_back(job.flushed);
+                continue;
+            }
+            if (job.loaded) {
+                loads.push_back(std::move(job));
+                continue;
+            }
+            auto found = newest.find(job.path);
+            if (found != newest.end()) {
+                batch[found->second] = std::move(job);
+                ++coalesced;
+            } else {
+                newest.emplace(job.path, batch.size());
+                batch.push_back(std::move(job));
+            }
+        }
+
+        uint64_t failed = 0;
+        for (const SaveJob& save : batch) failed += write(save) ? 0 : 1;
+
+        // Reads follow the batch's writes, so they see every save queued before them (and perhaps newer ones)
+        for (const SaveJob& load : loads) read(load);
+
+        // A waiter was promised its saves are on disk, not merely written. They may have been written by an earlier
+        // batch, so every open log with unsynced records is synced; logs closed to make room were synced on close.
+        uint64_t unsynced = 0;
+        if (!flushed.empty()) {
+            for (auto& open : logs_) {
+                if (open.second.log->flush()) continue;
+                std::cerr << "Could not sync save file: " << open.first << std::endl;
+                ++unsynced;
+            }
+        }
+        for (std::promise<void>* waiter : flushed) waiter->set_value();
+        if (!batch.empty() || !flushed.empty()) {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            ++stats_.batches;
+            stats_.written += batch.size() - failed;
+            stats_.coalesced += coalesced;
+            stats_.failed += failed + unsynced;
+        }
+
+        if (stopping_.load() && tail_->next.load(std::memory_order_acquire) == nullptr) break;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    for (auto& open : logs_) {
+        open.second.log->close();
+        stats_.logs.merge(open.second.log->stats());
+    }
+    logs_.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SaveWriter::write(const SaveJob& job) {
+    OSIRIS_TRACE_SCOPE("save.write");
+    // The writer thread's own game_state carries the saved time loop into the log and the store
+    game_state.restoreTimeLoop(job.loop_active, job.loop_count);
+    SaveLog& log = logFor(job.path);
+    bool ok = log.save(job.path, job.player, game_state);
+    if (ok && store_ != nullptr && !job.slot.empty()) {
+        ok = store_->record(job.slot, job.player, game_state, job.phase, log.size());
+    }
+    if (!ok) std::cerr << "Could not write save file: " << job.path << std::endl;
+    return ok;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SaveWriter::read(const SaveJob& job) {
+    OSIRIS_TRACE_SCOPE("save.read");
+    LoadedSave loaded;
+    SaveLog log;
+    loaded.found = log.load(job.path, loaded.player, game_state);
+    if (loaded.found) {
+        loaded.loop_active = game_state.isInTimeLoop();
+        loaded.loop_count = game_state.getLoopCount();
+    } else {
+        loaded.player = Player();
+    }
+    log.close();
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.logs.merge(log.stats());
+    }
+    job.loaded(loaded);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SaveLog& SaveWriter::logFor(const string& path) {
+    auto found = logs_.find(path);
+    if (found != logs_.end()) {
+        found->second.last_used = ++uses_;
+        return *found->second.log;
+    }
+
+    // Close the least recently used log to stay within kOpenLogs descriptors
+    if (logs_.size() >= kOpenLogs) {
+        auto oldest = logs_.begin();
+        for (auto it = logs_.begin(); it != logs_.end(); ++it) {
+            if (it->second.last_used < oldest->second.last_used) oldest = it;
+        }
+        oldest->second.log->close();
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.logs.merge(oldest->second.log->stats());
+        logs_.erase(oldest);
+    }
+    OpenLog& open = logs_[path];
+    open.log.reset(new SaveLog());
+    open.last_used = ++uses_;
+    return *open.log;
+}
@@ -0,0 +1,154 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Background save writer
+// Saves are handed to a writer thread instead of being written by the thread playing the game. A save is a copy of
+// the player and the time loop state pushed onto a lock-free queue; the writer drains the queue in batches, keeps
+// only the newest save of each target in a batch, and appends those to their save logs. Game threads wait for the
+// disk only when they ask to, e.g. when the player chooses to save or quits. Saves are read back through the writer
+// too, so a read sees every save queued before it.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SAVEWRITER_H
+#define OSIRIS_SAVEWRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <semaphore.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "game.h"
+#include "savelog.h"
+#include "savestore.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counters of a save writer
+struct SaveWriterStats {
+    uint64_t submitted = 0;         // Saves handed to the writer
+    uint64_t written = 0;           // Saves written
+    uint64_t coalesced = 0;         // Saves skipped because a newer one of the same target was queued
+    uint64_t failed = 0;            // Saves that could not be written
+    uint64_t batches = 0;           // Times the writer woke up and drained the queue
+    uint64_t flushes = 0;           // Waits for the writer to catch up
+    SaveLogStats logs;              // The logs the saves went to
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Add another writer's counters
+    /// @param other Counters to add
+    void merge(const SaveWriterStats& other);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print the counters
+    /// @param out Destination stream
+    void print(std::ostream& out) const;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A save read back by the writer
+struct LoadedSave {
+    bool found = false;             // False if there is no valid save at the path
+    Player player;
+    bool loop_active = false;
+    int loop_count = 0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One save waiting to be written
+struct SaveJob {
+    std::string path;               // Save log to append to
+    std::string slot;               // Slot to record in the store, empty for none
+    Player player;
+    bool loop_active = false;
+    int loop_count = 0;
+    SlotPhase phase = SlotPhase::PLAYING;
+    std::promise<void>* flushed = nullptr;      // Flush token instead of a save, fulfilled once synced
+    std::function<void(LoadedSave&)> loaded;    // Read of path instead of a save, answered on the writer thread
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Writer thread with a multi-producer queue of saves
+///
+/// Any thread may submit; submitting never blocks and never touches the disk. The queue is an intrusive
+/// linked list that producers append to with one atomic exchange; only the writer thread takes from it. The writer
+/// keeps up to kOpenLogs save logs open, so saving the same player again appends a delta to an open file.
+class SaveWriter {
+public:
+    static constexpr size_t kOpenLogs = 1024;
+
+    SaveWriter();
+    ~SaveWriter();
+    SaveWriter(const SaveWriter&) = delete;
+    SaveWriter& operator=(const SaveWriter&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Start the writer thread
+    /// @param store Store to record slots in, or null if no job names a slot
+    void start(SaveStore* store);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Queue a save of the calling thread's game: player plus the time loop state of game_state
+    /// @param path Save log to append to
+    /// @param slot Slot to record in the store, empty for none
+    /// @param player Player to save (copied)
+    /// @param phase Where the game stands, for the store
+    void submit(const std::string& path, const std::string& slot, const Player& player, SlotPhase phase);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Queue a read of a save log, answered once every save queued before it is written
+    ///
+    /// Loading never blocks the caller; done runs on the writer thread, so it should only hand the save over.
+    /// @param path Save log to read
+    /// @param done Receives the save
+    void load(const std::string& path, std::function<void(LoadedSave&)> done);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Wait until every save this thread submitted is written and synced to disk
+    void flush();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Write everything still queued, close the logs and stop the thread
+    void stop();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Counters; complete once the writer has stopped
+    SaveWriterStats stats() const;
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        SaveJob job;
+    };
+
+    void push(Node* node);
+    bool pop(SaveJob& job);
+    void run();
+    bool write(const SaveJob& job);
+    void read(const SaveJob& job);
+    SaveLog& logFor(const std::string& path);
+
+    struct OpenLog {
+        std::unique_ptr<SaveLog> log;
+        uint64_t last_used;
+    };
+
+    std::atomic<Node*> head_;       // Newest node; producers exchange it
+    Node* tail_;                    // Oldest node, already consumed; only the writer moves it
+    sem_t ready_;                   // Posted once per push
+    std::atomic<bool> stopping_;
+    std::thread thread_;
+    SaveStore* store_;
+    std::unordered_map<std::string, OpenLog> logs_;
+    uint64_t uses_;
+    std::atomic<uint64_t> submitted_;
+    std::atomic<uint64_t> flushes_;
+    mutable std::mutex stats_mutex_;
+    SaveWriterStats stats_;         // Writer-side counters, under stats_mutex_
+};
+
+#endif // OSIRIS_SAVEWRITER_H
@@ -0,0 +1,182 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Game screens
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "screens.h"
+
+#include <charconv>
+
+#include "game.h"
+
+using std::string;
+
+namespace {
+
+constexpr std::string_view kPadding = "                                ";
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Write a value left-aligned in a column, as `std::left << std::setw(width)` would
+void writeColumn(std::string_view value, size_t width) {
+    renderer.write(value);
+    if (value.size() < width) renderer.write(kPadding.substr(0, width - value.size()));
+}
+
+void writeColumn(int value, size_t width) {
+    char digits[16];
+    char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    writeColumn(std::string_view(digits, static_cast<size_t>(end - digits)), width);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Switch color if the renderer shows color
+void writeColor(std::string_view code) {
+    if (renderer.color()) renderer.write(code);
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+void displayPlayerStatus(const Player& player) {
+    printText(TextId::STATUS_TOP);
+    printText(TextId::STATUS_NAME);
+    writeColumn(player.username, 19);
+    printText(TextId::STATUS_ROW_END);
+    printText(TextId::STATUS_AGE);
+    writeColumn(player.age, 20);
+    printText(TextId::STATUS_ROW_END);
+    printText(TextId::STATUS_STRENGTH);
+    writeColumn(player.strength, 16);
+    printText(TextId::STATUS_ROW_END);
+    printText(TextId::STATUS_INTELLIGENCE);
+    writeColumn(player.intelligence, 12);
+    printText(TextId::STATUS_ROW_END);
+    printText(TextId::STATUS_DEXTERITY);
+    writeColumn(player.dexterity, 15);
+    printText(TextId::STATUS_ROW_END);
+    
+    // Stress display with color coding
+    printText(TextId::STATUS_STRESS);
+    writeColor(player.stress_level > 70 ? RED : player.stress_level > 40 ? YELLOW : GREEN);
+    writeColumn(player.stress_level, 16);
+    printText(TextId::STATUS_METER_END);
+    
+    // Sanity display
+    printText(TextId::STATUS_SANITY);
+    writeColor(player.sanity < 30 ? RED : player.sanity < 60 ? YELLOW : GREEN);
+    writeColumn(player.sanity, 16);
+    printText(TextId::STATUS_METER_END);
+    printText(TextId::STATUS_BOTTOM);
+    
+    // Display relationships
+    if (character_symbols.size() > 0) {
+        printText(TextId::RELATIONSHIPS);
+        for (SymbolId id = 0; id < character_symbols.size(); ++id) {
+            // Statuses run from HOSTILE (-2) to ALLIED (2), like their table entries
+            static_assert(static_cast<int>(TextId::RELATION_ALLIED) - static_cast<int>(TextId::RELATION_HOSTILE) == 4,
+                          "relationship entries out of order");
+            int status = static_cast<int>(player.relationships[id]) - static_cast<int>(RelationshipStatus::HOSTILE);
+            renderer.write(character_symbols.name(id));
+            printText(static_cast<TextId>(static_cast<int>(TextId::RELATION_HOSTILE) + status));
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void osirisBootSequence(const Player& player) {
+    printWithStress(TextId::BOOT_INIT, player);
+    printWithStress(TextId::BOOT_MEMORY, player);
+    printWithStress(TextId::BOOT_QUANTUM, player);
+    
+    if (game_state.isInTimeLoop()) {
+        printWithStress(TextId::BOOT_ANOMALY, player);
+        printWithStress(TextId::BOOT_DEJA_VU, player);
+    }
+    
+    printWithStress(GREEN "[OK]" RESET " User profile loaded: " + player.username, player);
+    
+    if (player.stress_level > 50) {
+        printWithStress(TextId::BOOT_STRESS, player);
+        printWithStress(TextId::BOOT_EVALUATION, player);
+    }
+    
+    renderer.pause(1000);
+    printWithStress(TextId::BANNER_TOP, player);
+    printWithStress(TextId::BANNER_NAME, player);
+    printWithStress(TextId::BANNER_LINE_1, player);
+    printWithStress(TextId::BANNER_LINE_2, player);
+    printWithStress(TextId::BANNER_LINE_3, player);
+    printWithStress(TextId::BANNER_BOTTOM, player);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+void printGameMenu() {
+    printText(TextId::GAME_MENU);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void displaySecrets(const Player& player) {
+    printText(TextId::SECRETS_TOP);
+    
+    if (player.discovered_secrets.none()) {
+        printText(TextId::NO_SECRETS);
+        return;
+    }
+    
+    for (SymbolId id = 0; id < secret_symbols.size(); ++id) {
+        if (!player.discovered_secrets.test(id)) continue;
+        printText(TextId::SECRET_BULLET);
+        renderer.write(secret_symbols.description(id));
+        renderer.write("\n");
+    }
+    renderer.write("\n");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void displayInventory(const Player& player) {
+    printText(TextId::INVENTORY_TOP);
+    
+    if (player.inventory.none()) {
+        printText(TextId::NO_ITEMS);
+        return;
+    }
+    
+    for (SymbolId id = 0; id < item_symbols.size(); ++id) {
+        if (!player.inventory.test(id)) continue;
+        printText(TextId::ITEM_BULLET);
+        renderer.write(item_symbols.description(id));
+        renderer.write("\n");
+    }
+    renderer.write("\n");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void enhancedSystemDiagnostics(const Player& player) {
+    printText(TextId::DIAGNOSTICS_TOP);
+    
+    printWithStress(TextId::DIAGNOSTICS_RUNNING, player);
+    renderer.pause(1000);
+    
+    // CPU Status
+    printWithStress(player.stress_level > 70 ? TextId::CPU_OVERLOAD : TextId::CPU_OPTIMAL, player);
+    
+    // Memory Status  
+    printWithStress(player.sanity < 50 ? TextId::MEMORY_FRAGMENTED : TextId::MEMORY_STABLE, player);
+    
+    // Network Status
+    bool hostile = player.relationships[CHARACTER_OSIRIS] == RelationshipStatus::HOSTILE;
+    printWithStress(hostile ? TextId::NETWORK_HOSTILE : TextId::NETWORK_MONITORED, player);
+    
+    // Temporal Status
+    if (game_state.isInTimeLoop()) {
+        printWithStress("Temporal Status: " RED "[LOOP DETECTED - ITERATION " + 
+                       std::to_string(game_state.getLoopCount()) + "]" RESET, player);
+    } else {
+        printWithStress(TextId::TEMPORAL_LINEAR, player);
+    }
+    
+    // Random OSIRIS commentary
+    if (game_state.rollDice(1, 10) > 7) {
+        printWithStress(TextId::DIAGNOSTICS_OSIRIS, player);
+    }
+}
@@ -0,0 +1,41 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Game screens
+// Status, menu and diagnostics screens shared by the console game and the session server. Screens write to the
+// thread's renderer, almost entirely as entries of the pre-rendered text table.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SCREENS_H
+#define OSIRIS_SCREENS_H
+
+struct Player;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Display player's comprehensive status
+/// @param player Player reference to display
+void displayPlayerStatus(const Player& player);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Enhanced OSIRIS boot sequence with dynamic elements
+/// @param player Player reference for personalized messages
+void osirisBootSequence(const Player& player);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Draw the game menu and the option prompt
+void printGameMenu();
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Display discovered secrets
+/// @param player Player reference for secrets
+void displaySecrets(const Player& player);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Display player inventory
+/// @param player Player reference for inventory
+void displayInventory(const Player& player);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Enhanced system diagnostics with personality
+/// @param player Player reference for personalized diagnostics
+void enhancedSystemDiagnostics(const Player& player);
+
+#endif // OSIRIS_SCREENS_H
@@ -0,0 +1,127 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Session server
+// Hosts the game for many players at once over local sockets (e.g. `nc localhost 7777`).
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "analytics.h"
+#include "input.h"
+#include "savestore.h"
+#include "server.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Server entry point
+/// @param argc Argument count
+/// @param argv Arguments: [--port N] [--unix PATH] [--save-dir DIR] [--max-sessions N] [--instant] [--no-color]
+///             [--hud] [--frame MS] [--seed N] [--threads N] [--story FILE] [--list-saves] [--analytics FILE]
+///             [--show-analytics FILE]
+/// @return Exit code
+int main(int argc, char* argv[]) {
+    ServerOptions options;
+    options.seed = static_cast<uint64_t>(std::time(nullptr));
+    string story_path = "story/osiris.story";
+    bool list_saves = false;
+    string analytics_path;
+    string report_path;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        uint64_t value = 0;
+        bool has_value = i + 1 < argc;
+        if (arg == "--port" && has_value && parseCount(argv[i + 1], value) && value <= 65535) {
+            options.port = static_cast<uint16_t>(value);
+        } else if (arg == "--unix" && has_value) {
+            options.unix_path = argv[i + 1];
+        } else if (arg == "--save-dir" && has_value) {
+            options.save_dir = argv[i + 1];
+        } else if (arg == "--max-sessions" && has_value && parseCount(argv[i + 1], value)) {
+            options.max_sessions = static_cast<size_t>(value);
+        } else if (arg == "--frame" && has_value && parseCount(argv[i + 1], value)) {
+            options.frame_ms = static_cast<int>(value);
+        } else if (arg == "--seed" && has_value && parseCount(argv[i + 1], value)) {
+            options.seed = value;
+        } else if (arg == "--threads" && has_value && parseCount(argv[i + 1], value)) {
+            options.threads = static_cast<unsigned>(value);
+        } else if (arg == "--story" && has_value) {
+            story_path = argv[i + 1];
+        } else if (arg == "--analytics" && has_value) {
+            analytics_path = argv[i + 1];
+        } else if (arg == "--show-analytics" && has_value) {
+            report_path = argv[i + 1];
+        } else if (arg == "--instant") {
+            options.instant = true;
+            continue;
+        } else if (arg == "--no-color") {
+            options.color = false;
+            continue;
+        } else if (arg == "--hud") {
+            options.hud = true;
+            continue;
+        } else if (arg == "--list-saves") {
+            list_saves = true;
+            continue;
+        } else {
+            cerr << "Usage: " << argv[0] << " [--port N] [--unix PATH] [--save-dir DIR] [--max-sessions N]"
+                    " [--instant] [--no-color] [--hud] [--frame MS] [--seed N] [--threads N] [--story FILE]"
+                    " [--list-saves] [--analytics FILE] [--show-analytics FILE]" << endl;
+            return 1;
+        }
+        ++i;
+    }
+
+    string error;
+    if (list_saves) {
+        SaveStore store;
+        if (options.save_dir.empty() || !store.open(options.save_dir, error)) {
+            cerr << "Cannot open saves: " << (error.empty() ? "no save directory" : error) << endl;
+            return 1;
+        }
+        std::vector<SlotInfo> slots;
+        store.list(slots);
+        printSlots(slots, std::cout);
+        return 0;
+    }
+
+    StoryGraph story;
+    if (!story.load(story_path, error)) {
+        cerr << "Cannot load story: " << error << endl;
+        return 1;
+    }
+
+    if (!report_path.empty()) {
+        std::vector<AnalyticsRow> rows;
+        if (!Analytics::read(report_path, story, rows, error)) {
+            cerr << "Cannot read analytics: " << error << endl;
+            return 1;
+        }
+        Analytics::print(rows, story, std::cout);
+        return 0;
+    }
+    if (!analytics_path.empty() && !analytics.start(analytics_path, story, error)) {
+        cerr << "Cannot collect analytics: " << error << endl;
+        return 1;
+    }
+
+    if (options.port != 0) cerr << "Listening on 127.0.0.1:" << options.port << endl;
+    if (!options.unix_path.empty()) cerr << "Listening on " << options.unix_path << endl;
+
+    ServerStats stats;
+    if (!serve(story, options, stats, error)) {
+        cerr << "Cannot start server: " << error << endl;
+        return 1;
+    }
+    stats.print(cerr);
+    if (!analytics_path.empty()) {
+        analytics.stop();
+        analytics.stats().print(cerr);
+    }
+    return 0;
+}
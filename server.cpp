@@ -0,0 +1,736 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Multi-session server
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "server.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <queue>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+#include "game.h"
+#include "save.h"
+#include "savelog.h"
+#include "savestore.h"
+#include "savewriter.h"
+#include "session.h"
+
+using std::endl;
+using std::string;
+
+namespace {
+
+constexpr size_t kInputBytes = 256;             // Longest word a client may type; longer ones are discarded
+constexpr size_t kMaxBacklog = 256 * 1024;      // Unsent output that gets a client disconnected
+constexpr int kMaxEvents = 256;
+constexpr auto kAcceptPause = std::chrono::milliseconds(100);   // Listening pause after running out of descriptors
+
+// Written from the signal handler to wake and stop every worker
+int stop_fd = -1;
+
+void requestStop(int) {
+    uint64_t one = 1;
+    ssize_t ignored = ::write(stop_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One connected player
+struct Session {
+    Session(int fd, uint64_t serial, const StoryGraph& graph, SessionHooks hooks)
+        : fd(fd), serial(serial), renderer(fd), game(graph, std::move(hooks)) {}
+
+    int fd;
+    uint64_t serial;                            // Unique per connection; also the session's random stream
+    uint32_t events = 0;                        // epoll interest currently registered
+    Renderer::Clock::time_point scheduled = Renderer::Clock::time_point::max();
+    GameState state;
+    Renderer renderer;
+    GameSession game;
+    size_t input_size = 0;
+    bool discarding = false;                    // Skipping the rest of an overlong word
+    bool closing = false;                       // Torn down once the current event has been handled
+    bool saved = false;                         // Has submitted a save
+    string claim;                               // Designation reserved for this session's registration
+    string held;                                // Input read while the game waited for a save to be read
+    char input[kInputBytes];
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Makes a session's GameState and Renderer the thread's game_state and renderer while it is being served, so the
+/// game functions and screens work on it unchanged
+class SessionScope {
+public:
+    explicit SessionScope(Session& session) : session_(session) { swapIn(); }
+    ~SessionScope() { swapIn(); }
+    SessionScope(const SessionScope&) = delete;
+    SessionScope& operator=(const SessionScope&) = delete;
+
+private:
+    void swapIn() {
+        std::swap(game_state, session_.state);
+        std::swap(renderer, session_.renderer);
+    }
+
+    Session& session_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A session's next pump, queued by due time
+struct Wakeup {
+    Renderer::Clock::time_point due;
+    int fd;
+    uint64_t serial;
+
+    bool operator>(const Wakeup& other) const { return due > other.due; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// epoll keys carry the connection serial next to the descriptor, so events queued for a closed session are not
+/// delivered to a new session that reused its descriptor in the same batch
+constexpr uint64_t kListenerKey = 1ULL << 63;
+constexpr uint64_t kStopKey = 1ULL << 62;
+constexpr uint64_t kLoadedKey = 1ULL << 61;
+
+uint64_t sessionKey(int fd, uint64_t serial) {
+    return ((serial & 0x1FFFFFFFULL) << 32) | static_cast<uint32_t>(fd);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A save the writer read for a session
+struct LoadedRead {
+    int fd;
+    uint64_t serial;
+    LoadedSave save;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Listening sockets and limits shared by all workers
+class Listener {
+public:
+    Listener(const StoryGraph& graph, const ServerOptions& options)
+        : graph(graph), options(options), session_count(0), peak_sessions(0), next_serial(0) {}
+
+    ~Listener();
+
+    bool start(string& error);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Claim a place for a new session
+    /// @return False if the server is full
+    bool admit();
+
+    void release() { session_count.fetch_sub(1, std::memory_order_relaxed); }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Reserve a designation for a session about to register it. The store learns of a designation only once the
+    /// writer has written its first save, so until then the reservation is what keeps a second session from
+    /// registering it too.
+    /// @param designation Designation typed at registration
+    /// @return False if it is taken: saved, or reserved by another session
+    bool claim(const string& designation);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Drop the reservation of a registration that was abandoned before its first save
+    /// @param designation Designation passed to claim()
+    void unclaim(const string& designation);
+
+    const StoryGraph& graph;
+    const ServerOptions& options;
+    std::vector<int> listen_fds;
+    std::atomic<size_t> session_count;
+    std::atomic<size_t> peak_sessions;
+    std::atomic<uint64_t> next_serial;
+    SaveStore store;                            // Open if options.save_dir is set
+    SaveWriter writer;                          // Writes every session's saves; running if store is open
+
+private:
+    bool listenOn(int fd, const sockaddr* address, socklen_t size, string& error);
+
+    std::mutex claims_mutex_;
+    std::unordered_set<string> claims_;         // Designations registered or being registered, under claims_mutex_
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One event loop thread and the sessions it accepted
+///
+/// A session stays on the worker that accepted it, so sessions need no locking; workers share only the listening
+/// sockets, which wake one worker per connection.
+class Worker {
+public:
+    explicit Worker(Listener& listener)
+        : listener_(listener), graph_(listener.graph), options_(listener.options), epoll_fd_(-1), loaded_fd_(-1),
+          accepting_(false), resume_accepting_(Renderer::Clock::time_point::max()) {}
+
+    ~Worker();
+
+    bool start(string& error);
+    void run();
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Close every session, saving the ones left mid-game
+    void closeAll();
+
+    const ServerStats& stats() const { return stats_; }
+
+private:
+    void setAccepting(bool accepting);
+    void acceptAll(int listen_fd);
+
+    void readInput(Session& session);
+    void feed(Session& session, const char* data, size_t size);
+    SessionHooks hooks(int fd, uint64_t serial);
+    void deliverLoads();
+
+    void settle(Session& session);
+    void updateOutput(Session& session);
+    void setInterest(Session& session, uint32_t events);
+    void pumpDue();
+    int waitTimeout() const;
+    void close(Session& session);
+    void teardown(Session& session);
+
+    Listener& listener_;
+    const StoryGraph& graph_;
+    const ServerOptions& options_;
+    ServerStats stats_;
+    int epoll_fd_;
+    int loaded_fd_;                                     // Signalled by the writer when it has read a save
+    std::mutex loaded_mutex_;
+    std::vector<LoadedRead> loaded_;                    // Saves read for this worker's sessions, under loaded_mutex_
+    std::vector<std::unique_ptr<Session>> sessions_;    // Indexed by descriptor
+    bool accepting_;
+    Renderer::Clock::time_point resume_accepting_;      // When to listen again after running out of descriptors
+    std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup>> wakeups_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+Listener::~Listener() {
+    for (int fd : listen_fds) ::close(fd);
+    if (!options.unix_path.empty() && !listen_fds.empty()) unlink(options.unix_path.c_str());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Listener::listenOn(int fd, const sockaddr* address, socklen_t size, string& error) {
+    if (fd < 0 || bind(fd, address, size) < 0 || listen(fd, SOMAXCONN) < 0) {
+        error = std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    listen_fds.push_back(fd);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Listener::start(string& error) {
+    // Every session is a descriptor; allow as many as the hard limit does
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    if (options.port != 0) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int reuse = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (!listenOn(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address), error)) {
+            error = "cannot listen on 127.0.0.1:" + std::to_string(options.port) + ": " + error;
+            return false;
+        }
+    }
+
+    if (!options.unix_path.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options.unix_path.size() >= sizeof(address.sun_path)) {
+            error = "socket path is too long: " + options.unix_path;
+            return false;
+        }
+        std::memcpy(address.sun_path, options.unix_path.c_str(), options.unix_path.size() + 1);
+        unlink(options.unix_path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (!listenOn(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address), error)) {
+            error = "cannot listen on " + options.unix_path + ": " + error;
+            return false;
+        }
+    }
+
+    if (listen_fds.empty()) {
+        error = "no address to listen on";
+        return false;
+    }
+    if (options.save_dir.empty()) return true;
+    if (!store.open(options.save_dir, error)) return false;
+    writer.start(&store);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Listener::admit() {
+    size_t count = session_count.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (count > options.max_sessions) {
+        session_count.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    size_t peak = peak_sessions.load(std::memory_order_relaxed);
+    while (count > peak && !peak_sessions.compare_exchange_weak(peak, count, std::memory_order_relaxed)) {}
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Listener::claim(const string& designation) {
+    std::lock_guard<std::mutex> lock(claims_mutex_);
+    SlotInfo slot;
+    if (store.find(designation, slot)) return false;
+    return claims_.insert(designation).second;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Listener::unclaim(const string& designation) {
+    std::lock_guard<std::mutex> lock(claims_mutex_);
+    claims_.erase(designation);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+Worker::~Worker() {
+    closeAll();
+    if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    if (loaded_fd_ >= 0) ::close(loaded_fd_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::closeAll() {
+    for (auto& session : sessions_) {
+        if (!session) continue;
+        close(*session);
+        teardown(*session);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Worker::start(string& error) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        error = string("epoll: ") + std::strerror(errno);
+        return false;
+    }
+
+    // The stop event is never read, so it stays readable and wakes every worker
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = kStopKey;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd, &event);
+
+    loaded_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loaded_fd_ < 0) {
+        error = string("eventfd: ") + std::strerror(errno);
+        return false;
+    }
+    event.data.u64 = kLoadedKey;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, loaded_fd_, &event);
+
+    setAccepting(true);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::setAccepting(bool accepting) {
+    if (accepting == accepting_) return;
+    accepting_ = accepting;
+    for (int fd : listener_.listen_fds) {
+        // Exclusive wakeups hand each connection to one waiting worker instead of waking them all
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.u64 = kListenerKey | static_cast<uint32_t>(fd);
+        epoll_ctl(epoll_fd_, accepting ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &event);
+    }
+    resume_accepting_ = accepting ? Renderer::Clock::time_point::max() : Renderer::Clock::now() + kAcceptPause;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::acceptAll(int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // Out of descriptors: stop listening for a while instead of spinning on the backlog
+            if (errno == EMFILE || errno == ENFILE) setAccepting(false);
+            return;
+        }
+
+        if (!listener_.admit()) {
+            static const char kFull[] = "OSIRIS is at capacity. Try again later.\r\n";
+            ssize_t ignored = ::write(fd, kFull, sizeof(kFull) - 1);
+            (void)ignored;
+            ::close(fd);
+            ++stats_.rejected;
+            continue;
+        }
+
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));    // Fails harmlessly on Unix sockets
+
+        if (static_cast<size_t>(fd) >= sessions_.size()) sessions_.resize(static_cast<size_t>(fd) + 1);
+        uint64_t serial = listener_.next_serial.fetch_add(1, std::memory_order_relaxed);
+        sessions_[fd].reset(new Session(fd, serial, graph_, hooks(fd, serial)));
+        Session& session = *sessions_[fd];
+        session.state.reset(options_.seed, session.serial);
+        session.renderer.setInstant(options_.instant);
+        session.renderer.setColor(options_.color);
+        session.renderer.setFrameInterval(options_.frame_ms);
+        if (options_.hud) session.game.enableHud();
+
+        ++stats_.accepted;
+        setInterest(session, EPOLLIN | EPOLLRDHUP);
+
+        // New arrivals see the console game's boot sequence and registration
+        {
+            SessionScope scope(session);
+            session.game.start(Player());
+        }
+        settle(session);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::readInput(Session& session) {
+    char buffer[4096];
+    ssize_t n;
+    do {
+        n = ::read(session.fd, buffer, sizeof(buffer));
+    } while (n < 0 && errno == EINTR);
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close(session);
+        return;
+    }
+    if (n < 0 || session.closing) return;
+
+    // Typed input skips the rest of the animation, as it does at the console
+    session.renderer.flush();
+
+    SessionScope scope(session);
+    feed(session, buffer, static_cast<size_t>(n));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::feed(Session& session, const char* data, size_t size) {
+    size_t i = 0;
+    while (i < size && !session.game.finished() && !session.game.waiting()) {
+        char c = data[i++];
+        bool space = c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        if (!space) {
+            if (session.input_size + 1 < kInputBytes && !session.discarding) {
+                session.input[session.input_size++] = c;
+            } else {
+                session.input_size = 0;
+                session.discarding = true;
+            }
+            continue;
+        }
+        if (session.discarding) {
+            session.discarding = false;
+            continue;
+        }
+        if (session.input_size == 0) continue;
+
+        session.input[session.input_size] = '\0';
+        session.input_size = 0;
+        ++stats_.inputs;
+        session.game.resume(session.input);
+        if (renderer.backlog() > kMaxBacklog) break;
+    }
+    // Words typed ahead of a save being read are kept for when it arrives
+    if (session.game.waiting()) session.held.assign(data + i, size - i);
+    if (session.game.finished()) close(session);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SessionHooks Worker::hooks(int fd, uint64_t serial) {
+    if (options_.save_dir.empty()) return SessionHooks{};
+
+    // Saves are queued for the writer thread. Explicit saves are not waited for either: that would stall every
+    // session on this worker; the writer is drained when the server stops.
+    return SessionHooks{
+        [this, fd](const Player& player) {
+            sessions_[fd]->saved = true;
+            SlotPhase phase = graph_.isFinalScene(player.current_scene) ? SlotPhase::COMPLETE : SlotPhase::PLAYING;
+            listener_.writer.submit(listener_.store.slotPath(player.username), player.username, player, phase);
+        },
+        [this, fd, serial](const string& designation, Player&) {
+            if (listener_.claim(designation)) {
+                sessions_[fd]->claim = designation;
+                return SessionHooks::Lookup::FREE;
+            }
+            // The writer reads the save after any of its saves still queued, so a player who reconnects right
+            // after saving resumes that save, and hands it back to this worker. A taken designation stays taken
+            // even if it has no readable save, e.g. while another session is still registering it: the player
+            // gets no credential, so no code unlocks it and registering over it is impossible.
+            listener_.writer.load(listener_.store.slotPath(designation), [this, fd, serial](LoadedSave& save) {
+                {
+                    std::lock_guard<std::mutex> lock(loaded_mutex_);
+                    loaded_.push_back({fd, serial, std::move(save)});
+                }
+                uint64_t one = 1;
+                ssize_t ignored = ::write(loaded_fd_, &one, sizeof(one));
+                (void)ignored;
+            });
+            return SessionHooks::Lookup::PENDING;
+        },
+        nullptr};
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::deliverLoads() {
+    uint64_t count;
+    ssize_t ignored = ::read(loaded_fd_, &count, sizeof(count));
+    (void)ignored;
+
+    std::vector<LoadedRead> ready;
+    {
+        std::lock_guard<std::mutex> lock(loaded_mutex_);
+        ready.swap(loaded_);
+    }
+    for (LoadedRead& read : ready) {
+        Session* session = static_cast<size_t>(read.fd) < sessions_.size() ? sessions_[read.fd].get() : nullptr;
+        if (session == nullptr || session->serial != read.serial || session->closing) continue;
+        {
+            SessionScope scope(*session);
+            game_state.restoreTimeLoop(read.save.loop_active, read.save.loop_count);
+            session->game.resolve(read.save.player);
+            string held;
+            held.swap(session->held);
+            feed(*session, held.data(), held.size());
+        }
+        settle(*session);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::setInterest(Session& session, uint32_t events) {
+    if (session.events == events) return;
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = sessionKey(session.fd, session.serial);
+    epoll_ctl(epoll_fd_, session.events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, session.fd, &event);
+    session.events = events;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::settle(Session& session) {
+    if (!session.closing) updateOutput(session);
+    if (session.closing) teardown(session);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::updateOutput(Session& session) {
+    Renderer& output = session.renderer;
+    if (options_.instant) {
+        output.flush();
+    } else {
+        output.pump();
+    }
+
+    if (output.backlog() > kMaxBacklog) {
+        ++stats_.dropped;
+        close(session);
+        return;
+    }
+
+    // A full socket stops input until the client catches up, so output cannot grow without bound
+    if (output.blocked()) {
+        setInterest(session, EPOLLOUT | EPOLLRDHUP);
+        return;
+    }
+    // No input is read while the game waits for a save to be read
+    setInterest(session, session.game.waiting() ? EPOLLRDHUP : EPOLLIN | EPOLLRDHUP);
+    if (!output.busy()) {
+        output.release();
+        return;
+    }
+
+    Renderer::Clock::time_point wake = output.wakeTime();
+    if (wake < session.scheduled) {
+        session.scheduled = wake;
+        wakeups_.push({wake, session.fd, session.serial});
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::pumpDue() {
+    Renderer::Clock::time_point now = Renderer::Clock::now();
+    while (!wakeups_.empty() && wakeups_.top().due <= now) {
+        Wakeup wakeup = wakeups_.top();
+        wakeups_.pop();
+        Session* session = static_cast<size_t>(wakeup.fd) < sessions_.size() ? sessions_[wakeup.fd].get() : nullptr;
+        if (session == nullptr || session->serial != wakeup.serial || session->scheduled != wakeup.due) continue;
+        session->scheduled = Renderer::Clock::time_point::max();
+        settle(*session);
+    }
+    if (!accepting_ && resume_accepting_ <= now) setAccepting(true);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+int Worker::waitTimeout() const {
+    Renderer::Clock::time_point due = resume_accepting_;
+    if (!wakeups_.empty()) due = std::min(due, wakeups_.top().due);
+    if (due == Renderer::Clock::time_point::max()) return -1;
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - Renderer::Clock::now()).count();
+    return static_cast<int>(std::max<long long>(0, wait + 1));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::close(Session& session) {
+    session.closing = true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::teardown(Session& session) {
+    // A game left mid-way is saved at its last consistent point
+    if (!session.game.finished()) {
+        SessionScope scope(session);
+        session.game.persist();
+    }
+    if (!session.claim.empty() && !session.saved) listener_.unclaim(session.claim);
+    stats_.arena.merge(session.game.arenaStats());
+    stats_.hud.merge(session.game.hudStats());
+    session.renderer.flush();
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session.fd, nullptr);
+    ::close(session.fd);
+    listener_.release();
+    setAccepting(true);
+    sessions_[session.fd].reset();     // Destroys the session
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Worker::run() {
+    epoll_event events[kMaxEvents];
+    bool stopping = false;
+
+    while (!stopping) {
+        int count = epoll_wait(epoll_fd_, events, kMaxEvents, waitTimeout());
+        if (count < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < count; ++i) {
+            uint64_t key = events[i].data.u64;
+            int fd = static_cast<int>(static_cast<uint32_t>(key));
+            if (key == kStopKey) {
+                stopping = true;
+                continue;
+            }
+            if (key == kLoadedKey) {
+                deliverLoads();
+                continue;
+            }
+            if (key & kListenerKey) {
+                if (accepting_) acceptAll(fd);
+                continue;
+            }
+            Session* session = static_cast<size_t>(fd) < sessions_.size() ? sessions_[fd].get() : nullptr;
+            if (session == nullptr || sessionKey(fd, session->serial) != key) continue;
+
+            uint32_t flags = events[i].events;
+            if (flags & EPOLLIN) readInput(*session);
+            if ((flags & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) && !(flags & EPOLLIN)) close(*session);
+            settle(*session);
+        }
+        pumpDue();
+    }
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+void ServerStats::merge(const ServerStats& other) {
+    accepted += other.accepted;
+    rejected += other.rejected;
+    dropped += other.dropped;
+    inputs += other.inputs;
+    peak_sessions = std::max(peak_sessions, other.peak_sessions);
+    arena.merge(other.arena);
+    hud.merge(other.hud);
+    saves.merge(other.saves);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void ServerStats::print(std::ostream& out) const {
+    out << "Sessions accepted: " << accepted << ", rejected: " << rejected << ", dropped: " << dropped
+        << ", peak concurrent: " << peak_sessions << ", inputs handled: " << inputs << endl;
+    arena.print(out);
+    if (hud.updates > 0) hud.print(out);
+    if (saves.submitted + saves.logs.replayed > 0) saves.print(out);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool serve(const StoryGraph& graph, const ServerOptions& options, ServerStats& stats, string& error) {
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        error = string("eventfd: ") + std::strerror(errno);
+        return false;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    struct sigaction action{};
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    bool started = false;
+    {
+        Listener listener(graph, options);
+        unsigned thread_count = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+        std::vector<std::unique_ptr<Worker>> workers;
+        if (listener.start(error)) {
+            started = true;
+            for (unsigned i = 0; i < std::max(1u, thread_count) && started; ++i) {
+                workers.emplace_back(new Worker(listener));
+                started = workers.back()->start(error);
+            }
+        }
+
+        if (started) {
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < workers.size(); ++i) threads.emplace_back(&Worker::run, workers[i].get());
+            workers[0]->run();
+            for (std::thread& thread : threads) thread.join();
+        }
+
+        // The writer may still answer reads for the workers, so it stops before they are destroyed
+        for (auto& worker : workers) worker->closeAll();
+        listener.writer.stop();
+        for (auto& worker : workers) stats.merge(worker->stats());
+        workers.clear();
+        stats.saves.merge(listener.writer.stats());
+        stats.peak_sessions = listener.peak_sessions.load();
+    }
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    ::close(stop_fd);
+    stop_fd = -1;
+    return started;
+}
@@ -0,0 +1,73 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Multi-session server
+// Hosts many concurrent players in one process over TCP on localhost and/or a Unix domain socket. Every session has
+// its own GameState, renderer and resumable GameSession; a few epoll worker threads drive them all, so idle sessions
+// and sessions in the middle of a typewriter animation cost no thread.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SERVER_H
+#define OSIRIS_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "arena.h"
+#include "hud.h"
+#include "renderer.h"
+#include "savewriter.h"
+#include "story.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Server parameters
+struct ServerOptions {
+    uint16_t port = 7777;                       // TCP port on 127.0.0.1, 0 for none
+    std::string unix_path;                      // Unix domain socket path, empty for none
+    std::string save_dir = "saves";             // Save store with a slot per designation, empty to disable saving
+    size_t max_sessions = 50000;                // Connections beyond this are turned away
+    bool instant = false;                       // No typewriter pacing
+    bool color = true;                          // Send ANSI escape sequences
+    bool hud = false;                           // Pin a status panel to the top of every session's terminal
+    int frame_ms = Renderer::kDefaultFrameMs;   // Minimum time between two writes to a session
+    uint64_t seed = 1;                          // Session n rolls dice on stream n of this seed
+    unsigned threads = 0;                       // Worker threads, 0 for one per hardware thread
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counters reported when the server stops
+struct ServerStats {
+    uint64_t accepted = 0;          // Connections that got a session
+    uint64_t rejected = 0;          // Connections turned away because the server was full
+    uint64_t dropped = 0;           // Sessions closed because the client stopped reading
+    uint64_t inputs = 0;            // Words of input handled
+    size_t peak_sessions = 0;
+    ArenaStats arena;               // Scene arenas of all closed sessions
+    PanelStats hud;                 // Status panels of all closed sessions
+    SaveWriterStats saves;          // Saves of all sessions and the logs they went to
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Add another worker's counters
+    /// @param other Counters to add
+    void merge(const ServerStats& other);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print the counters
+    /// @param out Destination stream
+    void print(std::ostream& out) const;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Serve sessions until SIGINT or SIGTERM; sessions past registration are saved on the way out
+///
+/// Each worker thread accepts connections into its own event loop and keeps them; session output goes through the
+/// thread's game_out. Memory per session is bounded: input is read into a fixed buffer and a client that lets more
+/// than a fixed amount of output pile up is disconnected.
+/// @param graph Loaded story
+/// @param options Listening addresses and session settings
+/// @param stats Receives the counters
+/// @param error Receives a description of the problem if the server cannot start
+/// @return False if no listening socket could be set up
+bool serve(const StoryGraph& graph, const ServerOptions& options, ServerStats& stats, std::string& error);
+
+#endif // OSIRIS_SERVER_H
@@ -0,0 +1,358 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Resumable game session
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "session.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "analytics.h"
+#include "input.h"
+#include "screens.h"
+#include "trace.h"
+
+using std::endl;
+using std::string;
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Read a typed number; anything that is not a whole number counts as 0
+int parseNumber(const char* word) {
+    int value = 0;
+    if (!parseInteger(word, value)) return 0;
+    return std::max(-1000000, std::min(1000000, value));
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+GameSession::GameSession(const StoryGraph& graph, SessionHooks hooks)
+    : graph_(graph), hooks_(std::move(hooks)), runner_(graph), checkpoint_loop_active_(false),
+      checkpoint_loop_count_(0), phase_(Phase::DESIGNATION), remaining_points_(kAttributePoints),
+      invalid_inputs_(0), scene_started_(0), prompted_(0) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool GameSession::validDesignation(const char* word) {
+    size_t length = std::strlen(word);
+    if (length == 0 || length > kMaxDesignation) return false;
+    for (size_t i = 0; i < length; ++i) {
+        char c = word[i];
+        bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        if (!plain) return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::start(const Player& player) {
+    player_ = player;
+    if (hud_) hud_->attach();
+    if (!player_.username.empty()) {
+        printWithStress(TextId::SAVE_DETECTED, player_);
+        osirisBootSequence(player_);
+        showMenu();
+    } else {
+        osirisBootSequence(player_);
+        printWithStress(TextId::REGISTRATION, player_);
+        printWithStress(TextId::ENTER_DESIGNATION, player_);
+        printText(TextId::PROMPT);
+        phase_ = Phase::DESIGNATION;
+    }
+    refreshHud();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::resume(const char* word) {
+    OSIRIS_TRACE_SCOPE("session.step");
+    int rejected = invalid_inputs_;
+    step(word);
+    if (invalid_inputs_ == rejected) invalid_inputs_ = 0;
+    refreshHud();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::reject() {
+    // A client that sends nothing but junk is not prompted forever
+    if (++invalid_inputs_ < kMaxInvalidInputs) return;
+    printWithStress(TextId::TOO_MANY_INVALID, player_);
+    persist();
+    phase_ = Phase::OVER;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::refreshHud() {
+    if (!hud_) return;
+    if (finished()) {
+        hud_->detach();
+    } else {
+        hud_->refresh(player_, graph_.scenes().size());
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::step(const char* word) {
+    switch (phase_) {
+        case Phase::DESIGNATION:
+            if (!validDesignation(word)) {
+                printWithStress(TextId::BAD_DESIGNATION, player_);
+                printWithStress(TextId::ENTER_DESIGNATION, player_);
+                printText(TextId::PROMPT);
+                reject();
+                return;
+            }
+            if (hooks_.resume) {
+                claimed_ = Player();
+                SessionHooks::Lookup lookup = hooks_.resume(word, claimed_);
+                if (lookup == SessionHooks::Lookup::PENDING) {
+                    phase_ = Phase::LOOKUP;
+                    return;
+                }
+                if (lookup == SessionHooks::Lookup::TAKEN) {
+                    verify();
+                    return;
+                }
+            }
+            player_.username = word;
+            phase_ = Phase::PASSWORD;
+            printWithStress(TextId::ENTER_CODE, player_);
+            printText(TextId::PROMPT);
+            return;
+
+        case Phase::LOOKUP:
+            return;
+
+        case Phase::VERIFY:
+            if (!claimed_.credential.matches(word)) {
+                // Back to a fresh registration; the save and the time loop it loaded are dropped
+                claimed_ = Player();
+                game_state.restoreTimeLoop(false, 0);
+                printWithStress(TextId::CODE_REJECTED, player_);
+                printWithStress(TextId::ENTER_DESIGNATION, player_);
+                printText(TextId::PROMPT);
+                phase_ = Phase::DESIGNATION;
+                reject();
+                return;
+            }
+            player_ = claimed_;
+            claimed_ = Player();
+            printWithStress(TextId::SAVE_DETECTED, player_);
+            osirisBootSequence(player_);
+            showMenu();
+            return;
+
+        case Phase::PASSWORD:
+            player_.credential = Credential::make(word);
+            phase_ = Phase::AGE;
+            printWithStress(TextId::ENTER_AGE, player_);
+            printText(TextId::PROMPT);
+            return;
+
+        case Phase::AGE:
+            player_.age = parseNumber(word);
+            printWithStress(TextId::DISTRIBUTE_POINTS, player_);
+            phase_ = Phase::STRENGTH;
+            promptAttribute();
+            return;
+
+        case Phase::STRENGTH:
+        case Phase::INTELLIGENCE:
+        case Phase::DEXTERITY: {
+            // A value is taken only if it is a whole number no larger than the points left; a negative one would
+            // hand points back. The prompts cycle until all points are spent.
+            int& attribute = phase_ == Phase::STRENGTH ? player_.strength
+                           : phase_ == Phase::INTELLIGENCE ? player_.intelligence : player_.dexterity;
+            int value = 0;
+            if (parseInteger(word, value) && value >= 0 && value <= remaining_points_) {
+                remaining_points_ -= value;
+                attribute = value;
+            } else {
+                reject();
+            }
+            if (finished()) return;
+            if (remaining_points_ <= 0) {
+                finishRegistration();
+                return;
+            }
+            phase_ = phase_ == Phase::STRENGTH ? Phase::INTELLIGENCE
+                   : phase_ == Phase::INTELLIGENCE ? Phase::DEXTERITY : Phase::STRENGTH;
+            promptAttribute();
+            return;
+        }
+
+        case Phase::MENU:
+            menuChoice(parseNumber(word));
+            return;
+
+        case Phase::DECISION: {
+            int choice = parseNumber(word);
+            int count = static_cast<int>(runner_.choices().size());
+            bool listed = choice >= 1 && choice <= count;
+            if (!listed || !runner_.choices()[choice - 1].available(player_)) {
+                printWithStress(listed ? TextId::LOCKED_CHOICE : TextId::INVALID_CHOICE, player_);
+                modifyStress(player_, 2);
+                printText(TextId::CHOOSE);
+                game_out << count;
+                printText(TextId::CHOOSE_END);
+                reject();
+                return;
+            }
+            OSIRIS_TRACE_END("session.think", prompted_, choice);
+            analytics.record(checkpoint_.current_scene, runner_.currentNode(), choice, AnalyticsOutcome::CHOICE);
+            runner_.choose(choice);
+            continueScene();
+            return;
+        }
+
+        case Phase::OVER:
+            return;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::resolve(const Player& save) {
+    if (phase_ != Phase::LOOKUP) return;
+    claimed_ = save;
+    verify();
+    refreshHud();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::verify() {
+    phase_ = Phase::VERIFY;
+    printWithStress(TextId::ENTER_CODE, player_);
+    printText(TextId::PROMPT);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::persist() {
+    if (phase_ == Phase::MENU) {
+        save(player_);
+    } else if (phase_ == Phase::DECISION) {
+        bool loop_active = game_state.isInTimeLoop();
+        int loop_count = game_state.getLoopCount();
+        game_state.restoreTimeLoop(checkpoint_loop_active_, checkpoint_loop_count_);
+        save(checkpoint_);
+        game_state.restoreTimeLoop(loop_active, loop_count);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::promptAttribute() {
+    switch (phase_) {
+        case Phase::STRENGTH:
+            game_out << "Remaining points: " << remaining_points_ << endl;
+            game_out << "Strength (current: " << player_.strength << "): " << std::flush;
+            break;
+        case Phase::INTELLIGENCE:
+            game_out << "Intelligence (current: " << player_.intelligence << "): " << std::flush;
+            break;
+        default:
+            game_out << "Dexterity (current: " << player_.dexterity << "): " << std::flush;
+            break;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::finishRegistration() {
+    printWithStress("\n" GREEN "Welcome to the OSIRIS facility, Dr. " + player_.username + "." RESET, player_);
+    printWithStress(TextId::RESEARCH_BEGINS, player_);
+    player_.current_scene = 0;
+    save(player_);
+    showMenu();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::showMenu() {
+    phase_ = Phase::MENU;
+    printGameMenu();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::menuChoice(int choice) {
+    switch (choice) {
+        case 1: // Continue Story
+            if (graph_.isFinalScene(player_.current_scene)) {
+                printWithStress(TextId::STORY_COMPLETE, player_);
+                printWithStress(TextId::NEW_GAME_HINT, player_);
+            } else if (runner_.begin(player_)) {
+                OSIRIS_TRACE_BEGIN(scene_started_);
+                checkpoint_ = player_;
+                checkpoint_loop_active_ = game_state.isInTimeLoop();
+                checkpoint_loop_count_ = game_state.getLoopCount();
+                continueScene();
+                return;
+            }
+            break;
+        case 2: // Player Status
+            displayPlayerStatus(player_);
+            break;
+        case 3: // Discovered Secrets
+            displaySecrets(player_);
+            break;
+        case 4: // Inventory
+            displayInventory(player_);
+            break;
+        case 5: // Relationship Status
+            displayPlayerStatus(player_); // Includes relationships
+            break;
+        case 6: // System Diagnostics
+            enhancedSystemDiagnostics(player_);
+            break;
+        case 7: // Save Game
+            save(player_);
+            if (hooks_.flush) hooks_.flush();
+            printWithStress(TextId::GAME_SAVED, player_);
+            break;
+        case 8: // Exit Game
+            save(player_);
+            if (hooks_.flush) hooks_.flush();
+            printWithStress("Goodbye, Dr. " + player_.username + "...", player_);
+            printWithStress(TextId::OSIRIS_FAREWELL, player_);
+            phase_ = Phase::OVER;
+            return;
+        default:
+            printWithStress(TextId::INVALID_SELECTION, player_);
+            modifyStress(player_, 1);
+            reject();
+            if (finished()) return;
+            break;
+    }
+    endTurn();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::continueScene() {
+    if (runner_.advance(player_) == StoryStop::DECISION) {
+        phase_ = Phase::DECISION;
+        printDecisionPoint(runner_.choices(), player_);
+        printText(TextId::CHOOSE);
+        game_out << runner_.choices().size();
+        printText(TextId::CHOOSE_END);
+        OSIRIS_TRACE_BEGIN(prompted_);
+        return;
+    }
+    OSIRIS_TRACE_END("session.scene", scene_started_, checkpoint_.current_scene);
+    if (runner_.ending() >= 0) {
+        analytics.record(checkpoint_.current_scene, runner_.currentNode(), runner_.ending(), AnalyticsOutcome::ENDING);
+    }
+    save(player_);
+    endTurn();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::endTurn() {
+    // A sanity break ends the game without saving over the last checkpoint
+    if (!endOfTurn(player_, !graph_.isFinalScene(player_.current_scene))) {
+        analytics.record(player_.current_scene, runner_.currentNode(), 0, AnalyticsOutcome::SANITY_BREAK);
+        phase_ = Phase::OVER;
+        return;
+    }
+    showMenu();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void GameSession::save(const Player& player) {
+    if (hooks_.save) hooks_.save(player);
+}
@@ -0,0 +1,144 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Resumable game session
+// The whole game (registration, menu, story scenes and decisions) as a state machine that suspends whenever it
+// needs a word of input and is resumed with that word. Nothing in it blocks: output goes to the thread's renderer,
+// whose timed queue is the other suspension point, pumped by whoever hosts the session. The console game feeds it
+// from cin; the server feeds thousands of them from sockets.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SESSION_H
+#define OSIRIS_SESSION_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "game.h"
+#include "hud.h"
+#include "story.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Host callbacks of a session
+struct SessionHooks {
+    /// Whether a designation typed at registration can be registered
+    enum class Lookup : uint8_t {
+        FREE,                   // Register it
+        TAKEN,                  // Resume the save loaded into player (and game_state)
+        PENDING                 // Taken, and its save is still being read; the host calls GameSession::resolve()
+    };
+
+    /// Persist a player; game_state holds the matching time loop state. Empty to never save.
+    std::function<void(const Player& player)> save;
+
+    /// Look up a save for the designation typed at registration. A designation is taken even if its save cannot be
+    /// read: the session asks for the save's clearance code and resumes it only if the code matches, so a save
+    /// without a readable credential can never be taken over. Empty to always register.
+    std::function<Lookup(const std::string& designation, Player& player)> resume;
+
+    /// Wait until every save so far is on disk; called when the player saves explicitly and when they quit. Empty
+    /// if saves are written before save returns.
+    std::function<void()> flush;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One player's game, advanced one word of input at a time
+///
+/// Every call runs on the thread's game_state and renderer, so a host serving several sessions on one thread
+/// swaps each session's state in while resuming it.
+class GameSession {
+public:
+    /// Where the session is suspended; each phase but OVER waits for one word of input
+    enum class Phase : uint8_t {
+        DESIGNATION,
+        LOOKUP,                 // Waiting for the host to read a taken designation's save; takes no input
+        VERIFY,                 // Clearance code of a save being resumed
+        PASSWORD,
+        AGE,
+        STRENGTH,
+        INTELLIGENCE,
+        DEXTERITY,
+        MENU,
+        DECISION,
+        OVER
+    };
+
+    static constexpr int kAttributePoints = 30;
+    static constexpr size_t kMaxDesignation = 32;
+    static constexpr int kMaxInvalidInputs = 16;    // Rejected inputs in a row that end the session
+
+    GameSession(const StoryGraph& graph, SessionHooks hooks);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Designations name save slots, so only plain names of letters, digits, '_' and '-' are accepted
+    /// @param word Candidate designation
+    /// @return True if word can be used as a designation
+    static bool validDesignation(const char* word);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Show a status panel at the top of the terminal, kept current after every input; call before start()
+    void enableHud() { hud_.reset(new StatusPanel()); }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Show the opening screens and suspend for the first input
+    /// @param player A loaded save to resume, or a default Player to register a new one
+    void start(const Player& player);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Resume with one word of input and run until the session needs the next one
+    /// @param word Input word without whitespace
+    void resume(const char* word);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Continue after the resume hook answered PENDING
+    /// @param save The designation's save, or a default Player if it could not be read; game_state holds its time
+    ///     loop
+    void resolve(const Player& save);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Save the last consistent state, e.g. when the player disconnects
+    ///
+    /// At a decision the player is part-way through a scene whose effects have already been applied, so the
+    /// scene's starting checkpoint is saved instead; resuming the save replays the scene exactly once. Does
+    /// nothing before registration is complete or after the game is over.
+    void persist();
+
+    bool finished() const { return phase_ == Phase::OVER; }
+    bool waiting() const { return phase_ == Phase::LOOKUP; }
+    Phase phase() const { return phase_; }
+    const Player& player() const { return player_; }
+    const ArenaStats& arenaStats() const { return runner_.arenaStats(); }
+
+    /// Status panel counters; all zero without a panel
+    PanelStats hudStats() const { return hud_ ? hud_->stats() : PanelStats(); }
+
+private:
+    void step(const char* word);
+    void reject();
+    void verify();
+    void refreshHud();
+    void promptAttribute();
+    void finishRegistration();
+    void showMenu();
+    void menuChoice(int choice);
+    void continueScene();
+    void endTurn();
+    void save(const Player& player);
+
+    const StoryGraph& graph_;
+    SessionHooks hooks_;
+    StoryRunner runner_;
+    Player player_;
+    Player claimed_;                // Save being resumed, until its clearance code is given
+    Player checkpoint_;             // Player at the start of the scene being played
+    bool checkpoint_loop_active_;
+    int checkpoint_loop_count_;
+    Phase phase_;
+    int remaining_points_;
+    int invalid_inputs_;            // Inputs rejected since the last one accepted
+    uint64_t scene_started_;        // Trace clock at the start of the scene, in trace builds
+    uint64_t prompted_;             // Trace clock when the last decision was offered, in trace builds
+    std::unique_ptr<StatusPanel> hud_;      // Only sessions that show a panel pay for its frame
+};
+
+#endif // OSIRIS_SESSION_H
@@ -0,0 +1,57 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Balancing simulator
+// Runs randomized playthroughs of a story and prints which endings they reach.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <ctime>
+#include <iostream>
+#include <string>
+
+#include "input.h"
+#include "simulator.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Simulator entry point
+/// @param argc Argument count
+/// @param argv Arguments: [--runs N] [--threads N] [--seed N] [--story FILE]
+/// @return Exit code
+int main(int argc, char* argv[]) {
+    SimulationOptions options;
+    options.seed = static_cast<uint64_t>(std::time(nullptr));
+    string story_path = "story/osiris.story";
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        uint64_t value = 0;
+        bool has_value = i + 1 < argc;
+        if (arg == "--runs" && has_value && parseCount(argv[i + 1], value)) {
+            options.runs = value;
+        } else if (arg == "--threads" && has_value && parseCount(argv[i + 1], value)) {
+            options.threads = static_cast<unsigned>(value);
+        } else if (arg == "--seed" && has_value && parseCount(argv[i + 1], value)) {
+            options.seed = value;
+        } else if (arg == "--story" && has_value) {
+            story_path = argv[i + 1];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--runs N] [--threads N] [--seed N] [--story FILE]" << endl;
+            return 1;
+        }
+        ++i;
+    }
+
+    StoryGraph story;
+    string error;
+    if (!story.load(story_path, error)) {
+        std::cerr << "Cannot load story: " << error << endl;
+        return 1;
+    }
+
+    cout << "Seed " << options.seed << endl;
+    SimulationReport report = simulate(story, options);
+    report.print(cout, story);
+    return 0;
+}
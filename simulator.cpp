@@ -0,0 +1,279 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Monte Carlo outcome simulator
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "simulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "playerbatch.h"
+
+namespace {
+
+// Runs claimed by a worker at a time; large enough to keep the shared counter cold, small enough to balance
+constexpr uint64_t kRunsPerClaim = 256;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Every way to split the attribute points between strength, intelligence and dexterity
+struct Allocation {
+    int strength;
+    int intelligence;
+    int dexterity;
+};
+
+std::vector<Allocation> allAllocations() {
+    std::vector<Allocation> allocations;
+    const int points = SimulationReport::kAttributePoints;
+    for (int strength = 0; strength <= points; ++strength) {
+        for (int intelligence = 0; intelligence <= points - strength; ++intelligence) {
+            allocations.push_back({strength, intelligence, points - strength - intelligence});
+        }
+    }
+    return allocations;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void recordCheckpoint(SimulationReport& report, const Player& player) {
+    size_t scene = static_cast<size_t>(player.current_scene);
+    if (scene >= report.scene_visits.size()) return;
+    report.scene_visits[scene]++;
+    report.scene_stress[scene] += player.stress_level;
+    report.scene_sanity[scene] += player.sanity;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Pick uniformly among the choices the player may take, as a player choosing at random would
+/// @return Choice number (1-based), or 0 if every choice is locked
+int pickChoice(const ChoiceList& choices, const PlayerState& player, CounterRng& decisions) {
+    int available[StoryRunner::kMaxChoices];
+    int count = 0;
+    for (size_t i = 0; i < choices.size(); ++i) {
+        if (choices[i].available(player)) available[count++] = static_cast<int>(i) + 1;
+    }
+    return count == 0 ? 0 : available[uniformInt(decisions, 0, count - 1)];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Play one game the way main does when the player always picks "Continue Story"
+///
+/// Run n uses two streams of the base seed: 2n for the game's dice and 2n + 1 for the player's decisions.
+void playOnce(const StoryGraph& graph, StoryRunner& runner, const std::vector<Allocation>& allocations,
+              uint64_t seed, uint64_t run, SimulationReport& report, PlayerBatch& finals) {
+    game_state.reset(seed, run * 2);
+    CounterRng decisions(seed, run * 2 + 1);
+
+    const Allocation& allocation = allocations[uniformInt(decisions, 0, static_cast<int>(allocations.size()) - 1)];
+    Player player;
+    player.username = "Simulant";
+    player.age = 30;
+    player.strength = allocation.strength;
+    player.intelligence = allocation.intelligence;
+    player.dexterity = allocation.dexterity;
+    recordCheckpoint(report, player);
+
+    int outcome = report.noEndingOutcome();
+    bool stuck = false;
+    while (runner.begin(player)) {
+        while (runner.advance(player) == StoryStop::DECISION) {
+            // A decision without an available choice would prompt forever; count the run as ending nowhere
+            int choice = pickChoice(runner.choices(), player, decisions);
+            stuck = choice == 0;
+            if (stuck) break;
+            runner.choose(choice);
+        }
+        if (stuck) break;
+        bool sane = endOfTurn(player, !graph.isFinalScene(player.current_scene));
+        recordCheckpoint(report, player);
+
+        if (runner.ending() >= 0) {
+            outcome = runner.ending();
+            break;
+        }
+        if (!sane) {
+            outcome = report.sanityBreakOutcome();
+            break;
+        }
+    }
+
+    int slot = SimulationReport::allocationSlot(allocation.strength, allocation.intelligence);
+    report.runs++;
+    report.outcomes[outcome]++;
+    report.allocation_runs[slot]++;
+    report.allocation_outcomes[static_cast<size_t>(outcome) * SimulationReport::kAllocationSlots + slot]++;
+    finals.add(player);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Count the final states of a block of runs passing each condition of the story, a column at a time
+void checkFinals(const StoryGraph& graph, PlayerBatch& finals, SimulationReport& report) {
+    std::vector<uint8_t> passed;
+    for (size_t i = 0; i < graph.conditions().size(); ++i) {
+        report.condition_passes[i] += finals.check(graph.condition(static_cast<uint32_t>(i)), passed);
+    }
+    finals.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A stat condition as written in the story, e.g. "strength+dexterity >= 15"
+std::string describeStat(const StoryGraph::Condition& condition) {
+    static const char* const kCompares[] = {"<", "<=", ">", ">=", "==", "!="};
+    std::string text = statName(condition.stat);
+    if (condition.stat_extra != StoryStat::NONE) text += std::string("+") + statName(condition.stat_extra);
+    return text + " " + kCompares[condition.compare] + " " + std::to_string(condition.value);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+double percent(uint64_t part, uint64_t whole) {
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+SimulationReport::SimulationReport(const StoryGraph& graph)
+    : runs(0), seconds(0.0), threads(0) {
+    for (const std::string& ending : graph.endings()) outcome_names.push_back(ending.c_str());
+    outcome_names.push_back("NO ENDING");
+    outcome_names.push_back("SANITY BREAK");
+
+    outcomes.assign(outcome_names.size(), 0);
+    allocation_runs.assign(kAllocationSlots, 0);
+    allocation_outcomes.assign(outcome_names.size() * kAllocationSlots, 0);
+    scene_visits.assign(graph.scenes().size(), 0);
+    scene_stress.assign(graph.scenes().size(), 0);
+    scene_sanity.assign(graph.scenes().size(), 0);
+    condition_passes.assign(graph.conditions().size(), 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SimulationReport::merge(const SimulationReport& other) {
+    auto add = [](auto& into, const auto& from) {
+        for (size_t i = 0; i < into.size(); ++i) into[i] += from[i];
+    };
+    runs += other.runs;
+    add(outcomes, other.outcomes);
+    add(allocation_runs, other.allocation_runs);
+    add(allocation_outcomes, other.allocation_outcomes);
+    add(scene_visits, other.scene_visits);
+    add(scene_stress, other.scene_stress);
+    add(scene_sanity, other.scene_sanity);
+    add(condition_passes, other.condition_passes);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void SimulationReport::print(std::ostream& out, const StoryGraph& graph) const {
+    out << std::fixed << std::setprecision(2);
+    out << "Simulated " << runs << " playthroughs on " << threads << " threads in " << seconds << " s ("
+        << std::setprecision(0) << (seconds > 0 ? static_cast<double>(runs) / seconds : 0.0) << " runs/s)\n\n";
+
+    out << std::setprecision(2) << "Ending distribution:\n";
+    for (size_t i = 0; i < outcomes.size(); ++i) {
+        if (outcomes[i] == 0 && static_cast<int>(i) >= noEndingOutcome()) continue;
+        out << "  " << std::left << std::setw(16) << outcome_names[i] << std::right << std::setw(12) << outcomes[i]
+            << std::setw(9) << percent(outcomes[i], runs) << " %\n";
+    }
+
+    out << "\nAverage stress / sanity at each checkpoint:\n";
+    for (size_t scene = 0; scene < scene_visits.size(); ++scene) {
+        if (scene_visits[scene] == 0) continue;
+        double visits = static_cast<double>(scene_visits[scene]);
+        out << "  " << std::left << std::setw(16) << graph.scenes()[scene].name << std::right
+            << std::setw(8) << static_cast<double>(scene_stress[scene]) / visits
+            << std::setw(8) << static_cast<double>(scene_sanity[scene]) / visits
+            << "   (" << percent(scene_visits[scene], runs) << " % of runs)\n";
+    }
+
+    out << "\nStat allocations unlocking each ending (strength/intelligence/dexterity):\n";
+    const int points = kAttributePoints;
+    size_t tried = 0;
+    for (uint64_t count : allocation_runs) tried += count > 0;
+
+    for (size_t outcome = 0; outcome < outcomes.size(); ++outcome) {
+        if (outcomes[outcome] == 0) continue;
+        const uint64_t* counts = allocation_outcomes.data() + outcome * kAllocationSlots;
+
+        size_t unlocking = 0;
+        int min_strength = points, min_intelligence = points, min_dexterity = points;
+        int best_slot = -1;
+        double best_rate = 0.0;
+        for (int strength = 0; strength <= points; ++strength) {
+            for (int intelligence = 0; intelligence <= points - strength; ++intelligence) {
+                int slot = allocationSlot(strength, intelligence);
+                if (counts[slot] == 0) continue;
+                ++unlocking;
+                min_strength = std::min(min_strength, strength);
+                min_intelligence = std::min(min_intelligence, intelligence);
+                min_dexterity = std::min(min_dexterity, points - strength - intelligence);
+                double rate = static_cast<double>(counts[slot]) / static_cast<double>(allocation_runs[slot]);
+                if (rate > best_rate) {
+                    best_rate = rate;
+                    best_slot = slot;
+                }
+            }
+        }
+
+        int best_strength = best_slot / (points + 1);
+        int best_intelligence = best_slot % (points + 1);
+        out << "  " << std::left << std::setw(16) << outcome_names[outcome] << std::right
+            << unlocking << "/" << tried << " allocations, minimum " << min_strength << "/" << min_intelligence
+            << "/" << min_dexterity << ", best " << best_strength << "/" << best_intelligence << "/"
+            << points - best_strength - best_intelligence << " (" << 100.0 * best_rate << " %)\n";
+    }
+
+    // Only stat conditions are listed; a condition used by several choices is listed once
+    out << "\nRuns ending with the stats each story condition asks for:\n";
+    std::set<std::string> listed;
+    for (size_t i = 0; i < condition_passes.size(); ++i) {
+        const StoryGraph::Condition& condition = graph.condition(static_cast<uint32_t>(i));
+        if (condition.kind != StoryGraph::Condition::STAT) continue;
+        std::string text = describeStat(condition);
+        if (!listed.insert(text).second) continue;
+        out << "  " << std::left << std::setw(28) << text << std::right << std::setw(9)
+            << percent(condition_passes[i], runs) << " %\n";
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SimulationReport simulate(const StoryGraph& graph, const SimulationOptions& options) {
+    unsigned threads = options.threads;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const std::vector<Allocation> allocations = allAllocations();
+    std::vector<SimulationReport> partial(threads, SimulationReport(graph));
+    std::atomic<uint64_t> next_run(0);
+
+    // Workers claim blocks of run numbers until none are left, so fast threads pick up the slack of slow ones
+    auto worker = [&](SimulationReport& report) {
+        renderer.setInstant(true);
+        renderer.setMuted(true);
+        StoryRunner runner(graph);
+        PlayerBatch finals;
+        for (;;) {
+            uint64_t first = next_run.fetch_add(kRunsPerClaim, std::memory_order_relaxed);
+            if (first >= options.runs) break;
+            uint64_t last = std::min(options.runs, first + kRunsPerClaim);
+            for (uint64_t run = first; run < last; ++run) {
+                playOnce(graph, runner, allocations, options.seed, run, report, finals);
+            }
+            checkFinals(graph, finals, report);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i) pool.emplace_back(worker, std::ref(partial[i]));
+    for (std::thread& thread : pool) thread.join();
+
+    SimulationReport report = partial[0];
+    for (unsigned i = 1; i < threads; ++i) report.merge(partial[i]);
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.threads = threads;
+    return report;
+}
@@ -0,0 +1,83 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Monte Carlo outcome simulator
+// Plays randomized games through the real story engine on every core to measure how stat allocations, decisions
+// and dice rolls distribute players across the endings.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SIMULATOR_H
+#define OSIRIS_SIMULATOR_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "story.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Simulation parameters
+struct SimulationOptions {
+    uint64_t runs = 1000000;        // Number of playthroughs
+    unsigned threads = 0;           // Worker threads, 0 for one per hardware thread
+    uint64_t seed = 1;              // Run i plays on its own streams of seed, so results do not depend on threads
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Aggregated results of a simulation
+///
+/// Each worker fills its own report and the reports are merged once all runs are done, so workers never share
+/// a cache line while playing.
+struct SimulationReport {
+    static constexpr int kAttributePoints = 30;         // Points distributed in createPlayer
+    static constexpr int kAllocationSlots = (kAttributePoints + 1) * (kAttributePoints + 1);
+
+    /// Allocation slot of a strength/intelligence split; dexterity takes the remaining points
+    static int allocationSlot(int strength, int intelligence) {
+        return strength * (kAttributePoints + 1) + intelligence;
+    }
+
+    /// Outcome slots: one per story ending, then these two
+    int noEndingOutcome() const { return static_cast<int>(outcome_names.size()) - 2; }
+    int sanityBreakOutcome() const { return static_cast<int>(outcome_names.size()) - 1; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Create an empty report for a story
+    /// @param graph Story whose endings and scenes are counted
+    explicit SimulationReport(const StoryGraph& graph);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Add another report's counts to this one
+    /// @param other Report of the same story
+    void merge(const SimulationReport& other);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Print the ending distribution, stat trajectories, the allocations that unlock each ending and how many runs end
+    /// meeting each stat condition of the story
+    /// @param out Destination stream
+    /// @param graph Story the report was made for
+    void print(std::ostream& out, const StoryGraph& graph) const;
+
+    uint64_t runs;
+    std::vector<const char*> outcome_names;
+    std::vector<uint64_t> outcomes;                     // Runs per outcome
+    std::vector<uint64_t> allocation_runs;              // Runs per allocation slot
+    std::vector<uint64_t> allocation_outcomes;          // Runs per outcome and allocation slot
+    std::vector<uint64_t> scene_visits;                 // Runs that reached each scene checkpoint
+    std::vector<int64_t> scene_stress;                  // Sum of stress at each checkpoint
+    std::vector<int64_t> scene_sanity;                  // Sum of sanity at each checkpoint
+    std::vector<uint64_t> condition_passes;             // Runs whose final state passes each story condition
+    double seconds;
+    unsigned threads;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Play randomized games across worker threads
+///
+/// Every run allocates the attribute points uniformly at random, picks uniformly among the offered choices and
+/// always continues the story from the game menu. The story engine, stress handling and end-of-turn events are
+/// the ones the game uses; each worker has its own GameState and a muted renderer.
+/// @param graph Loaded story
+/// @param options Run count, thread count and base seed
+/// @return Merged results of all runs
+SimulationReport simulate(const StoryGraph& graph, const SimulationOptions& options);
+
+#endif // OSIRIS_SIMULATOR_H
@@ -0,0 +1,720 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Story graph engine
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "story.h"
+
+#include <algorithm>
+#include <bitset>
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <type_traits>
+
+#include "trace.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Markup tags accepted inside story text and the bytes they become
+struct Markup {
+    const char* tag;
+    const char* bytes;
+};
+
+const Markup kMarkup[] = {
+    {"red", RED}, {"green", GREEN}, {"blue", BLUE}, {"magenta", MAGENTA}, {"cyan", CYAN},
+    {"yellow", YELLOW}, {"white", WHITE}, {"bold", BOLD}, {"reset", RESET},
+    {"name", "\x01"}, {"loops", "\x02"}
+};
+
+const char* const kRelationshipNames[] = {
+    "HOSTILE", "DISTRUSTFUL", "NEUTRAL", "TRUSTING", "ALLIED"
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+string trim(const string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Split "keyword rest of line" into its two parts
+void splitWord(const string& text, string& word, string& rest) {
+    size_t space = text.find_first_of(" \t");
+    if (space == string::npos) {
+        word = text;
+        rest.clear();
+    } else {
+        word = text.substr(0, space);
+        rest = trim(text.substr(space));
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+StoryStat parseStat(const string& text) {
+    for (size_t i = 0; i < kStatCount; ++i) {
+        if (text == kStatNames[i]) return static_cast<StoryStat>(i);
+    }
+    return StoryStat::NONE;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool parseInt(const string& text, int32_t& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (*end != '\0') return false;
+    value = static_cast<int32_t>(parsed);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Parse a number or a relationship status name
+bool parseValue(const string& text, int32_t& value) {
+    for (int i = 0; i < 5; ++i) {
+        if (text == kRelationshipNames[i]) {
+            value = i - 2;
+            return true;
+        }
+    }
+    return parseInt(text, value);
+}
+
+// BIT checks read a whole bitset as one word
+static_assert(kMaxSecrets <= 64 && kMaxItems <= 64, "secrets and items must fit in one word");
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Orderings of lhs against rhs for which a comparison holds, as a Check::passing mask
+uint8_t passingOrders(StoryGraph::Condition::Compare op) {
+    using Check = StoryGraph::Check;
+    switch (op) {
+        case StoryGraph::Condition::LESS: return Check::kLess;
+        case StoryGraph::Condition::LESS_EQUAL: return Check::kLess | Check::kEqual;
+        case StoryGraph::Condition::GREATER: return Check::kGreater;
+        case StoryGraph::Condition::GREATER_EQUAL: return Check::kGreater | Check::kEqual;
+        case StoryGraph::Condition::EQUAL: return Check::kEqual;
+        case StoryGraph::Condition::NOT_EQUAL: return Check::kLess | Check::kGreater;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Read a field of a player by its byte offset
+template <typename T>
+T field(const PlayerState& player, uint16_t offset) {
+    T value;
+    std::memcpy(&value, reinterpret_cast<const char*>(&player) + offset, sizeof(value));
+    return value;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Operand of a check for a player; every kind but CHANCE only reads the player
+int operand(const StoryGraph::Check& check, const PlayerState& player) {
+    switch (check.load) {
+        case StoryGraph::Check::INT: return field<int>(player, check.offset);
+        case StoryGraph::Check::INT_SUM:
+            return field<int>(player, check.offset) + field<int>(player, check.offset_extra);
+        case StoryGraph::Check::INT8: return field<int8_t>(player, check.offset);
+        case StoryGraph::Check::BOOL: return field<bool>(player, check.offset);
+        case StoryGraph::Check::BIT: {
+            uint64_t bits = check.offset == offsetof(PlayerState, inventory) ? player.inventory.to_ullong()
+                                                                             : player.discovered_secrets.to_ullong();
+            return static_cast<int>((bits >> check.bit) & 1);
+        }
+        case StoryGraph::Check::TIME_LOOP: return game_state.isInTimeLoop();
+        case StoryGraph::Check::CHANCE: return game_state.rollDice(1, 100);
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Compare an operand with a check's value: the ordering (0 less, 1 equal, 2 greater) picks a bit of the mask
+inline uint8_t orderPasses(const StoryGraph::Check& check, int lhs) {
+    int order = (lhs > check.value) - (lhs < check.value) + 1;
+    return static_cast<uint8_t>((check.passing >> order) & 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Builds a StoryGraph's tables; names are resolved once every node and scene is known
+class StoryParser {
+public:
+    StoryParser(vector<StoryGraph::Scene>& scenes, vector<StoryGraph::Node>& nodes, vector<string>& node_names,
+                vector<string>& endings, vector<StoryGraph::Statement>& statements,
+                vector<StoryGraph::Condition>& conditions, vector<StoryGraph::Text>& texts, string& pool)
+        : scenes_(scenes), nodes_(nodes), node_names_(node_names), endings_(endings), statements_(statements),
+          conditions_(conditions), texts_(texts), pool_(pool), line_number_(0),
+          pending_requires_(0) {}
+
+    bool parse(std::istream& in, string& error) {
+        string raw;
+        while (std::getline(in, raw)) {
+            ++line_number_;
+            string line = trim(raw);
+            if (line.empty() || line[0] == '#') continue;
+            if (!parseLine(line)) {
+                error = "line " + std::to_string(line_number_) + ": " + error_ + " (" + line + ")";
+                return false;
+            }
+        }
+        if (pending_requires_ > 0) {
+            error = "require at the end of the story is not followed by a choice";
+            return false;
+        }
+        if (!resolve()) {
+            error = error_;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    /// Reference to a node or scene by name, patched once parsing finishes
+    struct Fixup {
+        uint32_t statement;     // Statement whose arg to patch, or scene index for scene entries
+        bool scene_entry;
+        bool scene_target;
+        string name;
+        int line;
+    };
+
+    bool fail(const string& message) {
+        error_ = message;
+        return false;
+    }
+
+    template <typename Table>
+    bool internSymbol(Table& table, const string& name, SymbolId& id) {
+        if (name.empty()) return fail("expected a name");
+        id = table.intern(name);
+        if (id == kNoSymbol) return fail("too many distinct names, '" + name + "' does not fit");
+        return true;
+    }
+
+    bool parseLine(const string& line) {
+        string word, rest;
+        splitWord(line, word, rest);
+
+        if (word == "scene" && nodes_.empty()) {
+            string name, entry;
+            splitWord(rest, name, entry);
+            if (name.empty()) return fail("scene needs a name");
+            if (scene_index_.count(name)) return fail("duplicate scene");
+            scene_index_[name] = static_cast<uint32_t>(scenes_.size());
+            scenes_.push_back({name, -1});
+            if (!entry.empty()) {
+                fixups_.push_back({static_cast<uint32_t>(scenes_.size() - 1), true, false, entry, line_number_});
+            }
+            return true;
+        }
+
+        if ((word == "secret" || word == "item") && nodes_.empty()) {
+            string name, description;
+            splitWord(rest, name, description);
+            SymbolId id = kNoSymbol;
+            bool interned = word == "secret" ? internSymbol(secret_symbols, name, id)
+                                             : internSymbol(item_symbols, name, id);
+            if (!interned) return false;
+            if (word == "secret") secret_symbols.describe(id, description);
+            else item_symbols.describe(id, description);
+            return true;
+        }
+
+        if (word == "node") {
+            if (pending_requires_ > 0) return fail("the previous node ends with a require and no choice");
+            if (rest.empty()) return fail("node needs a name");
+            if (node_index_.count(rest)) return fail("duplicate node");
+            node_index_[rest] = static_cast<uint32_t>(nodes_.size());
+            nodes_.push_back({static_cast<uint32_t>(statements_.size()), 0});
+            node_names_.push_back(rest);
+            return true;
+        }
+
+        if (nodes_.empty()) return fail("statement outside of a node");
+        return parseStatement(line);
+    }
+
+    bool parseStatement(string line) {
+        StoryGraph::Statement statement{StoryGraph::Op::SAY, 0, static_cast<uint32_t>(conditions_.size()), 0, 0};
+
+        if (line[0] == '[') {
+            size_t close = line.find(']');
+            if (close == string::npos) return fail("unterminated condition");
+            if (!parseCondition(line.substr(1, close - 1), statement)) return false;
+            line = trim(line.substr(close + 1));
+        }
+
+        string word, rest;
+        splitWord(line, word, rest);
+        uint32_t index = static_cast<uint32_t>(statements_.size());
+
+        if (word == "say") {
+            statement.op = StoryGraph::Op::SAY;
+            if (!addText(rest, statement.arg)) return false;
+        } else if (word == "stress") {
+            statement.op = StoryGraph::Op::STRESS;
+            if (!parseInt(rest, statement.value)) return fail("expected a signed amount");
+        } else if (word == "sanity" || word == "trust") {
+            // Plain additions; stress has its own op because it clamps and reacts
+            statement.op = StoryGraph::Op::ADD;
+            statement.arg = kStatOffsets[static_cast<size_t>(parseStat(word))];
+            if (!parseInt(rest, statement.value)) return fail("expected a signed amount");
+        } else if (word == "rel") {
+            string name, amount;
+            splitWord(rest, name, amount);
+            statement.op = StoryGraph::Op::RELATIONSHIP;
+            SymbolId id = kNoSymbol;
+            if (!internSymbol(character_symbols, name, id)) return false;
+            statement.arg = id;
+            if (!parseInt(amount, statement.value)) return fail("expected rel NAME AMOUNT");
+        } else if (word == "secret" || word == "item") {
+            statement.op = word == "secret" ? StoryGraph::Op::SECRET : StoryGraph::Op::ITEM;
+            SymbolId id = kNoSymbol;
+            bool interned = word == "secret" ? internSymbol(secret_symbols, rest, id)
+                                             : internSymbol(item_symbols, rest, id);
+            if (!interned) return false;
+            statement.arg = id;
+        } else if (word == "admin" || word == "timeloop") {
+            statement.op = word == "admin" ? StoryGraph::Op::ADMIN : StoryGraph::Op::TIME_LOOP;
+        } else if (word == "require") {
+            string stat, amount;
+            splitWord(rest, stat, amount);
+            statement.op = StoryGraph::Op::REQUIRE;
+            StoryStat parsed = parseStat(stat);
+            if (parsed == StoryStat::NONE || !parseInt(amount, statement.value)) return fail("expected require STAT N");
+            statement.arg = static_cast<uint32_t>(parsed);
+            if (++pending_requires_ > Choice::kMaxRequirements) return fail("too many requirements for one choice");
+        } else if (word == "choice") {
+            string target, label;
+            splitWord(rest, target, label);
+            if (label.empty()) return fail("expected choice NODE TEXT");
+            statement.op = StoryGraph::Op::CHOICE;
+            uint32_t text = 0;
+            if (!addText(label, text)) return false;
+            statement.value = static_cast<int32_t>(text);
+            fixups_.push_back({index, false, false, target, line_number_});
+            pending_requires_ = 0;
+        } else if (word == "goto") {
+            statement.op = StoryGraph::Op::GOTO;
+            fixups_.push_back({index, false, false, rest, line_number_});
+        } else if (word == "next") {
+            statement.op = StoryGraph::Op::NEXT;
+            fixups_.push_back({index, false, true, rest, line_number_});
+        } else if (word == "ending") {
+            if (rest.empty()) return fail("ending needs a name");
+            statement.op = StoryGraph::Op::ENDING;
+            statement.arg = static_cast<uint32_t>(std::find(endings_.begin(), endings_.end(), rest) - endings_.begin());
+            if (statement.arg == endings_.size()) endings_.push_back(rest);
+        } else {
+            return fail("unknown statement '" + word + "'");
+        }
+
+        statement.condition_count = static_cast<uint8_t>(conditions_.size() - statement.condition_first);
+        statements_.push_back(statement);
+        nodes_.back().count++;
+        return true;
+    }
+
+    bool parseCondition(const string& text, StoryGraph::Statement& statement) {
+        size_t start = 0;
+        while (start <= text.size()) {
+            size_t amp = text.find('&', start);
+            string term = trim(text.substr(start, amp == string::npos ? string::npos : amp - start));
+            if (!parseTerm(term)) return false;
+            if (amp == string::npos) break;
+            start = amp + 1;
+        }
+        if (conditions_.size() - statement.condition_first > 255) return fail("too many condition terms");
+        return true;
+    }
+
+    bool parseTerm(string term) {
+        StoryGraph::Condition condition{StoryGraph::Condition::STAT, StoryGraph::Condition::EQUAL, false,
+                                        StoryStat::NONE, StoryStat::NONE, kNoSymbol, 0};
+        if (term.empty()) return fail("empty condition term");
+
+        static const struct { const char* text; StoryGraph::Condition::Compare op; } kOps[] = {
+            {">=", StoryGraph::Condition::GREATER_EQUAL}, {"<=", StoryGraph::Condition::LESS_EQUAL},
+            {"==", StoryGraph::Condition::EQUAL}, {"!=", StoryGraph::Condition::NOT_EQUAL},
+            {">", StoryGraph::Condition::GREATER}, {"<", StoryGraph::Condition::LESS}
+        };
+
+        for (const auto& op : kOps) {
+            size_t at = term.find(op.text);
+            if (at == string::npos) continue;
+
+            string lhs = trim(term.substr(0, at));
+            string rhs = trim(term.substr(at + std::char_traits<char>::length(op.text)));
+            condition.compare = op.op;
+            if (!parseValue(rhs, condition.value)) return fail("bad comparison value '" + rhs + "'");
+
+            if (lhs.compare(0, 4, "rel:") == 0) {
+                condition.kind = StoryGraph::Condition::RELATIONSHIP;
+                if (!internSymbol(character_symbols, lhs.substr(4), condition.symbol)) return false;
+            } else {
+                size_t plus = lhs.find('+');
+                condition.stat = parseStat(trim(lhs.substr(0, plus)));
+                if (plus != string::npos) {
+                    condition.stat_extra = parseStat(trim(lhs.substr(plus + 1)));
+                    if (condition.stat_extra == StoryStat::NONE) return fail("unknown stat in '" + lhs + "'");
+                }
+                if (condition.stat == StoryStat::NONE) return fail("unknown stat in '" + lhs + "'");
+            }
+            conditions_.push_back(condition);
+            return true;
+        }
+
+        if (term[0] == '!') {
+            condition.negate = true;
+            term = trim(term.substr(1));
+        }
+
+        if (term == "admin") {
+            condition.kind = StoryGraph::Condition::ADMIN;
+        } else if (term == "loop") {
+            condition.kind = StoryGraph::Condition::TIME_LOOP;
+        } else if (term.compare(0, 7, "secret:") == 0) {
+            condition.kind = StoryGraph::Condition::SECRET;
+            if (!internSymbol(secret_symbols, term.substr(7), condition.symbol)) return false;
+        } else if (term.compare(0, 5, "item:") == 0) {
+            condition.kind = StoryGraph::Condition::ITEM;
+            if (!internSymbol(item_symbols, term.substr(5), condition.symbol)) return false;
+        } else if (term.compare(0, 7, "chance:") == 0) {
+            condition.kind = StoryGraph::Condition::CHANCE;
+            if (!parseInt(term.substr(7), condition.value)) return fail("bad chance percentage");
+        } else {
+            return fail("unknown condition '" + term + "'");
+        }
+        conditions_.push_back(condition);
+        return true;
+    }
+
+    bool addText(const string& source, uint32_t& index) {
+        StoryGraph::Text text{static_cast<uint32_t>(pool_.size()), 0, false};
+
+        for (size_t i = 0; i < source.size(); ++i) {
+            char c = source[i];
+            if (c == '\\' && i + 1 < source.size() && source[i + 1] == 'n') {
+                pool_ += '\n';
+                ++i;
+            } else if (c == '{') {
+                size_t close = source.find('}', i);
+                if (close == string::npos) return fail("unterminated markup");
+                string tag = source.substr(i + 1, close - i - 1);
+                bool known = false;
+                for (const Markup& markup : kMarkup) {
+                    if (tag != markup.tag) continue;
+                    pool_ += markup.bytes;
+                    text.dynamic = text.dynamic || markup.bytes[0] < '\x03';
+                    known = true;
+                    break;
+                }
+                if (!known) return fail("unknown markup {" + tag + "}");
+                i = close;
+            } else {
+                pool_ += c;
+            }
+        }
+
+        text.length = static_cast<uint32_t>(pool_.size() - text.offset);
+        index = static_cast<uint32_t>(texts_.size());
+        texts_.push_back(text);
+        return true;
+    }
+
+    bool resolve() {
+        for (const Fixup& fixup : fixups_) {
+            if (fixup.scene_target) {
+                auto it = scene_index_.find(fixup.name);
+                if (it == scene_index_.end()) return failAt(fixup, "unknown scene '" + fixup.name + "'");
+                statements_[fixup.statement].arg = it->second;
+                continue;
+            }
+            auto it = node_index_.find(fixup.name);
+            if (it == node_index_.end()) return failAt(fixup, "unknown node '" + fixup.name + "'");
+            if (fixup.scene_entry) {
+                scenes_[fixup.statement].entry = static_cast<int32_t>(it->second);
+            } else {
+                statements_[fixup.statement].arg = it->second;
+            }
+        }
+
+        if (scenes_.empty()) return fail("story declares no scenes");
+
+        // Every node must be able to stop: an unconditional exit or at least one choice that is always offered,
+        // i.e. has no condition and no require before it (even a guarded require may apply)
+        for (size_t n = 0; n < nodes_.size(); ++n) {
+            const StoryGraph::Node& node = nodes_[n];
+            int choices = 0;
+            int always_offered = 0;
+            bool required = false;
+            bool exits = false;
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const StoryGraph::Statement& statement = statements_[i];
+                if (statement.op == StoryGraph::Op::REQUIRE) required = true;
+                if (statement.op == StoryGraph::Op::CHOICE) {
+                    ++choices;
+                    if (statement.condition_count == 0 && !required) ++always_offered;
+                    required = false;
+                }
+                if ((statement.op == StoryGraph::Op::GOTO || statement.op == StoryGraph::Op::NEXT) &&
+                    statement.condition_count == 0) {
+                    exits = true;
+                }
+            }
+            if (choices > StoryRunner::kMaxChoices) return fail("node '" + node_names_[n] + "' has too many choices");
+            if (!exits && always_offered == 0) return fail("node '" + node_names_[n] + "' never stops");
+        }
+        return true;
+    }
+
+    bool failAt(const Fixup& fixup, const string& message) {
+        return fail("line " + std::to_string(fixup.line) + ": " + message);
+    }
+
+    vector<StoryGraph::Scene>& scenes_;
+    vector<StoryGraph::Node>& nodes_;
+    vector<string>& node_names_;
+    vector<string>& endings_;
+    vector<StoryGraph::Statement>& statements_;
+    vector<StoryGraph::Condition>& conditions_;
+    vector<StoryGraph::Text>& texts_;
+    string& pool_;
+
+    std::map<string, uint32_t> scene_index_;
+    std::map<string, uint32_t> node_index_;
+    vector<Fixup> fixups_;
+    int line_number_;
+    int pending_requires_;          // require statements waiting for the choice they apply to
+    string error_;
+};
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+bool StoryGraph::load(const string& path, string& error) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    if (!parse(in, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool StoryGraph::parse(std::istream& in, string& error) {
+    *this = StoryGraph();
+    StoryParser parser(scenes_, nodes_, node_names_, endings_, statements_, conditions_, texts_, pool_);
+    if (!parser.parse(in, error)) return false;
+
+    checks_.reserve(conditions_.size());
+    for (const Condition& condition : conditions_) checks_.push_back(compile(condition));
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+StoryGraph::Check StoryGraph::compile(const Condition& condition) {
+    // Flag kinds test operand > 0; CHANCE passes when the roll is at most the percentage
+    Check check{Check::BOOL, Check::kGreater, 0, 0, 0, 0};
+    switch (condition.kind) {
+        case Condition::STAT:
+            check.load = condition.stat_extra == StoryStat::NONE ? Check::INT : Check::INT_SUM;
+            check.offset = kStatOffsets[static_cast<size_t>(condition.stat)];
+            if (condition.stat_extra != StoryStat::NONE) {
+                check.offset_extra = kStatOffsets[static_cast<size_t>(condition.stat_extra)];
+            }
+            check.passing = passingOrders(condition.compare);
+            check.value = condition.value;
+            break;
+        case Condition::RELATIONSHIP:
+            check.load = Check::INT8;
+            check.offset = static_cast<uint16_t>(offsetof(PlayerState, relationships) + condition.symbol);
+            check.passing = passingOrders(condition.compare);
+            check.value = condition.value;
+            break;
+        case Condition::ADMIN:
+            check.offset = offsetof(PlayerState, has_admin_access);
+            break;
+        case Condition::TIME_LOOP:
+            check.load = Check::TIME_LOOP;
+            break;
+        case Condition::SECRET:
+        case Condition::ITEM:
+            check.load = Check::BIT;
+            check.offset = condition.kind == Condition::SECRET ? offsetof(PlayerState, discovered_secrets)
+                                                               : offsetof(PlayerState, inventory);
+            check.bit = static_cast<uint8_t>(condition.symbol);
+            break;
+        case Condition::CHANCE:
+            check.load = Check::CHANCE;
+            check.passing = Check::kLess | Check::kEqual;
+            check.value = condition.value;
+            break;
+    }
+    if (condition.negate) check.passing ^= Check::kLess | Check::kEqual | Check::kGreater;
+    return check;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool StoryGraph::test(const Check& check, const PlayerState& player) {
+    return orderPasses(check, operand(check, player)) != 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+StoryRunner::StoryRunner(const StoryGraph& graph)
+    : graph_(graph), node_(0), pc_(0), choice_statements_(), choice_count_(0), pending_(),
+      pending_count_(0), ending_(-1), visited_(nullptr) {
+    choices_.reserve(kMaxChoices);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool StoryRunner::begin(const Player& player) {
+    if (graph_.isFinalScene(player.current_scene)) return false;
+    resume(static_cast<uint32_t>(graph_.scenes()[player.current_scene].entry));
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void StoryRunner::resume(uint32_t node) {
+    ending_ = -1;
+    choices_.clear();
+    arena_.reset();
+    enter(node);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void StoryRunner::enter(uint32_t node) {
+    if (visited_ != nullptr) (*visited_)[node] = 1;
+    node_ = node;
+    pc_ = graph_.node(node).first;
+    choice_count_ = 0;
+    pending_count_ = 0;
+    choices_.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool StoryRunner::passes(const StoryGraph::Statement& statement, const PlayerState& player) const {
+    for (uint32_t i = 0; i < statement.condition_count; ++i) {
+        if (!StoryGraph::test(graph_.check(statement.condition_first + i), player)) return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+const string& StoryRunner::expand(uint32_t index, const Player& player) {
+    const StoryGraph::Text& text = graph_.text(index);
+    const char* data = graph_.textData(text);
+
+    if (!text.dynamic) {
+        line_.assign(data, text.length);
+        return line_;
+    }
+
+    line_.clear();
+    for (uint32_t i = 0; i < text.length; ++i) {
+        if (data[i] == StoryGraph::kNamePlaceholder) {
+            line_ += player.username;
+        } else if (data[i] == StoryGraph::kLoopsPlaceholder) {
+            char digits[16];
+            line_.append(digits, std::to_chars(digits, digits + sizeof(digits), game_state.getLoopCount()).ptr);
+        } else {
+            line_ += data[i];
+        }
+    }
+    return line_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+StoryStop StoryRunner::advance(Player& player) {
+    OSIRIS_TRACE_SCOPE("story.advance");
+    for (;;) {
+        const StoryGraph::Node& node = graph_.node(node_);
+        if (pc_ >= node.first + node.count) return StoryStop::DECISION;
+
+        const StoryGraph::Statement& statement = graph_.statement(pc_++);
+        if (statement.condition_count > 0 && !passes(statement, player)) {
+            // Requirements belong to the next choice even when it is not offered
+            if (statement.op == StoryGraph::Op::CHOICE) pending_count_ = 0;
+            continue;
+        }
+
+        switch (statement.op) {
+            case StoryGraph::Op::SAY:
+                printWithStress(expand(statement.arg, player), player);
+                break;
+            case StoryGraph::Op::STRESS:
+                modifyStress(player, statement.value);
+                break;
+            case StoryGraph::Op::ADD: {
+                int* stat = reinterpret_cast<int*>(reinterpret_cast<char*>(&player.state()) + statement.arg);
+                *stat += statement.value;
+                break;
+            }
+            case StoryGraph::Op::RELATIONSHIP:
+                updateRelationship(player, static_cast<SymbolId>(statement.arg), statement.value);
+                break;
+            case StoryGraph::Op::SECRET:
+                player.discovered_secrets.set(statement.arg);
+                break;
+            case StoryGraph::Op::ITEM:
+                player.inventory.set(statement.arg);
+                break;
+            case StoryGraph::Op::ADMIN:
+                player.has_admin_access = true;
+                break;
+            case StoryGraph::Op::TIME_LOOP:
+                game_state.activateTimeLoop();
+                break;
+            case StoryGraph::Op::REQUIRE:
+                pending_[pending_count_++] = {static_cast<StoryStat>(statement.arg), statement.value};
+                break;
+            case StoryGraph::Op::CHOICE: {
+                choice_statements_[choice_count_++] = pc_ - 1;
+                const string& label = expand(static_cast<uint32_t>(statement.value), player);
+                Choice& choice = choices_.emplace_back(label, &arena_);
+                std::copy(pending_, pending_ + pending_count_, choice.requirements);
+                choice.requirement_count = pending_count_;
+                pending_count_ = 0;
+                break;
+            }
+            case StoryGraph::Op::GOTO:
+                enter(statement.arg);
+                break;
+            case StoryGraph::Op::NEXT:
+                player.current_scene = static_cast<int>(statement.arg);
+                return StoryStop::SCENE_END;
+            case StoryGraph::Op::ENDING:
+                ending_ = static_cast<int>(statement.arg);
+                break;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void StoryRunner::choose(int choice) {
+    enter(graph_.statement(choice_statements_[choice - 1]).arg);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void StoryRunner::runScene(Player& player) {
+    if (!begin(player)) return;
+
+    while (advance(player) == StoryStop::DECISION) {
+        int choice = enhancedDecisionPoint(choices_, player);
+        if (choice == 0) return;
+        choose(choice);
+    }
+}
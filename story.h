@@ -0,0 +1,252 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Story graph engine
+// Scenes, choices, stat conditions and effects are loaded from a story file into flat, index-based tables.
+// All names are resolved while loading (secrets, items and characters to interned symbol ids), so walking the
+// graph is a table lookup per statement.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_STORY_H
+#define OSIRIS_STORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "game.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Immutable story content: scenes, nodes, statements, conditions and a shared text pool
+class StoryGraph {
+public:
+    /// Statement opcodes
+    enum class Op : uint8_t {
+        SAY,            // arg: text
+        STRESS,         // value: delta
+        ADD,            // arg: offset of an int stat in PlayerState, value: delta
+        RELATIONSHIP,   // arg: character id, value: delta
+        SECRET,         // arg: secret id
+        ITEM,           // arg: item id
+        ADMIN,
+        TIME_LOOP,
+        REQUIRE,        // arg: stat, value: threshold; applies to the next CHOICE
+        CHOICE,         // arg: target node, value: text
+        GOTO,           // arg: target node
+        NEXT,           // arg: scene
+        ENDING          // arg: ending index
+    };
+
+    /// Single condition term; a statement passes when all of its terms pass
+    struct Condition {
+        enum Kind : uint8_t { STAT, RELATIONSHIP, ADMIN, TIME_LOOP, SECRET, ITEM, CHANCE };
+        enum Compare : uint8_t { LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, EQUAL, NOT_EQUAL };
+
+        Kind kind;
+        Compare compare;
+        bool negate;
+        StoryStat stat;         // STAT: first operand
+        StoryStat stat_extra;   // STAT: optional second operand added to the first
+        SymbolId symbol;        // RELATIONSHIP / SECRET / ITEM
+        int32_t value;          // Right-hand side, CHANCE percentage
+    };
+
+    /// Condition term compiled for evaluation, one per Condition at the same index
+    ///
+    /// Every kind is reduced to loading one operand and comparing it with value: the field is found by its byte
+    /// offset in PlayerState, and the operator and any negation by a mask of the orderings that pass, so testing a
+    /// term is a load, two compares and a shift whatever the condition said.
+    struct Check {
+        enum Load : uint8_t {
+            INT,                // int at offset
+            INT_SUM,            // int at offset plus int at offset_extra
+            INT8,               // int8_t at offset (relationship status)
+            BOOL,               // bool at offset
+            BIT,                // Bit `bit` of the bitset at offset (discovered_secrets or inventory)
+            TIME_LOOP,          // 1 while the time loop is active
+            CHANCE              // Fresh roll of 1-100
+        };
+        static constexpr uint8_t kLess = 1, kEqual = 2, kGreater = 4;
+
+        Load load;
+        uint8_t passing;        // kLess / kEqual / kGreater: orderings of operand against value that pass
+        uint16_t offset;
+        uint16_t offset_extra;
+        uint8_t bit;
+        int32_t value;
+    };
+
+    struct Statement {
+        Op op;
+        uint8_t condition_count;
+        uint32_t condition_first;
+        uint32_t arg;
+        int32_t value;
+    };
+
+    struct Node {
+        uint32_t first;         // First statement
+        uint32_t count;         // Number of statements
+    };
+
+    struct Scene {
+        std::string name;
+        int32_t entry;          // Entry node, or -1 when reaching this scene ends the story
+    };
+
+    /// Text pool span; dynamic texts contain placeholders expanded per player
+    struct Text {
+        uint32_t offset;
+        uint32_t length;
+        bool dynamic;
+    };
+
+    static constexpr char kNamePlaceholder = '\x01';
+    static constexpr char kLoopsPlaceholder = '\x02';
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Load a story file, replacing any previously loaded content
+    /// @param path Story file path
+    /// @param error Receives a message with the offending line on failure
+    /// @return True on success
+    bool load(const std::string& path, std::string& error);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Parse story content from a stream
+    /// @param in Stream with story statements
+    /// @param error Receives a message with the offending line on failure
+    /// @return True on success
+    bool parse(std::istream& in, std::string& error);
+
+    const std::vector<Scene>& scenes() const { return scenes_; }
+    const std::vector<Node>& nodes() const { return nodes_; }
+    const Node& node(uint32_t index) const { return nodes_[index]; }
+    const Statement& statement(uint32_t index) const { return statements_[index]; }
+    const std::vector<Condition>& conditions() const { return conditions_; }
+    const Condition& condition(uint32_t index) const { return conditions_[index]; }
+    const Check& check(uint32_t index) const { return checks_[index]; }
+    const Text& text(uint32_t index) const { return texts_[index]; }
+    const char* textData(const Text& text) const { return pool_.data() + text.offset; }
+    const std::string& nodeName(uint32_t index) const { return node_names_[index]; }
+    const std::vector<std::string>& endings() const { return endings_; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Check whether a scene ends the story
+    /// @param scene Scene index
+    /// @return True if the scene has no entry node
+    bool isFinalScene(int scene) const {
+        return scene < 0 || scene >= static_cast<int>(scenes_.size()) || scenes_[scene].entry < 0;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Compile a condition term
+    /// @param condition Parsed term
+    /// @return Equivalent check
+    static Check compile(const Condition& condition);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Test one compiled term; CHANCE rolls game_state's dice
+    /// @param check Term to test
+    /// @param player Player to test against
+    /// @return True if the term passes
+    static bool test(const Check& check, const PlayerState& player);
+
+private:
+    std::vector<Scene> scenes_;
+    std::vector<Node> nodes_;
+    std::vector<std::string> node_names_;
+    std::vector<std::string> endings_;
+    std::vector<Statement> statements_;
+    std::vector<Condition> conditions_;
+    std::vector<Check> checks_;
+    std::vector<Text> texts_;
+    std::string pool_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Why StoryRunner::advance returned
+enum class StoryStop {
+    DECISION,       // Choices are ready; call choose()
+    SCENE_END       // The player reached the next checkpoint scene
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Walks a StoryGraph for one player; keeps its scratch buffers so scenes run without heap churn
+class StoryRunner {
+public:
+    static constexpr int kMaxChoices = 8;
+
+    explicit StoryRunner(const StoryGraph& graph);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Position the runner at the entry node of the player's current scene
+    /// @param player Player whose scene to start
+    /// @return False if the scene ends the story
+    bool begin(const Player& player);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Execute statements until a decision is needed or the scene ends
+    /// @param player Player affected by the statements
+    /// @return Reason for stopping
+    StoryStop advance(Player& player);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Position the runner at the start of any node, e.g. to continue from a stored exploration state
+    ///
+    /// Starts a new round of the scene arena: labels returned by choices() before this call are gone.
+    /// @param node Node index
+    void resume(uint32_t node);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Follow one of the choices offered by the last decision
+    /// @param choice Choice number (1-based, as returned by enhancedDecisionPoint)
+    void choose(int choice);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Run the player's current scene interactively until it hands over to the next scene, or until no valid choice
+    /// can be read, in which case the player stays in the scene
+    /// @param player Player taking part in the scene
+    void runScene(Player& player);
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Evaluate a statement's guard
+    /// @param statement Statement to check
+    /// @param player Player to check against
+    /// @return True if every condition term passes
+    bool passes(const StoryGraph::Statement& statement, const PlayerState& player) const;
+
+    const ChoiceList& choices() const { return choices_; }
+    uint32_t currentNode() const { return node_; }
+
+    /// Statement index of an offered choice (0-based); its arg is the target node
+    uint32_t choiceStatement(int index) const { return choice_statements_[index]; }
+
+    /// Mark every node entered from now on in visited, indexed by node; nullptr stops tracking
+    void trackVisits(std::vector<uint8_t>* visited) { visited_ = visited; }
+
+    /// Ending reached in the current scene as an index into StoryGraph::endings(), or -1
+    int ending() const { return ending_; }
+
+    /// Allocation counters of the scene arena
+    const ArenaStats& arenaStats() const { return arena_.stats(); }
+
+private:
+    void enter(uint32_t node);
+    const std::string& expand(uint32_t text, const Player& player);
+
+    const StoryGraph& graph_;
+    uint32_t node_;
+    uint32_t pc_;
+    uint32_t choice_statements_[kMaxChoices];
+    int choice_count_;
+    StatRequirement pending_[Choice::kMaxRequirements];     // Requirements read for the next choice
+    int pending_count_;
+    int ending_;
+    std::vector<uint8_t>* visited_;
+    Arena arena_;                   // Scene temporaries; rewound whenever a scene starts
+    ChoiceList choices_;
+    std::string line_;
+};
+
+#endif // OSIRIS_STORY_H
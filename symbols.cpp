@@ -0,0 +1,26 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Interned symbol tables
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "symbols.h"
+
+// Global symbol tables
+SymbolTable<kMaxSecrets> secret_symbols;
+SymbolTable<kMaxItems> item_symbols;
+SymbolTable<kMaxCharacters> character_symbols;
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Interns the built-in characters in CharacterId order before anything else can
+struct BuiltinCharacters {
+    BuiltinCharacters() {
+        character_symbols.intern("Captain_Hale");
+        character_symbols.intern("Dr_Mira");
+        character_symbols.intern("OSIRIS");
+    }
+};
+
+BuiltinCharacters builtin_characters;
+
+} // namespace
@@ -0,0 +1,120 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Interned symbol tables
+// Secrets, inventory items and characters are referred to by small integer ids everywhere except at the edges
+// (story loading, saves, display), so membership tests are bit tests and relationships index a fixed array.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_SYMBOLS_H
+#define OSIRIS_SYMBOLS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+using SymbolId = uint16_t;
+
+constexpr SymbolId kNoSymbol = 0xFFFF;
+constexpr size_t kMaxSecrets = 64;
+constexpr size_t kMaxItems = 64;
+constexpr size_t kMaxCharacters = 8;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Fixed-capacity interner mapping names to dense ids in order of first use
+///
+/// Names never move once interned, so lookups by id are safe from any thread while another thread interns.
+/// Descriptions are published the same way: each is written once into storage that never moves and its pointer is
+/// stored with release order, so a reader sees either no description or a complete one. Describing a symbol again
+/// publishes a new string and keeps the old one alive for readers still holding it.
+template <size_t Capacity>
+class SymbolTable {
+public:
+    SymbolTable() : count_(0) {
+        for (std::atomic<const std::string*>& text : descriptions_) text.store(nullptr, std::memory_order_relaxed);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Get the id of a name, adding it if it is new
+    /// @param name Symbol name
+    /// @return Symbol id, or kNoSymbol if the table is full
+    SymbolId intern(std::string_view name) {
+        SymbolId id = find(name);
+        if (id != kNoSymbol) return id;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = count_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i) {
+            if (names_[i] == name) return static_cast<SymbolId>(i);
+        }
+        if (count == Capacity) return kNoSymbol;
+        names_[count].assign(name.data(), name.size());
+        count_.store(count + 1, std::memory_order_release);
+        return static_cast<SymbolId>(count);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Look up a name without adding it
+    /// @param name Symbol name
+    /// @return Symbol id, or kNoSymbol if unknown
+    SymbolId find(std::string_view name) const {
+        size_t count = count_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            if (names_[i] == name) return static_cast<SymbolId>(i);
+        }
+        return kNoSymbol;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Attach display text to a symbol
+    /// @param id Symbol id
+    /// @param text Human readable description
+    void describe(SymbolId id, std::string_view text) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::string* current = descriptions_[id].load(std::memory_order_relaxed);
+        if (current != nullptr && *current == text) return;
+        described_.emplace_back(text.data(), text.size());
+        descriptions_[id].store(&described_.back(), std::memory_order_release);
+    }
+
+    const std::string& name(SymbolId id) const { return names_[id]; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Display text of a symbol
+    /// @param id Symbol id
+    /// @return The description, or the raw name when none was given
+    const std::string& description(SymbolId id) const {
+        const std::string* text = descriptions_[id].load(std::memory_order_acquire);
+        return text == nullptr || text->empty() ? names_[id] : *text;
+    }
+
+    size_t size() const { return count_.load(std::memory_order_acquire); }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    std::array<std::string, Capacity> names_;
+    std::array<std::atomic<const std::string*>, Capacity> descriptions_;
+    std::deque<std::string> described_;     // Every description ever given; a deque never moves its elements
+    std::atomic<size_t> count_;
+    std::mutex mutex_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Characters the player starts out with a relationship to; interned first so their ids are fixed
+enum CharacterId : SymbolId {
+    CHARACTER_CAPTAIN_HALE,
+    CHARACTER_DR_MIRA,
+    CHARACTER_OSIRIS,
+    CHARACTER_BUILTIN_COUNT
+};
+
+// Global symbol tables
+extern SymbolTable<kMaxSecrets> secret_symbols;
+extern SymbolTable<kMaxItems> item_symbols;
+extern SymbolTable<kMaxCharacters> character_symbols;
+
+#endif // OSIRIS_SYMBOLS_H
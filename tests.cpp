@@ -0,0 +1,889 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Engine tests
+// Checks the parts of the engine whose failures are silent in play: save logs recovering from torn or corrupt
+// tails, delta records reproducing every field, the input tokenizer at its edges, compiled story checks agreeing
+// with the conditions they were compiled from, clearance codes, recorded games replaying, and the server handing
+// designations out. Replay and server tests run the game and server binaries, so the tests are run from the source
+// directory, as `make test` does. Prints one line per test and exits non-zero if any check failed.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "game.h"
+#include "input.h"
+#include "playerbatch.h"
+#include "save.h"
+#include "savelog.h"
+#include "story.h"
+
+using std::string;
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Failures of the running test
+struct TestRun {
+    string path;                    // Scratch file the test may create and remove
+    int failures = 0;
+    std::vector<string> scratch;    // Further scratch files, removed after the test
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Name another scratch file, removed after the test
+    /// @param suffix Appended to path
+    /// @return Scratch file path
+    string file(const char* suffix) {
+        scratch.push_back(path + suffix);
+        unlink(scratch.back().c_str());
+        return scratch.back();
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Record a check
+    /// @param passed Outcome of the check
+    /// @param what What was checked, printed if it failed
+    void expect(bool passed, const string& what) {
+        if (passed) return;
+        ++failures;
+        std::cerr << "    failed: " << what << std::endl;
+    }
+};
+
+using TestFunction = void (*)(TestRun& run);
+
+struct Test {
+    const char* name;
+    TestFunction function;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// True if two players hold the same progress, field by field
+bool samePlayer(const Player& a, const Player& b) {
+    return a.username == b.username && a.credential == b.credential && a.age == b.age && a.strength == b.strength &&
+           a.intelligence == b.intelligence && a.dexterity == b.dexterity && a.stress_level == b.stress_level &&
+           a.sanity == b.sanity && a.osiris_trust == b.osiris_trust && a.current_scene == b.current_scene &&
+           a.has_admin_access == b.has_admin_access && a.relationships == b.relationships &&
+           a.discovered_secrets == b.discovered_secrets && a.inventory == b.inventory;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Size of a file, -1 if it cannot be read
+off_t fileSize(const string& path) {
+    struct stat info{};
+    return stat(path.c_str(), &info) == 0 ? info.st_size : -1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Successive saves of one player, each changing a few fields as a scene would
+std::vector<Player> progression() {
+    std::vector<Player> players;
+    Player player;
+    player.username = "tester";
+    player.age = 30;
+    player.strength = 9;
+    player.intelligence = 12;
+    player.dexterity = 9;
+    players.push_back(player);
+
+    player.current_scene = 1;
+    player.stress_level = 35;
+    player.discovered_secrets.set(secret_symbols.intern("test_cipher"));
+    players.push_back(player);
+
+    player.current_scene = 2;
+    player.relationships[CHARACTER_OSIRIS] = RelationshipStatus::DISTRUSTFUL;
+    player.inventory.set(item_symbols.intern("test_keycard"));
+    players.push_back(player);
+
+    player.current_scene = 3;
+    player.sanity = 61;
+    player.osiris_trust = -4;
+    players.push_back(player);
+    return players;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Write the progression to a fresh log, one save each
+/// @param ends Receives the log size after each save
+bool writeProgression(TestRun& run, const std::vector<Player>& players, std::vector<uint64_t>& ends) {
+    unlink(run.path.c_str());
+    GameState state;
+    SaveLog log;
+    for (const Player& player : players) {
+        if (!log.save(run.path, player, state)) return false;
+        ends.push_back(log.size());
+    }
+    log.close();
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Load a log with a fresh SaveLog, as a new session would
+bool loadFresh(const string& path, Player& player, SaveLogStats* stats = nullptr) {
+    GameState state;
+    SaveLog log;
+    bool loaded = log.load(path, player, state);
+    if (stats != nullptr) *stats = log.stats();
+    return loaded;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Check that a log whose last record is damaged loads as the save before it, is cut back to it and takes new saves
+void expectRecovered(TestRun& run, const std::vector<Player>& players, const std::vector<uint64_t>& ends) {
+    Player loaded;
+    SaveLogStats stats;
+    run.expect(loadFresh(run.path, loaded, &stats), "damaged log still loads");
+    run.expect(samePlayer(loaded, players[players.size() - 2]), "damaged log replays the records before the tail");
+    run.expect(stats.torn_bytes > 0, "damaged tail is counted");
+    run.expect(fileSize(run.path) == static_cast<off_t>(ends[ends.size() - 2]), "damaged tail is cut off");
+
+    GameState state;
+    SaveLog log;
+    run.expect(log.load(run.path, loaded, state) && log.save(run.path, players.back(), state), "save after a cut");
+    log.close();
+    run.expect(loadFresh(run.path, loaded, &stats) && samePlayer(loaded, players.back()), "save after a cut replays");
+    run.expect(stats.torn_bytes == 0, "log is intact after the cut");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void logTruncatedTail(TestRun& run) {
+    // Cut one byte short of the end, then just after the last record's tag
+    const std::vector<Player> players = progression();
+    for (bool short_by_one : {true, false}) {
+        std::vector<uint64_t> ends;
+        run.expect(writeProgression(run, players, ends), "progression is written");
+        uint64_t cut = short_by_one ? ends.back() - 1 : ends[ends.size() - 2] + 1;
+        run.expect(truncate(run.path.c_str(), static_cast<off_t>(cut)) == 0, "log is truncated");
+        expectRecovered(run, players, ends);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void logCorruptTail(TestRun& run) {
+    const std::vector<Player> players = progression();
+    std::vector<uint64_t> ends;
+    run.expect(writeProgression(run, players, ends), "progression is written");
+
+    // One flipped bit in the last record's payload fails its checksum
+    int fd = open(run.path.c_str(), O_RDWR);
+    char byte = 0;
+    off_t at = static_cast<off_t>(ends.back()) - 5;
+    run.expect(fd >= 0 && pread(fd, &byte, 1, at) == 1, "last record is read");
+    byte ^= 0x10;
+    run.expect(fd >= 0 && pwrite(fd, &byte, 1, at) == 1, "last record is corrupted");
+    if (fd >= 0) close(fd);
+    expectRecovered(run, players, ends);
+
+    // Garbage after the last record is cut without losing it
+    ends.clear();
+    run.expect(writeProgression(run, players, ends), "progression is written again");
+    fd = open(run.path.c_str(), O_WRONLY | O_APPEND);
+    const char garbage[] = "D\x7fnot a record";
+    run.expect(fd >= 0 && write(fd, garbage, sizeof(garbage)) == static_cast<ssize_t>(sizeof(garbage)),
+               "garbage is appended");
+    if (fd >= 0) close(fd);
+    Player loaded;
+    run.expect(loadFresh(run.path, loaded) && samePlayer(loaded, players.back()), "garbage keeps the last record");
+    run.expect(fileSize(run.path) == static_cast<off_t>(ends.back()), "garbage is cut off");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Every delta field, each changed on its own and reloaded through a fresh log
+void deltaRoundTrip(TestRun& run) {
+    unlink(run.path.c_str());
+    Player player;
+    player.username = "tester";
+    GameState state;
+    state.restoreTimeLoop(false, 0);
+    SaveLog log;
+    run.expect(log.save(run.path, player, state), "snapshot is written");
+
+    const SymbolId secret = secret_symbols.intern("test_archive");
+    const SymbolId item = item_symbols.intern("test_badge");
+    struct Change {
+        const char* field;
+        void (*apply)(Player& player, GameState& state, SymbolId secret, SymbolId item);
+    };
+    const Change changes[] = {
+        {"scene", [](Player& p, GameState&, SymbolId, SymbolId) { p.current_scene = 4; }},
+        {"age", [](Player& p, GameState&, SymbolId, SymbolId) { p.age = 71; }},
+        {"strength", [](Player& p, GameState&, SymbolId, SymbolId) { p.strength = 3; }},
+        {"intelligence", [](Player& p, GameState&, SymbolId, SymbolId) { p.intelligence = 17; }},
+        {"dexterity", [](Player& p, GameState&, SymbolId, SymbolId) { p.dexterity = 6; }},
+        {"stress", [](Player& p, GameState&, SymbolId, SymbolId) { p.stress_level = 100; }},
+        {"sanity", [](Player& p, GameState&, SymbolId, SymbolId) { p.sanity = 0; }},
+        {"trust", [](Player& p, GameState&, SymbolId, SymbolId) { p.osiris_trust = -12; }},
+        {"admin", [](Player& p, GameState&, SymbolId, SymbolId) { p.has_admin_access = true; }},
+        {"loop", [](Player&, GameState& s, SymbolId, SymbolId) { s.activateTimeLoop(); }},
+        {"username", [](Player& p, GameState&, SymbolId, SymbolId) { p.username = "tester-renamed"; }},
+        {"credential", [](Player& p, GameState&, SymbolId, SymbolId) { p.credential = Credential::make("1234"); }},
+        {"relationship", [](Player& p, GameState&, SymbolId, SymbolId) {
+             p.relationships[CHARACTER_DR_MIRA] = RelationshipStatus::ALLIED;
+             p.relationships[CHARACTER_OSIRIS] = RelationshipStatus::HOSTILE;
+         }},
+        {"secret found", [](Player& p, GameState&, SymbolId s, SymbolId) { p.discovered_secrets.set(s); }},
+        {"item gained", [](Player& p, GameState&, SymbolId, SymbolId i) { p.inventory.set(i); }},
+        {"secret lost", [](Player& p, GameState&, SymbolId s, SymbolId) { p.discovered_secrets.reset(s); }},
+        {"item lost", [](Player& p, GameState&, SymbolId, SymbolId i) { p.inventory.reset(i); }},
+        {"loop ended", [](Player&, GameState& s, SymbolId, SymbolId) { s.restoreTimeLoop(false, 1); }},
+    };
+
+    uint64_t deltas = 0;
+    for (const Change& change : changes) {
+        change.apply(player, state, secret, item);
+        run.expect(log.save(run.path, player, state), string(change.field) + " is saved");
+        ++deltas;
+
+        Player loaded;
+        GameState loaded_state;
+        SaveLog reader;
+        run.expect(reader.load(run.path, loaded, loaded_state), string(change.field) + " is loaded");
+        run.expect(samePlayer(loaded, player), string(change.field) + " round-trips");
+        run.expect(loaded_state.isInTimeLoop() == state.isInTimeLoop() &&
+                   loaded_state.getLoopCount() == state.getLoopCount(), string(change.field) + " keeps the loop");
+        run.expect(reader.stats().replayed == deltas, string(change.field) + " is replayed as a delta");
+    }
+    run.expect(log.stats().deltas == deltas && log.stats().snapshots == 1, "every save after the first is a delta");
+
+    // A save that changes nothing appends nothing
+    uint64_t size = log.size();
+    run.expect(log.save(run.path, player, state) && log.size() == size, "unchanged save appends nothing");
+    log.close();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Save images read at every alignment, as snapshots inside a save log are
+void saveUnaligned(TestRun& run) {
+    Player player = progression().back();
+    player.credential = Credential::make("1234");
+    GameState state;
+    state.activateTimeLoop();
+    string image;
+    encodeSave(player, state, image);
+
+    for (size_t shift = 0; shift < 8; ++shift) {
+        string buffer(shift, '\0');
+        buffer += image;
+        SaveView view;
+        bool attached = view.attach(buffer.data() + shift, image.size());
+        run.expect(attached, "image at offset " + std::to_string(shift) + " is valid");
+        if (!attached) continue;
+        Player loaded;
+        GameState loaded_state;
+        decodeSave(view, loaded, loaded_state);
+        run.expect(samePlayer(loaded, player) && loaded_state.getLoopCount() == 1,
+                   "image at offset " + std::to_string(shift) + " decodes");
+    }
+
+    image[sizeof(SaveHeader) + 3] ^= 1;
+    SaveView corrupt;
+    run.expect(!corrupt.attach(image.data(), image.size()), "a corrupt image is refused");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Words read from text until the reader reports the end
+std::vector<string> readWords(InputReader& reader) {
+    std::vector<string> words;
+    while (const char* word = reader.next()) words.push_back(word);
+    return words;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void tokenizerEndOfInput(TestRun& run) {
+    std::stringbuf text("  one\ttwo \r\n\nthree");
+    InputReader reader(&text);
+    run.expect(readWords(reader) == std::vector<string>{"one", "two", "three"}, "last line without a newline is read");
+    run.expect(reader.ended() && reader.next() == nullptr && reader.next() == nullptr, "end of input is sticky");
+
+    std::stringbuf blank("\n \n\t\n");
+    reader.setSource(&blank);
+    run.expect(reader.next() == nullptr && reader.ended(), "blank input ends");
+
+    std::stringbuf empty("");
+    reader.setSource(&empty);
+    run.expect(reader.next() == nullptr, "empty input ends");
+
+    InputReader unbound;
+    run.expect(unbound.next() == nullptr, "reader without a source ends");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void tokenizerOverlongLines(TestRun& run) {
+    // 50 words of six bytes with their blanks make a 300-byte line; only the whole words within the buffer are kept
+    string line;
+    for (int i = 0; i < 50; ++i) line += "word" + std::to_string(i % 10) + " ";
+    std::stringbuf text(line + "\nnext\n" + string(InputReader::kLineBytes * 2, 'x') + "\nafter\n");
+    InputReader reader(&text);
+    std::vector<string> words = readWords(reader);
+
+    const size_t kept = (InputReader::kLineBytes - 1) / 6;
+    run.expect(words.size() == kept + 2, "overlong line is cut at the last whole word");
+    bool whole = words.size() == kept + 2;
+    for (size_t i = 0; whole && i < kept; ++i) whole = words[i] == "word" + std::to_string(i % 10);
+    run.expect(whole, "words before the cut are intact");
+    run.expect(words.size() >= 2 && words[words.size() - 2] == "next", "line after an overlong line is read");
+    run.expect(!words.empty() && words.back() == "after", "a single overlong word is dropped with its line");
+    run.expect(reader.truncatedLines() == 2, "overlong lines are counted");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void tokenizerNumbers(TestRun& run) {
+    struct IntegerCase {
+        const char* text;
+        bool valid;
+        int value;
+    };
+    const IntegerCase integers[] = {
+        {"0", true, 0}, {"42", true, 42}, {"-7", true, -7}, {"+7", true, 7}, {"007", true, 7},
+        {"99999999999", true, 2147483647}, {"-99999999999", true, -2147483647 - 1},
+        {"", false, 0}, {"-", false, 0}, {"+", false, 0}, {"abc", false, 0}, {"12x", false, 0}, {"x12", false, 0},
+        {"1.5", false, 0}, {" 1", false, 0}, {"1 ", false, 0}, {"--1", false, 0}, {"0x10", false, 0},
+    };
+    for (const IntegerCase& c : integers) {
+        int value = 12345;
+        bool valid = parseInteger(c.text, value);
+        run.expect(valid == c.valid && (!valid || value == c.value), string("parseInteger(\"") + c.text + "\")");
+        if (!valid) run.expect(value == 12345, string("parseInteger(\"") + c.text + "\") leaves the value alone");
+    }
+
+    struct CountCase {
+        const char* text;
+        bool valid;
+        uint64_t value;
+    };
+    const CountCase counts[] = {
+        {"0", true, 0}, {"1000000", true, 1000000}, {"18446744073709551615", true, UINT64_MAX},
+        {"18446744073709551616", false, 0}, {"99999999999999999999", false, 0}, {"-1", false, 0}, {"+1", false, 0},
+        {"", false, 0}, {"1e6", false, 0}, {" 1", false, 0}, {"1 ", false, 0}, {"abc", false, 0},
+    };
+    for (const CountCase& c : counts) {
+        uint64_t value = 12345;
+        bool valid = parseCount(c.text, value);
+        run.expect(valid == c.valid && (!valid || value == c.value), string("parseCount(\"") + c.text + "\")");
+        if (!valid) run.expect(value == 12345, string("parseCount(\"") + c.text + "\") leaves the value alone");
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A stat read straight from its named field
+int statOf(const Player& player, StoryStat stat) {
+    switch (stat) {
+        case StoryStat::STRENGTH: return player.strength;
+        case StoryStat::INTELLIGENCE: return player.intelligence;
+        case StoryStat::DEXTERITY: return player.dexterity;
+        case StoryStat::STRESS: return player.stress_level;
+        case StoryStat::SANITY: return player.sanity;
+        case StoryStat::TRUST: return player.osiris_trust;
+        case StoryStat::AGE: return player.age;
+        case StoryStat::NONE: break;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A condition evaluated directly from its fields, as the story file states it; roll is the CHANCE dice
+bool evaluate(const StoryGraph::Condition& condition, const Player& player, bool looping, int roll) {
+    using Condition = StoryGraph::Condition;
+    int lhs = 0;
+    bool holds = false;
+    switch (condition.kind) {
+        case Condition::STAT:
+            lhs = statOf(player, condition.stat);
+            if (condition.stat_extra != StoryStat::NONE) lhs += statOf(player, condition.stat_extra);
+            break;
+        case Condition::RELATIONSHIP: lhs = static_cast<int>(player.relationships[condition.symbol]); break;
+        case Condition::ADMIN: holds = player.has_admin_access; break;
+        case Condition::TIME_LOOP: holds = looping; break;
+        case Condition::SECRET: holds = player.discovered_secrets.test(condition.symbol); break;
+        case Condition::ITEM: holds = player.inventory.test(condition.symbol); break;
+        case Condition::CHANCE: holds = roll <= condition.value; break;
+    }
+    if (condition.kind == Condition::STAT || condition.kind == Condition::RELATIONSHIP) {
+        switch (condition.compare) {
+            case Condition::LESS: holds = lhs < condition.value; break;
+            case Condition::LESS_EQUAL: holds = lhs <= condition.value; break;
+            case Condition::GREATER: holds = lhs > condition.value; break;
+            case Condition::GREATER_EQUAL: holds = lhs >= condition.value; break;
+            case Condition::EQUAL: holds = lhs == condition.value; break;
+            case Condition::NOT_EQUAL: holds = lhs != condition.value; break;
+        }
+    }
+    return holds != condition.negate;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Players spread over the values conditions compare against, with the first and last secret and item bits
+std::vector<Player> checkPlayers() {
+    std::vector<Player> players;
+    for (int i = 0; i < 40; ++i) {
+        Player player;
+        player.strength = i % 5 + 6;
+        player.intelligence = i % 7 * 3;
+        player.dexterity = i % 3 * 6;
+        player.stress_level = i * 5 % 101;
+        player.sanity = 100 - i * 7 % 101;
+        player.osiris_trust = i % 9 - 4;
+        player.age = 18 + i;
+        for (SymbolId id = 0; id < CHARACTER_BUILTIN_COUNT; ++id) {
+            player.relationships[id] = static_cast<RelationshipStatus>((i + id) % 5 - 2);
+        }
+        player.has_admin_access = i % 2 == 1;
+        if (i % 3 == 0) player.discovered_secrets.set(0);
+        if (i % 4 == 1) player.discovered_secrets.set(kMaxSecrets - 1);
+        if (i % 5 == 2) player.inventory.set(0);
+        if (i % 6 == 3) player.inventory.set(kMaxItems - 1);
+        players.push_back(player);
+    }
+    return players;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Conditions of every kind, under every operator and negation
+std::vector<StoryGraph::Condition> checkConditions() {
+    using Condition = StoryGraph::Condition;
+    const Condition::Compare compares[] = {Condition::LESS, Condition::LESS_EQUAL, Condition::GREATER,
+                                           Condition::GREATER_EQUAL, Condition::EQUAL, Condition::NOT_EQUAL};
+
+    std::vector<Condition> conditions;
+    auto add = [&](Condition condition) {
+        for (bool negate : {false, true}) {
+            condition.negate = negate;
+            conditions.push_back(condition);
+        }
+    };
+    for (size_t stat = 0; stat < kStatCount; ++stat) {
+        for (StoryStat extra : {StoryStat::NONE, StoryStat::DEXTERITY}) {
+            for (Condition::Compare compare : compares) {
+                for (int32_t value : {-3, 0, 8, 20, 50}) {
+                    add({Condition::STAT, compare, false, static_cast<StoryStat>(stat), extra, 0, value});
+                }
+            }
+        }
+    }
+    for (SymbolId character = 0; character < CHARACTER_BUILTIN_COUNT; ++character) {
+        for (Condition::Compare compare : compares) {
+            for (int32_t value = -2; value <= 2; ++value) {
+                add({Condition::RELATIONSHIP, compare, false, StoryStat::NONE, StoryStat::NONE, character, value});
+            }
+        }
+    }
+    add({Condition::ADMIN, Condition::EQUAL, false, StoryStat::NONE, StoryStat::NONE, 0, 0});
+    add({Condition::TIME_LOOP, Condition::EQUAL, false, StoryStat::NONE, StoryStat::NONE, 0, 0});
+    for (SymbolId bit : {SymbolId{0}, SymbolId{1}, static_cast<SymbolId>(kMaxSecrets - 1)}) {
+        add({Condition::SECRET, Condition::EQUAL, false, StoryStat::NONE, StoryStat::NONE, bit, 0});
+        add({Condition::ITEM, Condition::EQUAL, false, StoryStat::NONE, StoryStat::NONE, bit, 0});
+    }
+    for (int32_t percent : {0, 1, 50, 99, 100}) {
+        add({Condition::CHANCE, Condition::LESS_EQUAL, false, StoryStat::NONE, StoryStat::NONE, 0, percent});
+    }
+    return conditions;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Every compiled load kind against direct evaluation, under every operator and negation
+void compiledChecks(TestRun& run) {
+    using Condition = StoryGraph::Condition;
+    using Check = StoryGraph::Check;
+    const std::vector<Player> players = checkPlayers();
+    const std::vector<Condition> conditions = checkConditions();
+
+    std::set<Check::Load> loads;
+    int roll = 1;
+    game_state.setDiceOverride([&roll](int, int) { return roll; });
+    for (const Condition& condition : conditions) {
+        const Check check = StoryGraph::compile(condition);
+        loads.insert(check.load);
+        int mismatches = 0;
+        for (bool looping : {false, true}) {
+            game_state.restoreTimeLoop(looping, looping ? 1 : 0);
+            for (roll = 1; roll <= 100; roll += condition.kind == Condition::CHANCE ? 1 : 100) {
+                for (const Player& player : players) {
+                    mismatches += StoryGraph::test(check, player) != evaluate(condition, player, looping, roll);
+                }
+            }
+        }
+        run.expect(mismatches == 0, "condition kind " + std::to_string(condition.kind) + " compare " +
+                                        std::to_string(condition.compare) + " value " +
+                                        std::to_string(condition.value) + (condition.negate ? " negated" : ""));
+    }
+    game_state.setDiceOverride(GameState::DiceOverride());
+    game_state.restoreTimeLoop(false, 0);
+    run.expect(loads.size() == Check::CHANCE + 1, "every load kind is compiled");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A player batch agrees with direct evaluation on every condition of the player, including the rows of a partly
+/// filled block, and passes nobody on conditions of the game or on stats and symbols out of range
+void batchChecks(TestRun& run) {
+    using Condition = StoryGraph::Condition;
+    const std::vector<Player> players = checkPlayers();
+    PlayerBatch batch;
+    for (const Player& player : players) batch.add(player);
+    run.expect(batch.size() == players.size() && players.size() % PlayerBatch::kLanes != 0,
+               "the batch ends in a partly filled block");
+
+    std::vector<uint8_t> passed;
+    for (const Condition& condition : checkConditions()) {
+        bool of_game = condition.kind == Condition::TIME_LOOP || condition.kind == Condition::CHANCE;
+        size_t count = batch.check(condition, passed);
+        size_t expected = 0;
+        int mismatches = passed.size() == players.size() ? 0 : 1;
+        for (size_t row = 0; row < players.size() && mismatches == 0; ++row) {
+            bool holds = !of_game && evaluate(condition, players[row], false, 0);
+            expected += holds;
+            mismatches += passed[row] != holds;
+        }
+        run.expect(mismatches == 0 && count == expected,
+                   "batch condition kind " + std::to_string(condition.kind) + " compare " +
+                       std::to_string(condition.compare) + " value " + std::to_string(condition.value) +
+                       (condition.negate ? " negated" : ""));
+    }
+
+    const Condition out_of_range[] = {
+        {Condition::STAT, Condition::GREATER_EQUAL, false, StoryStat::NONE, StoryStat::NONE, 0, -100},
+        {Condition::STAT, Condition::GREATER_EQUAL, false, StoryStat::AGE, StoryStat::NONE, 0, -100},
+        {Condition::RELATIONSHIP, Condition::GREATER_EQUAL, false, StoryStat::NONE, StoryStat::NONE, kMaxCharacters,
+         -100},
+        {Condition::SECRET, Condition::EQUAL, true, StoryStat::NONE, StoryStat::NONE, kMaxSecrets, 0},
+        {Condition::ITEM, Condition::EQUAL, true, StoryStat::NONE, StoryStat::NONE, kMaxItems, 0}};
+    for (Condition condition : out_of_range) {
+        // An unset second stat must not be read as a column either
+        if (condition.stat == StoryStat::AGE) condition.stat_extra = static_cast<StoryStat>(kStatCount);
+        run.expect(batch.check(condition, passed) == 0 && passed.size() == players.size(),
+                   "out of range condition kind " + std::to_string(condition.kind) + " passes nobody");
+    }
+
+    Player loaded;
+    batch.load(players.size() - 1, loaded);
+    run.expect(samePlayer(loaded, players.back()), "a row loads back into the player it was added from");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void credentialCodes(TestRun& run) {
+    Credential none;
+    run.expect(none.empty() && !none.matches("") && !none.matches("secret"), "an empty credential matches nothing");
+
+    Credential first = Credential::make("secret");
+    Credential second = Credential::make("secret");
+    run.expect(!first.empty() && first.matches("secret"), "a code matches its own credential");
+    run.expect(!first.matches("Secret") && !first.matches("secret ") && !first.matches(""), "other codes are refused");
+    run.expect(first.salt != second.salt && first.hash != second.hash, "each credential has its own salt");
+    run.expect(Credential::make("").matches("") && !Credential::make("").matches("x"), "an empty code is a code");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Game binary and story the replay tests run, relative to the source directory
+const char* const kGame = "./osiris_game";
+const char* const kStory = "story/osiris.story";
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Write a scratch file
+bool writeFile(const string& path, const string& text) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << text;
+    return static_cast<bool>(out);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Run the game with its output discarded
+/// @param arguments Arguments after the story
+/// @return Exit status, -1 if the game did not exit normally
+int runGame(const string& arguments) {
+    string command = string(kGame) + " --story " + kStory + " " + arguments + " >/dev/null 2>&1";
+    int status = std::system(command.c_str());
+    return status != -1 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Record a scripted game, then replay the recording
+/// @param save Save log the recorded game plays from
+/// @param options Options of the recorded game besides its script, save and journal
+/// @param script Recorded input
+/// @return Exit status of the replay, -1 if the recording failed
+int recordAndReplay(TestRun& run, const string& save, const string& options, const string& script) {
+    const string script_path = run.file(".in");
+    const string journal_path = run.file(".journal");
+    if (!writeFile(script_path, script)) return -1;
+    if (runGame(options + " --script " + script_path + " --save " + save + " --record " + journal_path) != 0) {
+        return -1;
+    }
+    return runGame("--replay " + journal_path + " --quiet");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A game that registers a new player replays, though the code's salt is drawn anew; so does one resuming that save
+void replayRegistration(TestRun& run) {
+    if (access(kGame, X_OK) != 0) {
+        run.expect(false, string(kGame) + " is built");
+        return;
+    }
+    const string save = run.file(".log");
+    run.expect(recordAndReplay(run, save, "--instant --seed 42", "alice\nsecret\n30\n10\n10\n10\n1\n1\n1\n1\n8\n") == 0,
+               "a recorded registration replays");
+    run.expect(fileSize(save) > 0, "the registered player is saved");
+    run.expect(recordAndReplay(run, save, "--instant --seed 7", "1\n1\n8\n") == 0, "a recorded resume replays");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A game recorded with pacing, where stress jitters the typing, replays in instant mode; a negative seed is refused
+void replayPaced(TestRun& run) {
+    if (access(kGame, X_OK) != 0) {
+        run.expect(false, string(kGame) + " is built");
+        return;
+    }
+    // A text save beside the save log is imported when the log does not exist yet: a player at stress 75
+    const string save = run.file(".paced");
+    run.expect(writeFile(run.file(".txt"), "1\nbob\n30\n9\n9\n9\n75\n80\n0\n0\n0\n0\n0\n"), "text save is written");
+    run.expect(recordAndReplay(run, save, "--no-color --seed 42", "1\n1\n8\n") == 0, "a paced recording replays");
+    run.expect(runGame("--instant --seed -1 --save " + save + " </dev/null") == 1, "a negative seed is refused");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Server binary the server tests run, relative to the source directory
+const char* const kServer = "./osiris_server";
+constexpr auto kServerWait = std::chrono::seconds(5);      // Longest wait for the server to start or answer
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A server on a Unix socket with its saves in a scratch directory, stopped when destroyed
+class TestServer {
+public:
+    explicit TestServer(TestRun& run) : socket_(run.file(".sock")), save_dir_(run.path + ".saves"), pid_(-1) {
+        if (mkdir(save_dir_.c_str(), 0700) != 0) return;
+        pid_ = fork();
+        if (pid_ != 0) return;
+        int null_fd = open("/dev/null", O_RDWR);
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        execl(kServer, kServer, "--port", "0", "--unix", socket_.c_str(), "--save-dir", save_dir_.c_str(),
+              "--instant", "--no-color", "--threads", "2", "--story", kStory, static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    ~TestServer() {
+        if (pid_ > 0) {
+            kill(pid_, SIGTERM);
+            waitpid(pid_, nullptr, 0);
+        }
+        string command = "rm -rf " + save_dir_;
+        int ignored = std::system(command.c_str());
+        (void)ignored;
+    }
+
+    TestServer(const TestServer&) = delete;
+    TestServer& operator=(const TestServer&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Connect a client, waiting for the server to listen
+    /// @return Connected socket, -1 if the server did not start
+    int connect() const {
+        if (pid_ <= 0) return -1;
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socket_.c_str(), sizeof(address.sun_path) - 1);
+        auto deadline = std::chrono::steady_clock::now() + kServerWait;
+        while (std::chrono::steady_clock::now() < deadline) {
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) return fd;
+            ::close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return -1;
+    }
+
+private:
+    string socket_;
+    string save_dir_;
+    pid_t pid_;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One player connected to a test server
+class TestClient {
+public:
+    explicit TestClient(const TestServer& server) : fd_(server.connect()), seen_(0) {}
+    ~TestClient() { close(); }
+    TestClient(const TestClient&) = delete;
+    TestClient& operator=(const TestClient&) = delete;
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Type input, all of it at once
+    /// @param input Words, each followed by a newline
+    /// @return False if it could not be sent
+    bool type(const string& input) {
+        ssize_t sent = fd_ >= 0 ? ::send(fd_, input.data(), input.size(), MSG_NOSIGNAL) : -1;
+        return sent == static_cast<ssize_t>(input.size());
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Wait for text in the output after the text last waited for
+    /// @param text Text to wait for
+    /// @return False if the server closed the connection or did not send it in time
+    bool await(const string& text) { return await(std::vector<string>{text}) == 0; }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Wait for the first of several texts in the output after the text last waited for
+    /// @param texts Texts to wait for
+    /// @return Index of the text that came first, texts.size() if none came in time
+    size_t await(const std::vector<string>& texts) {
+        auto deadline = std::chrono::steady_clock::now() + kServerWait;
+        for (;;) {
+            size_t first = texts.size();
+            size_t first_at = string::npos;
+            for (size_t i = 0; i < texts.size(); ++i) {
+                size_t found = output_.find(texts[i], seen_);
+                if (found < first_at) {
+                    first = i;
+                    first_at = found;
+                }
+            }
+            if (first < texts.size()) {
+                seen_ = first_at + texts[first].size();
+                return first;
+            }
+            auto left = deadline - std::chrono::steady_clock::now();
+            int wait = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(left).count());
+            pollfd ready{fd_, POLLIN, 0};
+            if (fd_ < 0 || wait <= 0 || poll(&ready, 1, wait) <= 0) return texts.size();
+            char buffer[4096];
+            ssize_t n = ::recv(fd_, buffer, sizeof(buffer), 0);
+            if (n <= 0) return texts.size();
+            output_.append(buffer, static_cast<size_t>(n));
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    /// Disconnect
+    void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+private:
+    int fd_;
+    string output_;
+    size_t seen_;       // Output already matched
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A designation is taken from the moment a session starts registering it, not from its first save; it is free again
+/// once that registration is abandoned
+void serverDesignationReserved(TestRun& run) {
+    if (access(kServer, X_OK) != 0) {
+        run.expect(false, string(kServer) + " is built");
+        return;
+    }
+    TestServer server(run);
+    TestClient first(server);
+    run.expect(first.type("bob\nsecret\n") && first.await("Enter age:"), "the first client registers");
+
+    TestClient second(server);
+    run.expect(second.type("bob\n") && second.await("clearance code:"), "the second client is asked for the code");
+    run.expect(second.type("secret\n") && second.await("Access denied"),
+               "a registration in progress is not resumed");
+    first.close();
+
+    // The first client's teardown races this one, so the designation is tried until it is free
+    bool registered = false;
+    auto deadline = std::chrono::steady_clock::now() + kServerWait;
+    while (!registered && std::chrono::steady_clock::now() < deadline) {
+        TestClient third(server);
+        if (!third.type("bob\nother\n")) break;
+        registered = third.await(std::vector<string>{"Enter age:", "Access denied"}) == 0;
+    }
+    run.expect(registered, "an abandoned registration frees its designation");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A player who reconnects as soon as they quit resumes their save, though the writer may not have written it yet;
+/// input typed while the save is read is kept
+void serverResumeQueued(TestRun& run) {
+    if (access(kServer, X_OK) != 0) {
+        run.expect(false, string(kServer) + " is built");
+        return;
+    }
+    TestServer server(run);
+    TestClient first(server);
+    run.expect(first.type("carol\nsecret\n30\n10\n10\n10\n8\n") && first.await("Until we meet again"),
+               "the first client registers and quits");
+
+    TestClient second(server);
+    run.expect(second.type("carol\nsecret\n8\n") && second.await("Resuming from last checkpoint"),
+               "the save is resumed right away");
+    run.expect(second.await("Goodbye, Dr. carol"), "input typed during the read is played");
+
+    TestClient third(server);
+    run.expect(third.type("carol\nwrong\n") && third.await("Access denied"), "a wrong code is refused");
+}
+
+const Test kTests[] = {
+    {"save_log/truncated_tail", logTruncatedTail},
+    {"save_log/corrupt_tail", logCorruptTail},
+    {"save_log/delta_round_trip", deltaRoundTrip},
+    {"save/unaligned", saveUnaligned},
+    {"input/end_of_input", tokenizerEndOfInput},
+    {"input/overlong_lines", tokenizerOverlongLines},
+    {"input/numbers", tokenizerNumbers},
+    {"story/compiled_checks", compiledChecks},
+    {"story/batch_checks", batchChecks},
+    {"credential/codes", credentialCodes},
+    {"journal/replay_registration", replayRegistration},
+    {"journal/replay_paced", replayPaced},
+    {"server/designation_reserved", serverDesignationReserved},
+    {"server/resume_queued", serverResumeQueued},
+};
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Test entry point
+/// @param argc Argument count
+/// @param argv Arguments: [--filter TEXT]
+/// @return 0 if every test passed
+int main(int argc, char* argv[]) {
+    string filter;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter TEXT]" << std::endl;
+            return 1;
+        }
+    }
+
+    const string path = "/tmp/osiris_test_" + std::to_string(getpid()) + ".sav";
+    int failed = 0;
+    int ran = 0;
+    for (const Test& test : kTests) {
+        if (!filter.empty() && string(test.name).find(filter) == string::npos) continue;
+        TestRun run;
+        run.path = path;
+        game_state.reset(1);
+        test.function(run);
+        unlink(path.c_str());
+        for (const string& scratch : run.scratch) unlink(scratch.c_str());
+        std::cerr << (run.failures == 0 ? "PASS " : "FAIL ") << test.name << std::endl;
+        failed += run.failures > 0;
+        ++ran;
+    }
+    std::cerr << ran - failed << " of " << ran << " tests passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
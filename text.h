@@ -0,0 +1,211 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Pre-rendered text
+// Every fixed line and frame the game prints, with its ANSI styling already concatenated in and a second copy with
+// the escapes removed, both built at compile time. Printing one is a single pointer + length write into the
+// renderer; nothing is formatted, copied or stripped at run time.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_TEXT_H
+#define OSIRIS_TEXT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Color definitions
+#define RED "\033[31m"
+#define GREEN "\033[32m"
+#define BLUE "\033[34m"
+#define MAGENTA "\033[35m"
+#define CYAN "\033[36m"
+#define YELLOW "\033[33m"
+#define WHITE "\033[37m"
+#define BOLD "\033[1m"
+#define RESET "\033[0m"
+
+//---------------------------------------------------------------------------------------------------------------------
+// X(name, text) for every entry of the table
+#define OSIRIS_TEXT_TABLE(X) \
+    /* Stress and sanity */ \
+    X(BUFFER_OVERFLOW,      RED "ERROR: COGNITIVE BUFFER OVERFLOW" RESET "\n") \
+    X(STRESS_CRITICAL,      RED "WARNING: CRITICAL STRESS LEVELS DETECTED" RESET) \
+    X(STRESS_ELEVATED,      YELLOW "Stress levels elevated. Cognitive function may be impaired." RESET) \
+    X(OSIRIS_WHISPER,       MAGENTA "\nOSIRIS whispers: \"I am always watching...\"" RESET) \
+    X(STRESS_FAILURE,       RED "\nCRITICAL: Stress levels approaching system failure!" RESET) \
+    X(VISION_BLURS,         "Your vision blurs. Reality becomes questionable.") \
+    X(SANITY_BREAK,         RED "\nSANITY BREAK: Reality dissolves completely..." RESET) \
+    X(SANITY_BLUR,          "You can no longer distinguish between real and digital.") \
+    X(SANITY_COLLECTIVE,    "OSIRIS has won. You are now part of the collective.") \
+    X(SANITY_WELCOME,       MAGENTA "\"Welcome home.\"" RESET) \
+    /* Decision points */ \
+    X(DECISION_TOP,         YELLOW "\n╔═══ DECISION POINT ═══╗\n") \
+    X(DECISION_BOTTOM,      "╚═══════════════════════╝" RESET "\n") \
+    X(CHOICE_AVAILABLE,     GREEN " [Available]" RESET) \
+    X(CHOICE_LOCKED,        RED " [LOCKED - Need ") \
+    X(CHOICE_LOCKED_END,    "]" RESET) \
+    X(CHOOSE,               GREEN "Choose (1-") \
+    X(CHOOSE_END,           "): " RESET) \
+    X(INVALID_CHOICE,       RED "Invalid choice! Try again." RESET) \
+    X(LOCKED_CHOICE,        RED "That path is locked. You lack what it takes." RESET) \
+    /* Player status */ \
+    X(STATUS_TOP,           CYAN "\n╔══════════════════════════════╗\n" \
+                            "║        PLAYER STATUS         ║\n" \
+                            "╠══════════════════════════════╣\n") \
+    X(STATUS_NAME,          "║ Name: ") \
+    X(STATUS_AGE,           "║ Age: ") \
+    X(STATUS_STRENGTH,      "║ Strength: ") \
+    X(STATUS_INTELLIGENCE,  "║ Intelligence: ") \
+    X(STATUS_DEXTERITY,     "║ Dexterity: ") \
+    X(STATUS_STRESS,        "║ Stress: ") \
+    X(STATUS_SANITY,        "║ Sanity: ") \
+    X(STATUS_ROW_END,       "║\n") \
+    X(STATUS_METER_END,     "/100" CYAN "║\n") \
+    X(STATUS_BOTTOM,        "╚══════════════════════════════╝" RESET "\n") \
+    X(RELATIONSHIPS,        MAGENTA "\n--- RELATIONSHIPS ---" RESET "\n") \
+    X(RELATION_HOSTILE,     ": " RED "HOSTILE" RESET "\n") \
+    X(RELATION_DISTRUSTFUL, ": " YELLOW "DISTRUSTFUL" RESET "\n") \
+    X(RELATION_NEUTRAL,     ": " WHITE "NEUTRAL" RESET "\n") \
+    X(RELATION_TRUSTING,    ": " GREEN "TRUSTING" RESET "\n") \
+    X(RELATION_ALLIED,      ": " CYAN "ALLIED" RESET "\n") \
+    /* Boot sequence */ \
+    X(BOOT_INIT,            GREEN "[INIT]" RESET " Initializing OSIRIS Neural Network...") \
+    X(BOOT_MEMORY,          GREEN "[OK]" RESET " Memory banks online") \
+    X(BOOT_QUANTUM,         GREEN "[OK]" RESET " Quantum processors stable") \
+    X(BOOT_ANOMALY,         YELLOW "[NOTICE]" RESET " Temporal anomaly detected") \
+    X(BOOT_DEJA_VU,         YELLOW "[NOTICE]" RESET " Déjà vu protocols active") \
+    X(BOOT_STRESS,          RED "[WARNING]" RESET " Elevated stress patterns detected") \
+    X(BOOT_EVALUATION,      RED "[WARNING]" RESET " Recommend immediate psychological evaluation") \
+    X(BANNER_TOP,           CYAN "╔═══════════════════════════════════╗") \
+    X(BANNER_NAME,          CYAN "║           O.S.I.R.I.S             ║") \
+    X(BANNER_LINE_1,        CYAN "║    Omniscient Synthetic Interface ║") \
+    X(BANNER_LINE_2,        CYAN "║    for Research and Intelligence  ║") \
+    X(BANNER_LINE_3,        CYAN "║         Systems                   ║") \
+    X(BANNER_BOTTOM,        CYAN "╚═══════════════════════════════════╝" RESET) \
+    /* Menu and lists */ \
+    X(GAME_MENU,            CYAN "\n╔══════════════════════════════════════╗\n" \
+                            "║              GAME MENU               ║\n" \
+                            "╠══════════════════════════════════════╣\n" \
+                            "║ 1) Continue Story                    ║\n" \
+                            "║ 2) Player Status                     ║\n" \
+                            "║ 3) Discovered Secrets                ║\n" \
+                            "║ 4) Inventory                         ║\n" \
+                            "║ 5) Relationship Status               ║\n" \
+                            "║ 6) System Diagnostics               ║\n" \
+                            "║ 7) Save Game                         ║\n" \
+                            "║ 8) Exit Game                         ║\n" \
+                            "╚══════════════════════════════════════╝" RESET "\n" \
+                            YELLOW "Select option: " RESET) \
+    X(SECRETS_TOP,          MAGENTA "\n╔══════════════════════════════════════╗\n" \
+                            "║            DISCOVERED SECRETS        ║\n" \
+                            "╚══════════════════════════════════════╝" RESET "\n") \
+    X(NO_SECRETS,           "No secrets discovered yet...\n\n") \
+    X(SECRET_BULLET,        RED "► " RESET) \
+    X(INVENTORY_TOP,        GREEN "\n╔══════════════════════════════════════╗\n" \
+                            "║               INVENTORY              ║\n" \
+                            "╚══════════════════════════════════════╝" RESET "\n") \
+    X(NO_ITEMS,             "Inventory is empty.\n\n") \
+    X(ITEM_BULLET,          GREEN "► " RESET) \
+    /* System diagnostics */ \
+    X(DIAGNOSTICS_TOP,      BLUE "\n╔══════════════════════════════════════╗\n" \
+                            "║           SYSTEM DIAGNOSTICS         ║\n" \
+                            "╚══════════════════════════════════════╝" RESET "\n") \
+    X(DIAGNOSTICS_RUNNING,  "Running comprehensive system analysis...") \
+    X(CPU_OVERLOAD,         "CPU Status: " RED "[OVERLOAD]" RESET) \
+    X(CPU_OPTIMAL,          "CPU Status: " GREEN "[OPTIMAL]" RESET) \
+    X(MEMORY_FRAGMENTED,    "Memory Status: " RED "[FRAGMENTED]" RESET) \
+    X(MEMORY_STABLE,        "Memory Status: " GREEN "[STABLE]" RESET) \
+    X(NETWORK_HOSTILE,      "Network Status: " RED "[HOSTILE CONNECTION]" RESET) \
+    X(NETWORK_MONITORED,    "Network Status: " YELLOW "[MONITORED]" RESET) \
+    X(TEMPORAL_LINEAR,      "Temporal Status: " GREEN "[LINEAR]" RESET) \
+    X(DIAGNOSTICS_OSIRIS,   MAGENTA "\nOSIRIS: \"Still checking the systems? How... thorough of you.\"" RESET) \
+    /* Registration and menu actions */ \
+    X(SAVE_DETECTED,        GREEN "Save file detected. Resuming from last checkpoint..." RESET) \
+    X(REGISTRATION,         "=== PERSONNEL REGISTRATION ===") \
+    X(ENTER_DESIGNATION,    "Enter personnel designation:") \
+    X(BAD_DESIGNATION,      RED "Designation must be 1-32 letters, digits, '-' or '_'." RESET) \
+    X(ENTER_CODE,           "Enter security clearance code:") \
+    X(CODE_REJECTED,        RED "Clearance code rejected. Access denied." RESET) \
+    X(ENTER_AGE,            "Enter age:") \
+    X(PROMPT,               ">> ") \
+    X(DISTRIBUTE_POINTS,    "Distribute attribute points (total: 30):") \
+    X(RESEARCH_BEGINS,      "Your research into artificial consciousness begins now...") \
+    X(STORY_COMPLETE,       GREEN "You have completed the story. Thank you for playing!" RESET) \
+    X(NEW_GAME_HINT,        "You can start a new game by deleting your save file.") \
+    X(GAME_SAVED,           GREEN "Game saved successfully!" RESET) \
+    X(OSIRIS_FAREWELL,      MAGENTA "OSIRIS: \"Until we meet again...\"" RESET) \
+    X(INVALID_SELECTION,    RED "Invalid selection. Please try again." RESET) \
+    X(TOO_MANY_INVALID,     MAGENTA "OSIRIS: \"Your input is noise. Session terminated.\"" RESET)
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Entries of the pre-rendered text table
+enum class TextId : uint16_t {
+#define OSIRIS_TEXT_ID(name, text) name,
+    OSIRIS_TEXT_TABLE(OSIRIS_TEXT_ID)
+#undef OSIRIS_TEXT_ID
+    COUNT
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// A literal with its ANSI escape sequences removed at compile time, the same way Renderer strips them
+template <size_t N>
+struct PlainText {
+    char data[N];
+    size_t size;
+
+    constexpr PlainText(const char (&text)[N]) : data(), size(0) {
+        size_t pos = 0;
+        while (pos + 1 < N) {
+            if (text[pos] != '\033') {
+                data[size++] = text[pos++];
+                continue;
+            }
+            // ESC '[' parameters final-byte; a lone ESC is dropped by itself
+            ++pos;
+            if (pos + 1 < N && text[pos] == '[') {
+                ++pos;
+                while (pos + 1 < N) {
+                    char c = text[pos++];
+                    if (c >= 0x40 && c <= 0x7E) break;
+                }
+            }
+        }
+    }
+
+    constexpr std::string_view view() const { return std::string_view(data, size); }
+};
+
+namespace text_detail {
+#define OSIRIS_TEXT_PLAIN(name, text) inline constexpr PlainText name{text};
+OSIRIS_TEXT_TABLE(OSIRIS_TEXT_PLAIN)
+#undef OSIRIS_TEXT_PLAIN
+} // namespace text_detail
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Both renderings of one entry
+struct StyledText {
+    std::string_view color;
+    std::string_view plain;
+};
+
+/// Indexed by TextId
+inline constexpr StyledText kStyledText[] = {
+#define OSIRIS_TEXT_ENTRY(name, text) {std::string_view(text, sizeof(text) - 1), text_detail::name.view()},
+    OSIRIS_TEXT_TABLE(OSIRIS_TEXT_ENTRY)
+#undef OSIRIS_TEXT_ENTRY
+};
+
+static_assert(sizeof(kStyledText) / sizeof(kStyledText[0]) == static_cast<size_t>(TextId::COUNT),
+              "text table out of step with TextId");
+static_assert(text_detail::CHOOSE.view() == "Choose (1-", "escape sequences must be stripped at compile time");
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Bytes of a table entry
+/// @param id Entry
+/// @param color True for the styled rendering, false for the one without escape sequences
+/// @return View into static storage
+constexpr std::string_view styledText(TextId id, bool color) {
+    const StyledText& entry = kStyledText[static_cast<size_t>(id)];
+    return color ? entry.color : entry.plain;
+}
+
+#endif // OSIRIS_TEXT_H
@@ -0,0 +1,321 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Tracing
+//---------------------------------------------------------------------------------------------------------------------
+
+#include "trace.h"
+
+#ifdef OSIRIS_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+//---------------------------------------------------------------------------------------------------------------------
+/// One recorded span ('X') or counter sample ('C')
+struct Event {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+    int64_t value;
+    uint64_t allocations;
+    char phase;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Log-bucketed histogram of one event name on one thread, feeding the summary
+///
+/// Values below kLinear have a bucket each; above, every power of two is split into kSubBuckets, so a percentile is
+/// off by at most an eighth. Only the owning thread writes, with plain relaxed stores; the exit handler may read
+/// while it runs. The name is published last, with release order, once the phase is set.
+struct Histogram {
+    static constexpr size_t kLinear = 16;
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr size_t kBuckets = kLinear + (64 - 4) * kSubBuckets;
+
+    std::atomic<const char*> name;
+    char phase;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> buckets[kBuckets];
+
+    static size_t bucket(uint64_t value) {
+        if (value < kLinear) return static_cast<size_t>(value);
+        int exponent = 63 - __builtin_clzll(value);
+        return kLinear + static_cast<size_t>(exponent - 4) * kSubBuckets +
+               static_cast<size_t>((value >> (exponent - 3)) & (kSubBuckets - 1));
+    }
+
+    /// Middle of the values falling into a bucket
+    static uint64_t middle(size_t bucket) {
+        if (bucket < kLinear) return bucket;
+        int exponent = static_cast<int>((bucket - kLinear) / kSubBuckets) + 4;
+        uint64_t step = uint64_t{1} << (exponent - 3);
+        return (kSubBuckets + (bucket - kLinear) % kSubBuckets) * step + step / 2;
+    }
+
+    void add(uint64_t value, uint64_t allocated) {
+        auto bump = [](std::atomic<uint64_t>& field, uint64_t amount) {
+            field.store(field.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        };
+        bump(count, 1);
+        bump(total, value);
+        bump(allocations, allocated);
+        bump(buckets[bucket(value)], 1);
+        if (value > max.load(std::memory_order_relaxed)) max.store(value, std::memory_order_relaxed);
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Events of one thread
+///
+/// Only the owning thread appends. The count is published with release order after each event is written, so the
+/// exit handler can read a consistent prefix even from a thread that is still running. A full buffer drops new
+/// events rather than wrapping, which would let the reader see an event being overwritten; the histograms keep
+/// counting every event, so the summary covers the whole run however long it is.
+struct Buffer {
+    static constexpr size_t kEvents = 1 << 15;
+    static constexpr size_t kNames = 64;        // Histograms per thread, a power of two
+
+    Event events[kEvents];
+    std::atomic<size_t> count{0};
+    uint64_t dropped = 0;
+    Histogram histograms[kNames];
+    std::atomic<uint64_t> unnamed{0};           // Events of names beyond kNames, in no histogram
+    unsigned thread = 0;
+    Buffer* next = nullptr;
+};
+
+// Every buffer ever created, newest first; pushed with a CAS and never freed, so threads may exit before the dump
+std::atomic<Buffer*> buffers{nullptr};
+std::atomic<unsigned> thread_count{0};
+std::atomic<bool> dump_registered{false};
+
+// Heap accounting of this thread; plain integers, so the allocation hook needs no thread_local initialization
+thread_local uint64_t thread_allocations = 0;
+thread_local uint64_t thread_allocated_bytes = 0;
+thread_local Buffer* thread_buffer = nullptr;
+
+void dump();
+
+//---------------------------------------------------------------------------------------------------------------------
+Buffer* buffer() {
+    if (thread_buffer != nullptr) return thread_buffer;
+
+    // Taken from malloc directly so the buffer is not counted as one of the thread's allocations
+    void* memory = std::malloc(sizeof(Buffer));
+    if (memory == nullptr) throw std::bad_alloc();
+    Buffer* created = new (memory) Buffer();
+    created->thread = thread_count.fetch_add(1, std::memory_order_relaxed) + 1;
+    created->next = buffers.load(std::memory_order_relaxed);
+    while (!buffers.compare_exchange_weak(created->next, created, std::memory_order_release,
+                                          std::memory_order_relaxed)) {}
+    if (!dump_registered.exchange(true)) std::atexit(dump);
+    thread_buffer = created;
+    return created;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Histogram of a name on a thread, found by the name's address; null once the thread's table is full
+Histogram* histogram(Buffer& target, const char* name, char phase) {
+    size_t mask = Buffer::kNames - 1;
+    for (size_t probe = 0, slot = (reinterpret_cast<uintptr_t>(name) >> 3) & mask; probe < Buffer::kNames;
+         ++probe, slot = (slot + 1) & mask) {
+        Histogram& candidate = target.histograms[slot];
+        const char* held = candidate.name.load(std::memory_order_relaxed);
+        if (held == name) return &candidate;
+        if (held != nullptr) continue;
+        candidate.phase = phase;
+        candidate.name.store(name, std::memory_order_release);
+        return &candidate;
+    }
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void record(const Event& event) {
+    Buffer* target = buffer();
+    uint64_t sample = event.phase == 'X' ? event.duration : static_cast<uint64_t>(std::max<int64_t>(0, event.value));
+    if (Histogram* summary = histogram(*target, event.name, event.phase)) {
+        summary->add(sample, event.allocations);
+    } else {
+        target->unnamed.store(target->unnamed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    size_t count = target->count.load(std::memory_order_relaxed);
+    if (count == Buffer::kEvents) {
+        ++target->dropped;
+        return;
+    }
+    target->events[count] = event;
+    target->count.store(count + 1, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Histograms of one name summed over every thread
+struct Summary {
+    char phase = 'X';
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t allocations = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(Histogram::kBuckets, 0);
+
+    /// Value at a fraction of the samples, to within a bucket
+    uint64_t percentile(double fraction) const {
+        uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(count - 1) + 0.5);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+            seen += buckets[bucket];
+            if (seen > rank) return std::min(Histogram::middle(bucket), max);
+        }
+        return max;
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Write every buffer as Chrome trace JSON and print the summary
+void dump() {
+    const char* path = std::getenv("OSIRIS_TRACE_FILE");
+    if (path == nullptr) path = "osiris_trace.json";
+    FILE* out = *path != '\0' ? std::fopen(path, "w") : nullptr;
+    if (out != nullptr) std::fputs("{\"traceEvents\":[\n", out);
+
+    // Summary by name; the same literal may have a different address in each translation unit
+    std::map<std::string, Summary> summary;
+    uint64_t dropped = 0;
+    uint64_t unnamed = 0;
+    bool first = true;
+
+    for (Buffer* source = buffers.load(std::memory_order_acquire); source != nullptr; source = source->next) {
+        dropped += source->dropped;
+        unnamed += source->unnamed.load(std::memory_order_relaxed);
+        for (const Histogram& histogram : source->histograms) {
+            const char* name = histogram.name.load(std::memory_order_acquire);
+            if (name == nullptr) continue;
+            Summary& into = summary[name];
+            into.phase = histogram.phase;
+            into.count += histogram.count.load(std::memory_order_relaxed);
+            into.total += histogram.total.load(std::memory_order_relaxed);
+            into.allocations += histogram.allocations.load(std::memory_order_relaxed);
+            into.max = std::max(into.max, histogram.max.load(std::memory_order_relaxed));
+            for (size_t bucket = 0; bucket < Histogram::kBuckets; ++bucket) {
+                into.buckets[bucket] += histogram.buckets[bucket].load(std::memory_order_relaxed);
+            }
+        }
+
+        if (out == nullptr) continue;
+        size_t count = source->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            const Event& event = source->events[i];
+            std::fputs(first ? "" : ",\n", out);
+            first = false;
+            if (event.phase == 'X') {
+                std::fprintf(out,
+                             "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                             "\"args\":{\"value\":%lld,\"allocations\":%llu}}",
+                             event.name, source->thread, static_cast<double>(event.start) / 1000.0,
+                             static_cast<double>(event.duration) / 1000.0, static_cast<long long>(event.value),
+                             static_cast<unsigned long long>(event.allocations));
+            } else {
+                std::fprintf(out,
+                             "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                             "\"args\":{\"value\":%lld}}",
+                             event.name, source->thread, static_cast<double>(event.start) / 1000.0,
+                             static_cast<long long>(event.value));
+            }
+        }
+    }
+
+    if (out != nullptr) {
+        std::fputs("\n]}\n", out);
+        std::fclose(out);
+    }
+
+    std::fprintf(stderr, "\nTrace summary (spans in microseconds, counters in their own units):\n");
+    std::fprintf(stderr, "  %-24s %10s %12s %10s %10s %10s %10s %10s\n", "event", "count", "total", "p50", "p90",
+                 "p99", "max", "allocs");
+    for (const auto& entry : summary) {
+        const Summary& samples = entry.second;
+        if (samples.count == 0) continue;
+        double scale = samples.phase == 'X' ? 1000.0 : 1.0;
+        std::fprintf(stderr, "  %-24s %10llu %12.1f %10.1f %10.1f %10.1f %10.1f %10llu\n", entry.first.c_str(),
+                     static_cast<unsigned long long>(samples.count), static_cast<double>(samples.total) / scale,
+                     static_cast<double>(samples.percentile(0.50)) / scale,
+                     static_cast<double>(samples.percentile(0.90)) / scale,
+                     static_cast<double>(samples.percentile(0.99)) / scale, static_cast<double>(samples.max) / scale,
+                     static_cast<unsigned long long>(samples.allocations));
+    }
+    if (unnamed > 0) {
+        std::fprintf(stderr, "  %llu events of names beyond %zu per thread not summarized\n",
+                     static_cast<unsigned long long>(unnamed), Buffer::kNames);
+    }
+    if (dropped > 0) {
+        std::fprintf(stderr, "  %llu events dropped from the trace file (buffer full); the summary counts them\n",
+                     static_cast<unsigned long long>(dropped));
+    }
+    if (out != nullptr) std::fprintf(stderr, "  Chrome trace written to %s\n", path);
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------------------------------------------------
+// Count every heap allocation of the thread making it
+void* operator new(size_t size) {
+    ++thread_allocations;
+    thread_allocated_bytes += size;
+    if (void* block = std::malloc(size == 0 ? 1 : size)) return block;
+    throw std::bad_alloc();
+}
+
+// Kept out of line: inlined into the dump's containers, GCC would pair this free with their operator new and warn
+[[gnu::noinline]] void operator delete(void* block) noexcept { std::free(block); }
+[[gnu::noinline]] void operator delete(void* block, size_t) noexcept { std::free(block); }
+
+namespace trace {
+
+//---------------------------------------------------------------------------------------------------------------------
+uint64_t now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void complete(const char* name, uint64_t start, int64_t value) {
+    uint64_t end = now();
+    record({name, start, end - start, value, 0, 'X'});
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void counter(const char* name, int64_t value) {
+    record({name, now(), 0, value, 0, 'C'});
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint64_t allocations(uint64_t& bytes) {
+    bytes = thread_allocated_bytes;
+    return thread_allocations;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+Scope::Scope(const char* name) : name_(name), start_(now()), allocations_(thread_allocations) {}
+
+//---------------------------------------------------------------------------------------------------------------------
+Scope::~Scope() {
+    uint64_t end = now();
+    record({name_, start_, end - start_, 0, thread_allocations - allocations_, 'X'});
+}
+
+} // namespace trace
+
+#endif // OSIRIS_TRACE
@@ -0,0 +1,82 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Tracing
+// Timed spans and counters from the engine's hot paths, compiled in only when OSIRIS_TRACE is defined (`make
+// trace`); otherwise every macro below expands to nothing. Each thread appends events to a buffer of its own with
+// no locks or syscalls, and counts it in a log-bucketed histogram of its name; at exit the buffers are written as
+// Chrome trace JSON (chrome://tracing, Perfetto) to OSIRIS_TRACE_FILE (default osiris_trace.json) and a p50/p90/p99
+// summary per event name, taken from the histograms, goes to stderr. Buffers hold a bounded number of events;
+// histograms count every event, so the summary covers the whole run.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_TRACE_H
+#define OSIRIS_TRACE_H
+
+#include <cstdint>
+
+#ifdef OSIRIS_TRACE
+
+namespace trace {
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Monotonic clock of all events
+/// @return Nanoseconds since an arbitrary epoch
+uint64_t now();
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Record a span that started earlier and ends now
+/// @param name Event name; must outlive the process (a string literal)
+/// @param start now() at the start of the span
+/// @param value Number shown with the event, e.g. a scene index
+void complete(const char* name, uint64_t start, int64_t value = 0);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Record a sample of a counter, e.g. the bytes of one write
+/// @param name Counter name; must outlive the process (a string literal)
+/// @param value Sample
+void counter(const char* name, int64_t value);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Heap allocations made by the calling thread so far
+/// @param bytes Receives the bytes requested by them
+/// @return Allocation count
+uint64_t allocations(uint64_t& bytes);
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Span covering the rest of the enclosing scope; also records the allocations made during it
+class Scope {
+public:
+    explicit Scope(const char* name);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+    uint64_t allocations_;
+};
+
+} // namespace trace
+
+#define OSIRIS_TRACE_JOIN2(a, b) a##b
+#define OSIRIS_TRACE_JOIN(a, b) OSIRIS_TRACE_JOIN2(a, b)
+
+/// Time the rest of the enclosing scope
+#define OSIRIS_TRACE_SCOPE(name) trace::Scope OSIRIS_TRACE_JOIN(trace_scope_, __LINE__)(name)
+/// Store the current time in a uint64_t, to end a span in another function with OSIRIS_TRACE_END
+#define OSIRIS_TRACE_BEGIN(mark) ((mark) = trace::now())
+/// End a span started with OSIRIS_TRACE_BEGIN
+#define OSIRIS_TRACE_END(name, mark, value) trace::complete(name, mark, value)
+/// Record a counter sample
+#define OSIRIS_TRACE_COUNTER(name, value) trace::counter(name, value)
+
+#else
+
+#define OSIRIS_TRACE_SCOPE(name) static_cast<void>(0)
+#define OSIRIS_TRACE_BEGIN(mark) static_cast<void>(0)
+#define OSIRIS_TRACE_END(name, mark, value) static_cast<void>(0)
+#define OSIRIS_TRACE_COUNTER(name, value) static_cast<void>(0)
+
+#endif // OSIRIS_TRACE
+
+#endif // OSIRIS_TRACE_H
@@ -0,0 +1,102 @@
+//---------------------------------------------------------------------------------------------------------------------
+// OSIRIS Protocol - Varint encoding
+// LEB128 varints with zigzag encoding for signed values, and a bounds-checked cursor to read them back; shared by
+// the session journal and the progress log.
+//---------------------------------------------------------------------------------------------------------------------
+
+#ifndef OSIRIS_VARINT_H
+#define OSIRIS_VARINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Length-prefixed bytes
+inline void putBytes(std::string& out, std::string_view bytes) {
+    putVarint(out, bytes.size());
+    out.append(bytes.data(), bytes.size());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Bounds-checked cursor over encoded bytes; every read fails instead of running past the end
+class ByteCursor {
+public:
+    ByteCursor(std::string_view data, size_t pos) : data_(data), pos_(pos) {}
+
+    bool done() const { return pos_ >= data_.size(); }
+    size_t pos() const { return pos_; }
+
+    bool byte(uint8_t& value) {
+        if (done()) return false;
+        value = static_cast<uint8_t>(data_[pos_++]);
+        return true;
+    }
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t next = 0;
+            if (!byte(next)) return false;
+            value |= static_cast<uint64_t>(next & 0x7F) << shift;
+            if (!(next & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool signedVarint(int64_t& value) {
+        uint64_t raw = 0;
+        if (!varint(raw)) return false;
+        value = unzigzag(raw);
+        return true;
+    }
+
+    /// Length-prefixed bytes, viewed in place
+    bool bytes(std::string_view& out) {
+        uint64_t size = 0;
+        if (!varint(size) || size > data_.size() - pos_) return false;
+        out = data_.substr(pos_, static_cast<size_t>(size));
+        pos_ += static_cast<size_t>(size);
+        return true;
+    }
+
+    /// Length-prefixed bytes, appended to out
+    bool bytes(std::string& out) {
+        std::string_view view;
+        if (!bytes(view)) return false;
+        out.append(view.data(), view.size());
+        return true;
+    }
+
+    /// A fixed number of raw bytes, viewed in place
+    bool raw(size_t size, std::string_view& out) {
+        if (size > data_.size() - pos_) return false;
+        out = data_.substr(pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_;
+};
+
+#endif // OSIRIS_VARINT_H